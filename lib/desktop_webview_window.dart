@@ -10,14 +10,34 @@ import 'package:flutter/cupertino.dart';
 import 'package:flutter/services.dart';
 import 'package:path/path.dart' as p;
 
+import 'src/content_filter.dart';
 import 'src/create_configuration.dart';
+import 'src/discard.dart';
+import 'src/snapshot.dart';
+import 'src/user_script.dart';
 import 'src/webview.dart';
 import 'src/webview_impl.dart';
+import 'src/webview_session.dart';
 
+export 'src/content_filter.dart';
+export 'src/cookie.dart';
 export 'src/create_configuration.dart';
+export 'src/discard.dart';
+export 'src/dom_query.dart';
+export 'src/download.dart';
+export 'src/javascript_result.dart';
+export 'src/memory_profile.dart';
+export 'src/message_batching.dart';
+export 'src/navigation_metrics.dart';
+export 'src/network_recording.dart';
+export 'src/snapshot.dart';
+export 'src/url_rule.dart';
 export 'src/user_script.dart';
 export 'src/user_script_injection_time.dart';
 export 'src/webview.dart';
+export 'src/webview_session.dart';
+export 'src/webview_texture.dart';
+export 'src/webview_texture_view.dart';
 
 final List<WebviewImpl> _webviews = [];
 
@@ -56,15 +76,186 @@ class WebviewWindow {
     configuration ??= CreateConfiguration.platform();
     _init();
     // print(configuration.toMap());
-    final viewId = await _channel.invokeMethod(
+    final result = await _channel.invokeMethod(
       "create",
       configuration.toMap(),
-    ) as int;
-    final webview = WebviewImpl(viewId, _channel);
+    );
+    // Texture webviews also report their texture.
+    final int viewId;
+    int? textureId;
+    if (result is Map) {
+      viewId = result['viewId'] as int;
+      textureId = result['textureId'] as int?;
+    } else {
+      viewId = result as int;
+    }
+    final webview = WebviewImpl(viewId, _channel, textureId: textureId);
     _webviews.add(webview);
     return webview;
   }
 
+  /// Keep [size] hidden webviews ready so [create] can hand one out
+  /// immediately instead of building a window and spawning a web process.
+  ///
+  /// The pool is refilled in the background while the app is idle. Only
+  /// configurations without a [ProxyConfiguration], [WebviewSession] or
+  /// [MemoryProfile] are served from the pool. A [size] of 0 disables the
+  /// pool and closes the pooled webviews.
+  static Future<void> configurePool({required int size}) async {
+    _init();
+    await _channel.invokeMethod('configurePool', {'size': size});
+  }
+
+  /// Serve local files on a custom URI [scheme], e.g. `app://local/index.html`,
+  /// without a file:// URL or a local HTTP server.
+  ///
+  /// Paths map to files below [directory], or below the Flutter asset bundle
+  /// when [directory] is null, so `app://local/assets/web/index.html` loads
+  /// the asset `assets/web/index.html`. Requests for "/" load index.html.
+  /// Small files are kept in memory up to [cacheSize] bytes.
+  ///
+  /// Register the scheme before loading pages from it. Registering it again
+  /// changes the directory it serves. Only supported on Linux.
+  static Future<void> registerAssetScheme(
+    String scheme, {
+    String? directory,
+    int cacheSize = 8 * 1024 * 1024,
+  }) async {
+    _init();
+    await _channel.invokeMethod('registerAssetScheme', {
+      'scheme': scheme,
+      'directory': directory,
+      'cacheSize': cacheSize,
+    });
+  }
+
+  /// Block resources with a list of content blocker rules in the WebKit
+  /// content blocker JSON format, e.g. an ad or tracker list.
+  ///
+  /// The list is compiled once and stored, adding an unchanged list again,
+  /// also after a restart, reuses the compiled filter. The filter applies to
+  /// all current and future webviews. A filter with the same [identifier]
+  /// is replaced. Only supported on Linux.
+  static Future<ContentFilterResult> addContentFilter(
+    String identifier,
+    String source,
+  ) async {
+    _init();
+    final result = await _channel.invokeMethod<Map>('addContentFilter', {
+      'identifier': identifier,
+      'source': source,
+    });
+    return ContentFilterResult.fromMap(result ?? const {});
+  }
+
+  /// Remove the filter added with [identifier] from all webviews and from
+  /// the store.
+  static Future<void> removeContentFilter(String identifier) async {
+    _init();
+    await _channel.invokeMethod('removeContentFilter', {
+      'identifier': identifier,
+    });
+  }
+
+  /// Counters of the user scripts shared between webviews.
+  static Future<UserScriptStats> getUserScriptStats() async {
+    _init();
+    final result = await _channel.invokeMethod<Map>('getUserScriptStats');
+    return UserScriptStats.fromMap(result ?? const {});
+  }
+
+  /// Load [urls] in hidden webviews, [parallelism] at a time, and take a
+  /// snapshot of each page once it finished loading.
+  ///
+  /// The webviews are [width] x [height] and are not visible to the app.
+  /// Pages that do not finish loading within [timeout] fail. Returns one
+  /// result per URL, in order. Only supported on Linux.
+  static Future<List<SnapshotJobResult>> snapshotUrls(
+    List<String> urls, {
+    int parallelism = 4,
+    int width = 1280,
+    int height = 720,
+    SnapshotRegion region = SnapshotRegion.visible,
+    SnapshotFormat format = SnapshotFormat.png,
+    Duration timeout = const Duration(seconds: 30),
+  }) async {
+    _init();
+    final results = await _channel.invokeMethod<List>('snapshotUrls', {
+      'urls': urls,
+      'parallelism': parallelism,
+      'width': width,
+      'height': height,
+      'region': region.index,
+      'format': format.index,
+      'timeoutMs': timeout.inMilliseconds,
+    });
+    return (results ?? const [])
+        .map((e) => SnapshotJobResult.fromMap(e as Map))
+        .toList();
+  }
+
+  /// Warm the HTTP cache of [session], or of the default session, before
+  /// a webview needs the pages. [session] must have a
+  /// [WebviewSession.name], an unnamed one is not shared with any webview.
+  ///
+  /// Resolves the hosts of [urls] right away. With [load], the pages are
+  /// also loaded in hidden webviews, [parallelism] at a time, and loads
+  /// that do not finish within [timeout] fail. Returns one result per
+  /// loaded URL, in order. Only supported on Linux.
+  static Future<List<PrefetchResult>> prefetch(
+    List<String> urls, {
+    WebviewSession? session,
+    bool load = true,
+    int parallelism = 4,
+    Duration timeout = const Duration(seconds: 30),
+  }) async {
+    _init();
+    final results = await _channel.invokeMethod<List>('prefetch', {
+      'urls': urls,
+      if (session != null) 'session': session.toMap(),
+      'load': load,
+      'parallelism': parallelism,
+      'timeoutMs': timeout.inMilliseconds,
+    });
+    return (results ?? const [])
+        .map((e) => PrefetchResult.fromMap(e as Map))
+        .toList();
+  }
+
+  /// Limit the HTTP disk cache of the default session to [limitMB], or
+  /// leave its size to WebKit when null. Sessions have their own limit,
+  /// see [WebviewSession.diskCacheLimitMB]. Only supported on Linux.
+  static Future<void> setDefaultDiskCacheLimit(int? limitMB) async {
+    _init();
+    await _channel.invokeMethod('setDefaultDiskCacheLimit', {
+      'limitMB': limitMB ?? 0,
+    });
+  }
+
+  /// Keep the cookies of the default session in the SQLite file at [path].
+  /// Sessions have their own file, see [WebviewSession.cookieStoragePath].
+  /// Only supported on Linux.
+  static Future<void> setDefaultCookieStorage(String path) async {
+    _init();
+    await _channel.invokeMethod('setDefaultCookieStorage', {'path': path});
+  }
+
+  /// Discard idle webviews by [policy] to free their memory, or stop
+  /// discarding them if null. Only supported on Linux.
+  static Future<void> setDiscardPolicy(DiscardPolicy? policy) async {
+    _init();
+    await _channel.invokeMethod(
+        'setDiscardPolicy', policy?.toMap() ?? {'enabled': false});
+  }
+
+  /// Counters of the discarded webviews, see [setDiscardPolicy].
+  /// Only supported on Linux.
+  static Future<DiscardStats> getDiscardStats() async {
+    _init();
+    final result = await _channel.invokeMethod<Map>('getDiscardStats');
+    return DiscardStats.fromMap(result ?? const {});
+  }
+
   static Future<dynamic> _handleMethodCall(MethodCall call) async {
     final args = call.arguments as Map;
     final viewId = args['id'] as int;
@@ -103,12 +294,33 @@ class WebviewWindow {
         webview.notifyWebMessageReceived(message);
         break;
       case "onJavascriptWebMessageReceived":
-        final message = args['message'] as String;
-        webview.notifyWebMessageReceived(message);
+        webview.notifyWebMessageReceived(args['message']);
+        break;
+      case "onJavascriptWebMessagesReceived":
+        for (final message in args['messages'] as List) {
+          webview.notifyWebMessageReceived(message);
+        }
         break;
       case "onNavigationCompleted":
         webview.onNavigationCompleted();
         break;
+      case "onNavigationMetrics":
+        webview.onNavigationMetrics(args);
+        break;
+      case "onLoadProgress":
+        webview.onLoadProgress((args['progress'] as num).toDouble());
+        break;
+      case "onCookiesChanged":
+        webview.onCookiesChanged(args);
+        break;
+      case "onDownloadChanged":
+        webview.onDownloadChanged(args);
+        break;
+      case "onDiscardStateChanged":
+        webview.onDiscardStateChanged(args);
+        break;
+      case "onDownloadDestination":
+        return webview.onDownloadDestination(args);
       default:
         return;
     }
@@ -0,0 +1,47 @@
+/// Result of [WebviewWindow.addContentFilter].
+class ContentFilterResult {
+  final String identifier;
+
+  /// False if the filter compiled for an identical source earlier, also in
+  /// a previous run of the app, was reused.
+  final bool compiled;
+
+  /// Time spent compiling or loading the filter.
+  final Duration compileTime;
+
+  const ContentFilterResult({
+    required this.identifier,
+    required this.compiled,
+    required this.compileTime,
+  });
+
+  factory ContentFilterResult.fromMap(Map<dynamic, dynamic> map) {
+    final ms = (map['compileTimeMs'] as num?) ?? 0;
+    return ContentFilterResult(
+      identifier: map['identifier'] ?? '',
+      compiled: map['compiled'] ?? false,
+      compileTime: Duration(microseconds: (ms * 1000).round()),
+    );
+  }
+}
+
+/// Content filter counters of a webview.
+class ContentFilterStats {
+  /// Filters attached to the webview.
+  final int filters;
+
+  /// Requests blocked by the filters since the webview was created.
+  final int blockedRequests;
+
+  const ContentFilterStats({
+    required this.filters,
+    required this.blockedRequests,
+  });
+
+  factory ContentFilterStats.fromMap(Map<dynamic, dynamic> map) {
+    return ContentFilterStats(
+      filters: map['filters'] ?? 0,
+      blockedRequests: map['blockedRequests'] ?? 0,
+    );
+  }
+}
@@ -21,16 +21,16 @@ class WebviewCookie {
 
   factory WebviewCookie.fromJson(Map<String, dynamic> json) {
     return WebviewCookie(
-      name: json['name'],
-      value: json['value'],
-      domain: json['domain'],
+      name: json['name'] ?? '',
+      value: json['value'] ?? '',
+      domain: json['domain'] ?? '',
       expires: json['expires'] == null
           ? null
           : DateTime.fromMillisecondsSinceEpoch(
               ((json['expires'] as num) * 1000).toInt(),
             ),
       httpOnly: json['httpOnly'] ?? false,
-      path: json['path'],
+      path: json['path'] ?? '',
       secure: json['secure'] ?? false,
       sessionOnly: json['sessionOnly'] ?? false,
     );
@@ -50,3 +50,75 @@ class WebviewCookie {
     };
   }
 }
+
+/// Identifies a cookie that was removed.
+class WebviewCookieKey {
+  final String name;
+  final String domain;
+  final String path;
+
+  const WebviewCookieKey({
+    required this.name,
+    required this.domain,
+    required this.path,
+  });
+
+  factory WebviewCookieKey.fromMap(Map<dynamic, dynamic> map) {
+    return WebviewCookieKey(
+      name: map['name'] ?? '',
+      domain: map['domain'] ?? '',
+      path: map['path'] ?? '',
+    );
+  }
+}
+
+/// Differences of the cookie jar, see [Webview.setOnCookiesChangedCallback].
+class WebviewCookieChanges {
+  final List<WebviewCookie> added;
+
+  /// Cookies whose value, expiry or flags changed.
+  final List<WebviewCookie> modified;
+
+  final List<WebviewCookieKey> removed;
+
+  const WebviewCookieChanges({
+    required this.added,
+    required this.modified,
+    required this.removed,
+  });
+
+  factory WebviewCookieChanges.fromMap(Map<dynamic, dynamic> map) {
+    List<WebviewCookie> cookies(String key) =>
+        ((map[key] as List?) ?? const [])
+            .map((e) =>
+                WebviewCookie.fromJson((e as Map).cast<String, dynamic>()))
+            .toList();
+    return WebviewCookieChanges(
+      added: cookies('added'),
+      modified: cookies('modified'),
+      removed: ((map['removed'] as List?) ?? const [])
+          .map((e) => WebviewCookieKey.fromMap(e as Map))
+          .toList(),
+    );
+  }
+}
+
+/// Outcome of [Webview.setCookies], [Webview.deleteCookies],
+/// [Webview.exportCookies] and [Webview.importCookies].
+class CookieBatchResult {
+  /// Cookies handled.
+  final int count;
+
+  /// Cookies WebKit refused, or cookies to delete that were not in the jar,
+  /// included in [count].
+  final int failed;
+
+  const CookieBatchResult({required this.count, this.failed = 0});
+
+  factory CookieBatchResult.fromMap(Map<dynamic, dynamic> map) {
+    return CookieBatchResult(
+      count: map['count'] ?? 0,
+      failed: map['failed'] ?? 0,
+    );
+  }
+}
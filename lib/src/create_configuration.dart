@@ -1,4 +1,11 @@
+import 'dart:typed_data';
+
+import 'package:desktop_webview_window/src/memory_profile.dart';
+import 'package:desktop_webview_window/src/message_batching.dart';
 import 'package:desktop_webview_window/src/user_script.dart';
+import 'package:desktop_webview_window/src/webview.dart';
+import 'package:desktop_webview_window/src/webview_session.dart';
+import 'package:desktop_webview_window/src/webview_texture.dart';
 
 class ProxyConfiguration {
   final String host;
@@ -29,8 +36,36 @@ class CreateConfiguration {
 
   final bool headless;
 
+  /// Proxy of the webview's session. Without a [session] it applies to
+  /// every webview that has no session either.
   final ProxyConfiguration? proxy;
 
+  /// Run the webview in its own session instead of the shared default one.
+  final WebviewSession? session;
+
+  /// Deliver web messages in batches, see [MessageBatchingConfiguration].
+  /// Messages are delivered one by one when null.
+  final MessageBatchingConfiguration? messageBatching;
+
+  /// Cache and memory pressure settings of the webview. Webviews with the
+  /// same profile and [session] share them.
+  final MemoryProfile memoryProfile;
+
+  /// Memory limit of the web process in MB, overriding the one of
+  /// [memoryProfile]. The web process starts releasing memory as it
+  /// approaches the limit. Null keeps the limit of the profile.
+  final int? memoryLimitMB;
+
+  /// Render the webview into a Flutter texture instead of its own window.
+  /// The webview is headless and shown by a [WebviewTextureView]. Only
+  /// supported on Linux.
+  final TextureConfiguration? texture;
+
+  /// History of a [Webview.saveSessionState], restored before the first
+  /// load. The webview opens its current page, a later [Webview.launch]
+  /// navigates as usual. Only supported on Linux.
+  final Uint8List? sessionState;
+
   const CreateConfiguration({
     this.windowWidth = 1280,
     this.windowHeight = 720,
@@ -43,6 +78,12 @@ class CreateConfiguration {
     this.userScripts = const [],
     this.headless = false,
     this.proxy,
+    this.session,
+    this.messageBatching,
+    this.memoryProfile = MemoryProfile.standard,
+    this.memoryLimitMB,
+    this.texture,
+    this.sessionState,
   });
 
   factory CreateConfiguration.platform() {
@@ -61,5 +102,11 @@ class CreateConfiguration {
         "userScripts": userScripts.map((e) => e.toMap()).toList(),
         "headless": headless,
         "proxy": proxy?.toMap(),
+        "session": session?.toMap(),
+        "messageBatching": messageBatching?.toMap(),
+        "memoryProfile": memoryProfile.index,
+        "memoryLimitMB": memoryLimitMB ?? 0,
+        "texture": texture?.toMap(),
+        "sessionState": sessionState,
       };
 }
@@ -0,0 +1,108 @@
+/// When idle webviews are discarded, see [WebviewWindow.setDiscardPolicy].
+///
+/// A discarded webview keeps its window and history, but its web process
+/// is terminated. It is restored when it is shown or receives a call.
+class DiscardPolicy {
+  /// Discard webviews without calls, loads or showing for this long. Null
+  /// leaves idle webviews alone.
+  final Duration? idleTimeout;
+
+  /// Discard webviews idle for [pressureMinIdle] when the system reports
+  /// low memory.
+  final bool onMemoryPressure;
+
+  final Duration pressureMinIdle;
+
+  /// Also discard webviews that are on screen or rendered into a texture.
+  final bool discardVisible;
+
+  const DiscardPolicy({
+    this.idleTimeout = const Duration(minutes: 5),
+    this.onMemoryPressure = true,
+    this.pressureMinIdle = const Duration(seconds: 30),
+    this.discardVisible = false,
+  });
+
+  Map<String, dynamic> toMap() => {
+        'enabled': true,
+        'idleTimeoutMs': idleTimeout?.inMilliseconds ?? 0,
+        'onMemoryPressure': onMemoryPressure,
+        'pressureMinIdleMs': pressureMinIdle.inMilliseconds,
+        'discardVisible': discardVisible,
+      };
+}
+
+/// A change of [Webview.isDiscarded].
+class WebviewDiscardState {
+  final bool discarded;
+
+  /// The page of a restored webview is still loading.
+  final bool restoring;
+
+  /// Memory of the terminated web process, null if unknown.
+  final int? reclaimedBytes;
+
+  /// Time from the restore to the loaded page, once [restoring] is done.
+  final Duration? restoreTime;
+
+  const WebviewDiscardState({
+    required this.discarded,
+    this.restoring = false,
+    this.reclaimedBytes,
+    this.restoreTime,
+  });
+
+  factory WebviewDiscardState.fromMap(Map<dynamic, dynamic> map) {
+    final restoreMs = map['restoreMs'] as num?;
+    return WebviewDiscardState(
+      discarded: map['discarded'] ?? false,
+      restoring: map['restoring'] ?? false,
+      reclaimedBytes: map['reclaimedBytes'],
+      restoreTime: restoreMs == null
+          ? null
+          : Duration(microseconds: (restoreMs * 1000).round()),
+    );
+  }
+}
+
+/// Counters of [WebviewWindow.getDiscardStats].
+class DiscardStats {
+  /// Webviews discarded right now.
+  final int discarded;
+
+  final int discards;
+
+  final int restores;
+
+  /// Memory of the terminated web processes, of those it was known for.
+  final int reclaimedBytes;
+
+  final double lastRestoreMs;
+
+  final double averageRestoreMs;
+
+  /// Low memory warnings received.
+  final int pressureEvents;
+
+  const DiscardStats({
+    required this.discarded,
+    required this.discards,
+    required this.restores,
+    required this.reclaimedBytes,
+    required this.lastRestoreMs,
+    required this.averageRestoreMs,
+    required this.pressureEvents,
+  });
+
+  factory DiscardStats.fromMap(Map<dynamic, dynamic> map) {
+    return DiscardStats(
+      discarded: map['discarded'] ?? 0,
+      discards: map['discards'] ?? 0,
+      restores: map['restores'] ?? 0,
+      reclaimedBytes: map['reclaimedBytes'] ?? 0,
+      lastRestoreMs: (map['lastRestoreMs'] as num? ?? 0).toDouble(),
+      averageRestoreMs: (map['averageRestoreMs'] as num? ?? 0).toDouble(),
+      pressureEvents: map['pressureEvents'] ?? 0,
+    );
+  }
+}
@@ -0,0 +1,57 @@
+import 'dart:ui';
+
+/// Parts of an element read by [Webview.queryDom]. The order matches the
+/// bits of DomQueryField in linux/web_extension/web_extension_protocol.h.
+enum DomQueryField {
+  /// The `textContent` of the element.
+  text,
+
+  attributes,
+
+  /// The bounding client rect, in CSS pixels of the viewport.
+  bounds,
+
+  /// The `outerHTML` of the element.
+  html,
+}
+
+/// An element found by [Webview.queryDom]. Fields that were not asked for
+/// are null.
+class DomElement {
+  /// Upper case tag name, e.g. `DIV`.
+  final String tag;
+
+  final String? text;
+
+  final Map<String, String>? attributes;
+
+  final Rect? bounds;
+
+  final String? html;
+
+  const DomElement({
+    required this.tag,
+    this.text,
+    this.attributes,
+    this.bounds,
+    this.html,
+  });
+
+  factory DomElement.fromMap(Map<dynamic, dynamic> map) {
+    final bounds = map['bounds'] as Map?;
+    return DomElement(
+      tag: map['tag'] ?? '',
+      text: map['text'],
+      attributes: (map['attributes'] as Map?)?.cast<String, String>(),
+      bounds: bounds == null
+          ? null
+          : Rect.fromLTWH(
+              (bounds['x'] as num).toDouble(),
+              (bounds['y'] as num).toDouble(),
+              (bounds['width'] as num).toDouble(),
+              (bounds['height'] as num).toDouble(),
+            ),
+      html: map['html'],
+    );
+  }
+}
@@ -0,0 +1,112 @@
+/// How a webview saves its downloads, see [Webview.setDownloadHandler].
+class DownloadConfiguration {
+  /// Directory downloads are saved in, the XDG download directory if null.
+  final String? directory;
+
+  /// Replace existing files instead of adding a number to the name.
+  final bool overwrite;
+
+  /// Minimum interval between progress updates of one download. State
+  /// changes are always reported right away. [Duration.zero] reports only
+  /// the state changes.
+  final Duration progressInterval;
+
+  const DownloadConfiguration({
+    this.directory,
+    this.overwrite = false,
+    this.progressInterval = const Duration(milliseconds: 100),
+  });
+
+  Map<String, dynamic> toMap() => {
+        'directory': directory,
+        'overwrite': overwrite,
+        'progressIntervalMs': progressInterval.inMilliseconds,
+      };
+}
+
+enum DownloadState {
+  inProgress,
+  finished,
+  failed,
+  cancelled,
+}
+
+/// A download of a webview.
+class WebviewDownload {
+  final int id;
+
+  final String url;
+
+  /// Where the file is written, null until the destination is decided.
+  final String? path;
+
+  final int receivedBytes;
+
+  /// Size announced by the server, null if unknown.
+  final int? totalBytes;
+
+  final DownloadState state;
+
+  /// Why a [DownloadState.failed] download failed.
+  final String? error;
+
+  const WebviewDownload({
+    required this.id,
+    required this.url,
+    this.path,
+    required this.receivedBytes,
+    this.totalBytes,
+    required this.state,
+    this.error,
+  });
+
+  /// Fraction received, null if the size is unknown.
+  double? get progress {
+    final total = totalBytes;
+    if (total == null || total <= 0) {
+      return null;
+    }
+    return (receivedBytes / total).clamp(0.0, 1.0);
+  }
+
+  factory WebviewDownload.fromMap(Map<dynamic, dynamic> map) {
+    return WebviewDownload(
+      id: map['downloadId'] as int,
+      url: map['url'] ?? '',
+      path: map['path'],
+      receivedBytes: map['receivedBytes'] ?? 0,
+      totalBytes: map['totalBytes'],
+      state: DownloadState.values[map['state'] ?? 0],
+      error: map['error'],
+    );
+  }
+}
+
+/// A download waiting for [DownloadDestinationCallback] to pick its file.
+class DownloadDestinationRequest {
+  final WebviewDownload download;
+
+  /// File name proposed by the server.
+  final String suggestedFilename;
+
+  final String? mimeType;
+
+  /// Where the download goes by [DownloadConfiguration].
+  final String defaultPath;
+
+  const DownloadDestinationRequest({
+    required this.download,
+    required this.suggestedFilename,
+    this.mimeType,
+    required this.defaultPath,
+  });
+
+  factory DownloadDestinationRequest.fromMap(Map<dynamic, dynamic> map) {
+    return DownloadDestinationRequest(
+      download: WebviewDownload.fromMap(map),
+      suggestedFilename: map['suggestedFilename'] ?? '',
+      mimeType: map['mimeType'],
+      defaultPath: map['defaultPath'] ?? '',
+    );
+  }
+}
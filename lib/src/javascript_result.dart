@@ -0,0 +1,17 @@
+/// Outcome of one script of [Webview.evaluateJavaScriptBatch].
+class JavaScriptResult {
+  /// The value of the script, converted like the result of
+  /// [Webview.evaluateJavaScriptValue].
+  final dynamic value;
+
+  /// Why the script failed, null if it succeeded.
+  final String? error;
+
+  const JavaScriptResult({this.value, this.error});
+
+  bool get isError => error != null;
+
+  factory JavaScriptResult.fromMap(Map<dynamic, dynamic> map) {
+    return JavaScriptResult(value: map['value'], error: map['error']);
+  }
+}
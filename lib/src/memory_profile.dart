@@ -0,0 +1,52 @@
+/// Trades memory for speed of the web processes behind a webview.
+enum MemoryProfile {
+  /// WebKit defaults.
+  standard,
+
+  /// No resource or page caches, for webviews showing a single document
+  /// such as a login page or a help viewer.
+  documentViewer,
+
+  /// Like [documentViewer], and the web process starts releasing memory
+  /// early under a 256 MB limit. For kiosks and low memory devices.
+  lowMemory,
+
+  /// Like [standard], and the web process keeps its caches until it uses
+  /// 60% of its memory limit instead of a third, so back/forward
+  /// navigation stays instant for longer. Needs WebKitGTK 2.34, it is the
+  /// same as [standard] before.
+  browser,
+}
+
+/// Resident memory of the web processes behind a webview, in bytes.
+class WebviewMemoryUsage {
+  /// Resident set size.
+  final int rss;
+
+  /// Proportional set size, shared pages are split between processes.
+  final int pss;
+
+  /// Web processes the numbers were collected from.
+  final int processCount;
+
+  /// Whether the numbers belong to this webview only. When false they cover
+  /// every web process of the app. On Linux they are attributed once the
+  /// web extension has reported the process of the webview.
+  final bool attributed;
+
+  const WebviewMemoryUsage({
+    required this.rss,
+    required this.pss,
+    required this.processCount,
+    required this.attributed,
+  });
+
+  factory WebviewMemoryUsage.fromMap(Map<dynamic, dynamic> map) {
+    return WebviewMemoryUsage(
+      rss: map['rss'] ?? 0,
+      pss: map['pss'] ?? 0,
+      processCount: map['processCount'] ?? 0,
+      attributed: map['attributed'] ?? false,
+    );
+  }
+}
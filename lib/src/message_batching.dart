@@ -0,0 +1,128 @@
+/// What happens to a web message that arrives while the batching queue is
+/// full.
+enum MessageOverflowPolicy {
+  /// Discard the oldest queued message.
+  dropOldest,
+
+  /// Discard the message that just arrived.
+  dropNewest,
+
+  /// Send another batch right away, even if the previous one has not been
+  /// handled yet.
+  block,
+}
+
+/// Batches `window.webkit.messageHandlers.msgToNative.postMessage` messages
+/// into one platform channel call.
+///
+/// Queued messages are flushed after [flushInterval], or as soon as
+/// [maxBatchSize] messages are queued. A new batch is only sent once the
+/// previous one has been handled on the Dart side, so at most [maxQueueSize]
+/// messages wait natively before [overflowPolicy] applies.
+class MessageBatchingConfiguration {
+  final Duration flushInterval;
+  final int maxBatchSize;
+  final int maxQueueSize;
+  final MessageOverflowPolicy overflowPolicy;
+
+  const MessageBatchingConfiguration({
+    this.flushInterval = const Duration(milliseconds: 16),
+    this.maxBatchSize = 64,
+    this.maxQueueSize = 1024,
+    this.overflowPolicy = MessageOverflowPolicy.dropOldest,
+  });
+
+  Map<String, dynamic> toMap() => {
+        'flushIntervalMs': flushInterval.inMilliseconds,
+        'maxBatchSize': maxBatchSize,
+        'maxQueueSize': maxQueueSize,
+        'overflowPolicy': overflowPolicy.index,
+      };
+}
+
+/// Web message delivery counters of one webview.
+class WebMessageStats {
+  /// Messages posted by the page.
+  final int received;
+
+  /// Messages sent to Dart.
+  final int delivered;
+
+  /// Messages discarded by the overflow policy.
+  final int dropped;
+
+  /// Batches sent to Dart.
+  final int batches;
+
+  /// Platform channel calls saved by batching.
+  final int coalesced;
+
+  /// Messages currently waiting natively.
+  final int queued;
+
+  /// Counters of [Webview.postWebMessageAsString] and
+  /// [Webview.postWebMessageAsJson].
+  final PageMessageStats toPage;
+
+  const WebMessageStats({
+    required this.received,
+    required this.delivered,
+    required this.dropped,
+    required this.batches,
+    required this.coalesced,
+    required this.queued,
+    this.toPage = const PageMessageStats(),
+  });
+
+  factory WebMessageStats.fromMap(Map<dynamic, dynamic> map) {
+    return WebMessageStats(
+      received: map['received'] ?? 0,
+      delivered: map['delivered'] ?? 0,
+      dropped: map['dropped'] ?? 0,
+      batches: map['batches'] ?? 0,
+      coalesced: map['coalesced'] ?? 0,
+      queued: map['queued'] ?? 0,
+      toPage: PageMessageStats.fromMap(map['toPage'] ?? const {}),
+    );
+  }
+}
+
+/// Delivery counters of the messages posted to the page.
+class PageMessageStats {
+  final int posted;
+
+  /// Messages dispatched to the page.
+  final int delivered;
+
+  /// Messages lost because their script failed, e.g. during a navigation.
+  final int failed;
+
+  /// Script evaluations that carried the delivered messages.
+  final int batches;
+
+  /// Messages waiting for the evaluation in flight.
+  final int queued;
+
+  /// Messages of the evaluation in flight.
+  final int inFlight;
+
+  const PageMessageStats({
+    this.posted = 0,
+    this.delivered = 0,
+    this.failed = 0,
+    this.batches = 0,
+    this.queued = 0,
+    this.inFlight = 0,
+  });
+
+  factory PageMessageStats.fromMap(Map<dynamic, dynamic> map) {
+    return PageMessageStats(
+      posted: map['posted'] ?? 0,
+      delivered: map['delivered'] ?? 0,
+      failed: map['failed'] ?? 0,
+      batches: map['batches'] ?? 0,
+      queued: map['queued'] ?? 0,
+      inFlight: map['inFlight'] ?? 0,
+    );
+  }
+}
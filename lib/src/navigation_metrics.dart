@@ -0,0 +1,69 @@
+/// Timing of one navigation, see [Webview.setOnNavigationMetricsCallback].
+///
+/// Times are measured from the start of the navigation and are null if the
+/// navigation did not reach that point.
+class NavigationMetrics {
+  /// The URL the navigation ended at.
+  final String url;
+
+  /// Start of the navigation, on the monotonic clock of the platform.
+  final Duration startTime;
+
+  /// Time of the last redirect.
+  final Duration? redirectTime;
+
+  /// Time the first bytes of the page arrived.
+  final Duration? commitTime;
+
+  /// Time the page and its resources finished loading or the load failed.
+  final Duration? finishTime;
+
+  final int redirects;
+
+  /// Resources loaded for the page, including the page itself.
+  final int resources;
+
+  /// Sum of the Content-Length of the resources. Responses without one are
+  /// not counted.
+  final int resourceBytes;
+
+  final int failedResources;
+
+  /// Why the navigation failed, null if it succeeded.
+  final String? error;
+
+  const NavigationMetrics({
+    required this.url,
+    required this.startTime,
+    required this.redirectTime,
+    required this.commitTime,
+    required this.finishTime,
+    required this.redirects,
+    required this.resources,
+    required this.resourceBytes,
+    required this.failedResources,
+    required this.error,
+  });
+
+  static Duration? _duration(dynamic ms) {
+    if (ms is! num || ms < 0) {
+      return null;
+    }
+    return Duration(microseconds: (ms * 1000).round());
+  }
+
+  factory NavigationMetrics.fromMap(Map<dynamic, dynamic> map) {
+    return NavigationMetrics(
+      url: map['url'] ?? '',
+      startTime: Duration(microseconds: map['startTimeUs'] ?? 0),
+      redirectTime: _duration(map['redirectMs']),
+      commitTime: _duration(map['commitMs']),
+      finishTime: _duration(map['finishMs']),
+      redirects: map['redirects'] ?? 0,
+      resources: map['resources'] ?? 0,
+      resourceBytes: map['resourceBytes'] ?? 0,
+      failedResources: map['failedResources'] ?? 0,
+      error: map['error'],
+    );
+  }
+}
@@ -0,0 +1,87 @@
+/// Limits of [Webview.startNetworkRecording].
+class NetworkRecordingConfiguration {
+  /// The oldest entries are dropped beyond this many.
+  final int maxEntries;
+
+  /// Read every response body, for its exact size and to include it in
+  /// the HAR file. Without this, sizes come from Content-Length.
+  final bool fetchBodies;
+
+  /// Larger bodies are measured but left out of the HAR file.
+  final int maxBodyBytes;
+
+  /// The bodies of the oldest entries are left out of the HAR file beyond
+  /// this many bytes of bodies in total. Their entries are kept.
+  final int maxTotalBodyBytes;
+
+  const NetworkRecordingConfiguration({
+    this.maxEntries = 1000,
+    this.fetchBodies = false,
+    this.maxBodyBytes = 1 << 20,
+    this.maxTotalBodyBytes = 64 << 20,
+  });
+
+  Map<String, dynamic> toMap() => {
+        'maxEntries': maxEntries,
+        'fetchBodies': fetchBodies,
+        'maxBodyBytes': maxBodyBytes,
+        'maxTotalBodyBytes': maxTotalBodyBytes,
+      };
+}
+
+class NetworkRecordingStats {
+  final bool recording;
+
+  /// Completed entries in the recording.
+  final int entries;
+
+  /// Loads still in flight.
+  final int pending;
+
+  /// Entries dropped because the recording was full.
+  final int dropped;
+
+  /// Memory held by recorded bodies.
+  final int bodyBytes;
+
+  /// Bodies dropped to stay within
+  /// [NetworkRecordingConfiguration.maxTotalBodyBytes].
+  final int droppedBodies;
+
+  const NetworkRecordingStats({
+    required this.recording,
+    required this.entries,
+    required this.pending,
+    required this.dropped,
+    required this.bodyBytes,
+    this.droppedBodies = 0,
+  });
+
+  factory NetworkRecordingStats.fromMap(Map<dynamic, dynamic> map) {
+    return NetworkRecordingStats(
+      recording: map['recording'] ?? false,
+      entries: map['entries'] ?? 0,
+      pending: map['pending'] ?? 0,
+      dropped: map['dropped'] ?? 0,
+      bodyBytes: map['bodyBytes'] ?? 0,
+      droppedBodies: map['droppedBodies'] ?? 0,
+    );
+  }
+}
+
+/// Outcome of [Webview.exportHar].
+class HarExportResult {
+  final int entries;
+
+  /// Size of the written file.
+  final int bytes;
+
+  const HarExportResult({required this.entries, required this.bytes});
+
+  factory HarExportResult.fromMap(Map<dynamic, dynamic> map) {
+    return HarExportResult(
+      entries: map['entries'] ?? 0,
+      bytes: map['bytes'] ?? 0,
+    );
+  }
+}
@@ -0,0 +1,114 @@
+import 'dart:typed_data';
+
+enum SnapshotRegion {
+  /// The part of the page inside the webview.
+  visible,
+
+  /// The whole page.
+  fullDocument,
+}
+
+enum SnapshotFormat {
+  /// Premultiplied 32-bit pixels, bytes in B G R A order, rows packed
+  /// without padding.
+  bgra,
+  png,
+}
+
+/// Pixels of a webview, see [Webview.takeSnapshot].
+class WebviewSnapshot {
+  final int width;
+  final int height;
+  final SnapshotFormat format;
+  final Uint8List bytes;
+
+  const WebviewSnapshot({
+    required this.width,
+    required this.height,
+    required this.format,
+    required this.bytes,
+  });
+
+  factory WebviewSnapshot.fromMap(Map<dynamic, dynamic> map) {
+    return WebviewSnapshot(
+      width: map['width'],
+      height: map['height'],
+      format:
+          map['format'] == 'png' ? SnapshotFormat.png : SnapshotFormat.bgra,
+      bytes: map['bytes'],
+    );
+  }
+}
+
+/// Outcome of one URL of [WebviewWindow.snapshotUrls].
+class SnapshotJobResult {
+  final String url;
+
+  /// Null if the page failed to load or timed out, see [error].
+  final WebviewSnapshot? snapshot;
+
+  final String? error;
+
+  /// Time until the page finished loading.
+  final Duration loadTime;
+
+  /// Time spent taking the snapshot.
+  final Duration snapshotTime;
+
+  /// Time from starting the job to its result.
+  final Duration totalTime;
+
+  const SnapshotJobResult({
+    required this.url,
+    this.snapshot,
+    this.error,
+    required this.loadTime,
+    required this.snapshotTime,
+    required this.totalTime,
+  });
+
+  factory SnapshotJobResult.fromMap(Map<dynamic, dynamic> map) {
+    Duration duration(String key) =>
+        Duration(microseconds: (((map[key] as num?) ?? 0) * 1000).round());
+    return SnapshotJobResult(
+      url: map['url'] ?? '',
+      snapshot: map['bytes'] != null ? WebviewSnapshot.fromMap(map) : null,
+      error: map['error'],
+      loadTime: duration('loadMs'),
+      snapshotTime: duration('snapshotMs'),
+      totalTime: duration('totalMs'),
+    );
+  }
+}
+
+/// Result of loading one URL with [WebviewWindow.prefetch].
+class PrefetchResult {
+  final String url;
+
+  /// Null if the page loaded.
+  final String? error;
+
+  /// Time until the page finished loading.
+  final Duration loadTime;
+
+  /// Time from starting the load to its result.
+  final Duration totalTime;
+
+  const PrefetchResult({
+    required this.url,
+    this.error,
+    required this.loadTime,
+    required this.totalTime,
+  });
+
+  factory PrefetchResult.fromMap(Map<dynamic, dynamic> map) {
+    Duration duration(String key) =>
+        Duration(microseconds: (((map[key] as num?) ?? 0) * 1000).round());
+    return PrefetchResult(
+      url: map['url'] ?? '',
+      error: map['error'],
+      loadTime: duration('loadMs'),
+      totalTime: duration('totalMs'),
+    );
+  }
+}
@@ -0,0 +1,42 @@
+/// What happens to a navigation matched by a [UrlRule].
+enum UrlRuleAction {
+  allow,
+  block,
+
+  /// Hold the navigation until the callback set with
+  /// [Webview.setOnUrlRequestCallback] returns whether to allow it.
+  ask,
+}
+
+enum _UrlRuleType { host, prefix, glob }
+
+/// A rule deciding navigations natively, see [Webview.setUrlRules].
+class UrlRule {
+  final _UrlRuleType _type;
+  final String pattern;
+  final UrlRuleAction action;
+
+  /// Matches URLs on [host] and all its subdomains: `example.com` matches
+  /// `https://www.example.com/` but not `https://badexample.com/`. `*`
+  /// matches every URL with a host, an empty [host] matches nothing.
+  const UrlRule.host(String host, this.action)
+      : _type = _UrlRuleType.host,
+        pattern = host;
+
+  /// Matches URLs starting with [prefix].
+  const UrlRule.prefix(String prefix, this.action)
+      : _type = _UrlRuleType.prefix,
+        pattern = prefix;
+
+  /// Matches whole URLs, `*` matches any run of characters and `?` a single
+  /// one: `*.pdf` matches every URL ending in .pdf.
+  const UrlRule.glob(String glob, this.action)
+      : _type = _UrlRuleType.glob,
+        pattern = glob;
+
+  Map toMap() => {
+        'type': _type.index,
+        'pattern': pattern,
+        'action': action.index,
+      };
+}
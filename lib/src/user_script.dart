@@ -24,3 +24,50 @@ class UserScript {
     };
   }
 }
+
+/// Sharing counters of [WebviewWindow.getUserScriptStats]. Webviews that
+/// inject the same source with the same options share one native script.
+class UserScriptStats {
+  /// Distinct native scripts.
+  final int scripts;
+
+  /// Scripts injected into webviews, counting shared ones once per webview.
+  final int references;
+
+  /// Size of the distinct script sources.
+  final int sourceBytes;
+
+  /// Source bytes not duplicated thanks to sharing.
+  final int savedBytes;
+
+  /// Scripts served from the registry.
+  final int hits;
+
+  /// Scripts that had to be created.
+  final int misses;
+
+  /// Estimated time saved by not creating shared scripts again.
+  final Duration savedTime;
+
+  const UserScriptStats({
+    required this.scripts,
+    required this.references,
+    required this.sourceBytes,
+    required this.savedBytes,
+    required this.hits,
+    required this.misses,
+    required this.savedTime,
+  });
+
+  factory UserScriptStats.fromMap(Map<dynamic, dynamic> map) {
+    return UserScriptStats(
+      scripts: map['scripts'] ?? 0,
+      references: map['references'] ?? 0,
+      sourceBytes: map['sourceBytes'] ?? 0,
+      savedBytes: map['savedBytes'] ?? 0,
+      hits: map['hits'] ?? 0,
+      misses: map['misses'] ?? 0,
+      savedTime: Duration(microseconds: map['savedTimeUs'] ?? 0),
+    );
+  }
+}
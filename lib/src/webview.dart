@@ -1,4 +1,17 @@
+import 'package:desktop_webview_window/src/content_filter.dart';
 import 'package:desktop_webview_window/src/cookie.dart';
+import 'package:desktop_webview_window/src/discard.dart';
+import 'package:desktop_webview_window/src/dom_query.dart';
+import 'package:desktop_webview_window/src/download.dart';
+import 'package:desktop_webview_window/src/javascript_result.dart';
+import 'package:desktop_webview_window/src/memory_profile.dart';
+import 'package:desktop_webview_window/src/message_batching.dart';
+import 'package:desktop_webview_window/src/navigation_metrics.dart';
+import 'package:desktop_webview_window/src/network_recording.dart';
+import 'package:desktop_webview_window/src/snapshot.dart';
+import 'package:desktop_webview_window/src/url_rule.dart';
+import 'package:desktop_webview_window/src/user_script.dart';
+import 'package:desktop_webview_window/src/webview_texture.dart';
 import 'package:flutter/foundation.dart';
 
 /// Handle custom message from JavaScript in your app.
@@ -17,6 +30,32 @@ typedef OnUrlRequestCallback = bool Function(String url);
 /// [message] constains the webmessage
 typedef OnWebMessageReceivedCallback = void Function(String message);
 
+/// Callback when WebView receives a web message of any type.
+/// [message] is a [String], [bool], [num], `null`, a typed data list for
+/// ArrayBuffers and typed arrays, or a [List]/[Map] of those values.
+typedef OnWebMessageDataReceivedCallback = void Function(dynamic message);
+
+/// Callback with the timing of a finished navigation.
+typedef OnNavigationMetricsCallback = void Function(NavigationMetrics metrics);
+
+/// Callback with the estimated load progress of the page, from 0 to 1.
+typedef OnLoadProgressCallback = void Function(double progress);
+
+/// Callback with the state of a download whenever it changes, and with its
+/// progress while it runs.
+typedef OnDownloadChangedCallback = void Function(WebviewDownload download);
+
+/// Returns the file a download is written to, or null to cancel it.
+typedef DownloadDestinationCallback = Future<String?> Function(
+    DownloadDestinationRequest request);
+
+/// Callback with the cookies that changed since the previous call.
+typedef OnCookiesChangedCallback = void Function(WebviewCookieChanges changes);
+
+/// Callback when the webview is discarded or restored.
+typedef OnDiscardStateChangedCallback = void Function(
+    WebviewDiscardState state);
+
 abstract class Webview {
   Future<void> get onClose;
 
@@ -45,6 +84,20 @@ abstract class Webview {
 
   void addScriptToExecuteOnDocumentCreated(String javaScript);
 
+  /// Inject [script] into every page loaded from now on.
+  ///
+  /// Returns an id for [removeUserScript] and [replaceUserScript]. Webviews
+  /// injecting the same script share it natively. Only supported on Linux.
+  Future<int> addUserScript(UserScript script);
+
+  /// Stop injecting the script [scriptId]. Returns false if there is no
+  /// such script.
+  Future<bool> removeUserScript(int scriptId);
+
+  /// Inject [script] instead of the script [scriptId], keeping its id and
+  /// position. Returns false if there is no such script.
+  Future<bool> replaceUserScript(int scriptId, UserScript script);
+
   /// Append a string to the webview's user-agent.
   Future<void> setApplicationNameForUserAgent(String applicationName);
 
@@ -80,22 +133,248 @@ abstract class Webview {
 
   void setOnUrlRequestCallback(OnUrlRequestCallback? callback);
 
+  /// Register a callback that receives the timing of every navigation once
+  /// it finished. Null stops measuring. Only supported on Linux.
+  Future<void> setOnNavigationMetricsCallback(
+      OnNavigationMetricsCallback? callback);
+
+  /// Register a callback that receives the load progress of the page at
+  /// most once per [interval], and always when loading completes. Null
+  /// stops the updates. Only supported on Linux.
+  Future<void> setOnLoadProgressCallback(
+    OnLoadProgressCallback? callback, {
+    Duration interval = const Duration(milliseconds: 100),
+  });
+
+  /// Decide navigations natively with [rules], without a round trip to Dart.
+  ///
+  /// The first matching rule wins, navigations no rule matches get
+  /// [defaultAction]. Only navigations whose action is [UrlRuleAction.ask]
+  /// reach the [OnUrlRequestCallback], which then decides whether they load.
+  /// Null rules restore the default: every navigation loads and is reported
+  /// to the callback. Only supported on Linux.
+  Future<void> setUrlRules(
+    List<UrlRule>? rules, {
+    UrlRuleAction defaultAction = UrlRuleAction.allow,
+  });
+
   void addOnWebMessageReceivedCallback(OnWebMessageReceivedCallback callback);
 
   void removeOnWebMessageReceivedCallback(
       OnWebMessageReceivedCallback callback);
 
+  /// Register a callback that receives every web message, including
+  /// binary and structured ones that [addOnWebMessageReceivedCallback]
+  /// callbacks do not see.
+  void addOnWebMessageDataReceivedCallback(
+      OnWebMessageDataReceivedCallback callback);
+
+  void removeOnWebMessageDataReceivedCallback(
+      OnWebMessageDataReceivedCallback callback);
+
+  /// Deliver web messages in batches, or one by one if [configuration] is
+  /// null.
+  Future<void> setMessageBatching(MessageBatchingConfiguration? configuration);
+
+  /// Web message delivery counters.
+  Future<WebMessageStats> getMessageStats();
+
+  /// Resident memory of the web processes behind this webview.
+  Future<WebviewMemoryUsage> getMemoryUsage();
+
+  /// Whether the web process of this webview was terminated by the
+  /// [DiscardPolicy] or [discard].
+  bool get isDiscarded;
+
+  /// Terminate the web process of this webview until it is shown or
+  /// receives a call. Returns false if it is discarded already, playing
+  /// audio, or WebKitGTK is older than 2.34. Only supported on Linux.
+  Future<bool> discard();
+
+  /// Load the page of a discarded webview again. Any other call does the
+  /// same, this one does nothing else. Only supported on Linux.
+  Future<void> restore();
+
+  void setOnDiscardStateChangedCallback(
+      OnDiscardStateChangedCallback? callback);
+
+  /// Serialize the back/forward list of this webview, including form and
+  /// scroll state. Pass the result to [CreateConfiguration.sessionState]
+  /// to open a new webview with the same history. Only supported on Linux.
+  Future<Uint8List> saveSessionState();
+
+  /// Find the elements of the top level document matching the CSS
+  /// [selector] and read [fields] of them, at most [limit] elements.
+  ///
+  /// The query runs in the web process through the plugin's web extension,
+  /// without evaluating a script or serializing JSON. [attributes] limits
+  /// the attributes read, all are read if null. Needs WebKitGTK 2.28.
+  /// Only supported on Linux.
+  Future<List<DomElement>> queryDom(
+    String selector, {
+    Set<DomQueryField> fields = const {DomQueryField.text},
+    int? limit,
+    List<String>? attributes,
+  });
+
+  /// Counters of the filters added with [WebviewWindow.addContentFilter].
+  Future<ContentFilterStats> getContentFilterStats();
+
+  /// Id of the Flutter texture the webview renders into, if it was created
+  /// with [CreateConfiguration.texture]. Show it with [WebviewTextureView].
+  int? get textureId;
+
+  /// Resize a texture webview, in logical pixels.
+  Future<void> resizeTexture(int width, int height);
+
+  /// Forward pointer input to a texture webview.
+  Future<void> sendTexturePointerEvent(TexturePointerEvent event);
+
+  /// Forward keyboard input to a texture webview.
+  Future<void> sendTextureKeyEvent(TextureKeyEvent event);
+
+  /// Give a texture webview the keyboard focus, or take it away.
+  Future<void> setTextureFocus(bool focused);
+
+  /// Frame counters of a texture webview.
+  Future<WebviewTextureStats> getTextureStats();
+
+  /// Save the downloads of this webview as [configuration] says and
+  /// report them to [onChanged].
+  ///
+  /// With [onDestination], each download waits for it to pick the file;
+  /// this needs WebKitGTK 2.40, older releases use the directory of
+  /// [configuration]. Downloads still running when the webview closes are
+  /// cancelled. Only supported on Linux.
+  Future<void> setDownloadHandler({
+    DownloadConfiguration configuration = const DownloadConfiguration(),
+    OnDownloadChangedCallback? onChanged,
+    DownloadDestinationCallback? onDestination,
+  });
+
+  /// Download [url] with the cookies of this webview. Returns the download
+  /// id. Needs [setDownloadHandler].
+  Future<int> startDownload(String url);
+
+  /// Cancel a running download. Returns false if it is not running.
+  Future<bool> cancelDownload(int downloadId);
+
+  /// Start a failed or cancelled download again, to the same file.
+  ///
+  /// WebKit can not continue a partial file, so the download starts from
+  /// the beginning. Returns false if it is still running.
+  Future<bool> resumeDownload(int downloadId);
+
+  /// Every download since [setDownloadHandler] was called.
+  Future<List<WebviewDownload>> getDownloads();
+
+  /// Record every resource this webview loads from now on, dropping an
+  /// earlier recording. Only supported on Linux.
+  Future<void> startNetworkRecording([
+    NetworkRecordingConfiguration configuration =
+        const NetworkRecordingConfiguration(),
+  ]);
+
+  /// Stop recording new resources. Loads in flight are still completed and
+  /// the recording can still be exported.
+  Future<void> stopNetworkRecording();
+
+  /// Drop the recorded entries.
+  Future<void> clearNetworkRecording();
+
+  Future<NetworkRecordingStats> getNetworkRecordingStats();
+
+  /// Write the recording as a HAR 1.2 file to [path].
+  ///
+  /// The file is encoded and written natively, so bodies never pass
+  /// through the platform channel.
+  Future<HarExportResult> exportHar(String path);
+
+  /// Register a callback that receives the changes of the cookie jar of
+  /// this webview, optionally only those of [domain] and its subdomains.
+  ///
+  /// Changes are collected for [interval] before they are reported, so a
+  /// burst of changes arrives as one call. The first call lists the cookies
+  /// present when watching starts. Null stops watching. WebKitGTK releases
+  /// before 2.42 need a [domain] and only see the cookies sent to its root
+  /// path. Only supported on Linux.
+  Future<void> setOnCookiesChangedCallback(
+    OnCookiesChangedCallback? callback, {
+    String? domain,
+    Duration interval = const Duration(milliseconds: 250),
+  });
+
   /// Close the web view window.
   void close();
 
   /// evaluate JavaScript in the web view.
   Future<String?> evaluateJavaScript(String javaScript);
 
+  /// Evaluate [javaScript] and return its result as a Dart value instead of
+  /// JSON text.
+  ///
+  /// Objects become maps, arrays lists, and ArrayBuffers and typed arrays
+  /// typed data (Int32List, Int64List, Float64List or Uint8List).
+  /// Functions and objects that contain themselves become null. Results
+  /// holding more than 2^20 values throw a `PlatformException` instead.
+  /// Only supported on Linux.
+  Future<dynamic> evaluateJavaScriptValue(String javaScript);
+
+  /// Capture the pixels of the webview, also of a headless one.
+  /// Only supported on Linux.
+  Future<WebviewSnapshot> takeSnapshot({
+    SnapshotRegion region = SnapshotRegion.visible,
+    SnapshotFormat format = SnapshotFormat.png,
+  });
+
+  /// Evaluate [scripts] one after another in a single platform call.
+  ///
+  /// Returns one [JavaScriptResult] per script, in order. A failing script
+  /// does not stop the ones after it, nor does a result that is too large
+  /// to convert, see [evaluateJavaScriptValue]. Only supported on Linux.
+  Future<List<JavaScriptResult>> evaluateJavaScriptBatch(List<String> scripts);
+
   /// post a web message as String to the top level document in this WebView
+  ///
+  /// On Linux the page receives it as the data of a `message` event on
+  /// `window`. Messages posted in one burst are delivered together by a
+  /// single script evaluation, see [WebMessageStats.toPage].
   Future<void> postWebMessageAsString(String webMessage);
 
   /// post a web message as JSON to the top level document in this WebView
+  ///
+  /// On Linux the event data is the parsed value; invalid JSON is logged
+  /// to the page console and dropped.
   Future<void> postWebMessageAsJson(String webMessage);
 
-  Future<List<WebviewCookie>> getAllCookies();
+  /// Get the cookies of the current page.
+  ///
+  /// [domain] keeps only cookies of that domain or its subdomains,
+  /// [namePrefix] keeps only cookies whose name starts with it. [fields]
+  /// limits the serialized fields to the given [WebviewCookie] field names,
+  /// fields left out get their default value.
+  Future<List<WebviewCookie>> getAllCookies({
+    String? domain,
+    String? namePrefix,
+    List<String>? fields,
+  });
+
+  /// Add or replace [cookies] in the cookie jar of this webview in one call.
+  /// Cookies without a name or domain are skipped. Only supported on Linux.
+  Future<CookieBatchResult> setCookies(List<WebviewCookie> cookies);
+
+  /// Remove the cookies with the name, domain and path of [cookies], whatever
+  /// their value. Cookies that match none are counted in
+  /// [CookieBatchResult.failed]. Only supported on Linux.
+  Future<CookieBatchResult> deleteCookies(List<WebviewCookie> cookies);
+
+  /// Write every cookie of the cookie jar, session cookies included, to
+  /// [path] as a JSON list of [WebviewCookie.toJson] maps. Needs WebKitGTK
+  /// 2.42. Only supported on Linux.
+  Future<CookieBatchResult> exportCookies(String path);
+
+  /// Add the cookies of a file written by [exportCookies]. With [replace]
+  /// the cookie jar holds only these cookies afterwards, which needs
+  /// WebKitGTK 2.42. Only supported on Linux.
+  Future<CookieBatchResult> importCookies(String path, {bool replace = false});
 }
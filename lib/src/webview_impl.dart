@@ -2,7 +2,20 @@ import 'dart:async';
 import 'dart:convert';
 import 'dart:io';
 
+import 'package:desktop_webview_window/src/content_filter.dart';
 import 'package:desktop_webview_window/src/cookie.dart';
+import 'package:desktop_webview_window/src/discard.dart';
+import 'package:desktop_webview_window/src/dom_query.dart';
+import 'package:desktop_webview_window/src/download.dart';
+import 'package:desktop_webview_window/src/javascript_result.dart';
+import 'package:desktop_webview_window/src/memory_profile.dart';
+import 'package:desktop_webview_window/src/message_batching.dart';
+import 'package:desktop_webview_window/src/navigation_metrics.dart';
+import 'package:desktop_webview_window/src/network_recording.dart';
+import 'package:desktop_webview_window/src/snapshot.dart';
+import 'package:desktop_webview_window/src/url_rule.dart';
+import 'package:desktop_webview_window/src/user_script.dart';
+import 'package:desktop_webview_window/src/webview_texture.dart';
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
@@ -27,9 +40,31 @@ class WebviewImpl extends Webview {
 
   OnUrlRequestCallback? _onUrlRequestCallback = null;
 
+  OnNavigationMetricsCallback? _onNavigationMetrics;
+
+  OnLoadProgressCallback? _onLoadProgress;
+
+  Duration _loadProgressInterval = Duration.zero;
+
+  OnCookiesChangedCallback? _onCookiesChanged;
+
+  OnDownloadChangedCallback? _onDownloadChanged;
+
+  DownloadDestinationCallback? _onDownloadDestination;
+
+  OnDiscardStateChangedCallback? _onDiscardStateChanged;
+
+  bool _discarded = false;
+
   final Set<OnWebMessageReceivedCallback> _onWebMessageReceivedCallbacks = {};
 
-  WebviewImpl(this.viewId, this.channel);
+  final Set<OnWebMessageDataReceivedCallback>
+      _onWebMessageDataReceivedCallbacks = {};
+
+  @override
+  final int? textureId;
+
+  WebviewImpl(this.viewId, this.channel, {this.textureId});
 
   @override
   Future<void> get onClose => _closeCompleter.future;
@@ -69,8 +104,13 @@ class WebviewImpl extends Webview {
     }
   }
 
-  void notifyWebMessageReceived(String message) {
-    for (final callback in _onWebMessageReceivedCallbacks) {
+  void notifyWebMessageReceived(dynamic message) {
+    if (message is String) {
+      for (final callback in _onWebMessageReceivedCallbacks) {
+        callback(message);
+      }
+    }
+    for (final callback in _onWebMessageDataReceivedCallbacks) {
       callback(message);
     }
   }
@@ -79,6 +119,37 @@ class WebviewImpl extends Webview {
     _isNavigating.value = false;
   }
 
+  void onNavigationMetrics(Map<dynamic, dynamic> metrics) {
+    _onNavigationMetrics?.call(NavigationMetrics.fromMap(metrics));
+  }
+
+  void onLoadProgress(double progress) {
+    _onLoadProgress?.call(progress);
+  }
+
+  void onCookiesChanged(Map<dynamic, dynamic> changes) {
+    _onCookiesChanged?.call(WebviewCookieChanges.fromMap(changes));
+  }
+
+  void onDiscardStateChanged(Map<dynamic, dynamic> state) {
+    final discardState = WebviewDiscardState.fromMap(state);
+    _discarded = discardState.discarded;
+    _onDiscardStateChanged?.call(discardState);
+  }
+
+  void onDownloadChanged(Map<dynamic, dynamic> download) {
+    _onDownloadChanged?.call(WebviewDownload.fromMap(download));
+  }
+
+  Future<String?> onDownloadDestination(Map<dynamic, dynamic> request) async {
+    final parsed = DownloadDestinationRequest.fromMap(request);
+    final callback = _onDownloadDestination;
+    if (callback == null) {
+      return parsed.defaultPath;
+    }
+    return callback(parsed);
+  }
+
   @override
   ValueListenable<bool> get isNavigating => _isNavigating;
 
@@ -158,6 +229,34 @@ class WebviewImpl extends Webview {
     });
   }
 
+  @override
+  Future<int> addUserScript(UserScript script) async {
+    final scriptId = await channel.invokeMethod<int>("addUserScript", {
+      "viewId": viewId,
+      "script": script.toMap(),
+    });
+    return scriptId!;
+  }
+
+  @override
+  Future<bool> removeUserScript(int scriptId) async {
+    final removed = await channel.invokeMethod<bool>("removeUserScript", {
+      "viewId": viewId,
+      "scriptId": scriptId,
+    });
+    return removed == true;
+  }
+
+  @override
+  Future<bool> replaceUserScript(int scriptId, UserScript script) async {
+    final replaced = await channel.invokeMethod<bool>("replaceUserScript", {
+      "viewId": viewId,
+      "scriptId": scriptId,
+      "script": script.toMap(),
+    });
+    return replaced == true;
+  }
+
   @override
   Future<void> setApplicationNameForUserAgent(String applicationName) async {
     if (!(Platform.isWindows || Platform.isLinux || Platform.isMacOS)) {
@@ -238,6 +337,34 @@ class WebviewImpl extends Webview {
     _onUrlRequestCallback = callback;
   }
 
+  @override
+  Future<void> setOnNavigationMetricsCallback(
+      OnNavigationMetricsCallback? callback) async {
+    _onNavigationMetrics = callback;
+    await _updateNavigationMetrics();
+  }
+
+  @override
+  Future<void> setOnLoadProgressCallback(
+    OnLoadProgressCallback? callback, {
+    Duration interval = const Duration(milliseconds: 100),
+  }) async {
+    _onLoadProgress = callback;
+    _loadProgressInterval = interval;
+    await _updateNavigationMetrics();
+  }
+
+  Future<void> _updateNavigationMetrics() async {
+    await channel.invokeMethod("setNavigationMetrics", {
+      "viewId": viewId,
+      "metrics": _onNavigationMetrics != null,
+      // At least 1ms, 0 turns the updates off.
+      "progressIntervalMs": _onLoadProgress == null
+          ? 0
+          : _loadProgressInterval.inMilliseconds.clamp(1, 1 << 31),
+    });
+  }
+
   @override
   void addOnWebMessageReceivedCallback(OnWebMessageReceivedCallback callback) {
     _onWebMessageReceivedCallbacks.add(callback);
@@ -249,6 +376,255 @@ class WebviewImpl extends Webview {
     _onWebMessageReceivedCallbacks.remove(callback);
   }
 
+  @override
+  void addOnWebMessageDataReceivedCallback(
+      OnWebMessageDataReceivedCallback callback) {
+    _onWebMessageDataReceivedCallbacks.add(callback);
+  }
+
+  @override
+  void removeOnWebMessageDataReceivedCallback(
+      OnWebMessageDataReceivedCallback callback) {
+    _onWebMessageDataReceivedCallbacks.remove(callback);
+  }
+
+  @override
+  Future<void> setMessageBatching(
+      MessageBatchingConfiguration? configuration) {
+    return channel.invokeMethod("setMessageBatching", {
+      "viewId": viewId,
+      "configuration": configuration?.toMap(),
+    });
+  }
+
+  @override
+  Future<WebMessageStats> getMessageStats() async {
+    final result = await channel.invokeMethod<Map>("getMessageStats", {
+      "viewId": viewId,
+    });
+    return WebMessageStats.fromMap(result ?? const {});
+  }
+
+  @override
+  bool get isDiscarded => _discarded;
+
+  @override
+  Future<bool> discard() async {
+    final result = await channel.invokeMethod<bool>("discard", {
+      "viewId": viewId,
+    });
+    return result ?? false;
+  }
+
+  @override
+  Future<void> restore() {
+    return channel.invokeMethod("restore", {"viewId": viewId});
+  }
+
+  @override
+  Future<Uint8List> saveSessionState() async {
+    final result = await channel.invokeMethod<Uint8List>("saveSessionState", {
+      "viewId": viewId,
+    });
+    return result!;
+  }
+
+  @override
+  void setOnDiscardStateChangedCallback(
+      OnDiscardStateChangedCallback? callback) {
+    _onDiscardStateChanged = callback;
+  }
+
+  @override
+  Future<List<DomElement>> queryDom(
+    String selector, {
+    Set<DomQueryField> fields = const {DomQueryField.text},
+    int? limit,
+    List<String>? attributes,
+  }) async {
+    final result = await channel.invokeListMethod<Map>("queryDom", {
+      "viewId": viewId,
+      "selector": selector,
+      "fields": fields.fold<int>(0, (bits, e) => bits | 1 << e.index),
+      "limit": limit ?? 0,
+      if (attributes != null) "attributes": attributes,
+    });
+    return result?.map((e) => DomElement.fromMap(e)).toList() ?? [];
+  }
+
+  @override
+  Future<void> setUrlRules(
+    List<UrlRule>? rules, {
+    UrlRuleAction defaultAction = UrlRuleAction.allow,
+  }) async {
+    await channel.invokeMethod("setUrlRules", {
+      "viewId": viewId,
+      "rules": rules?.map((e) => e.toMap()).toList(),
+      "defaultAction": defaultAction.index,
+    });
+  }
+
+  @override
+  Future<ContentFilterStats> getContentFilterStats() async {
+    final result = await channel.invokeMethod<Map>("getContentFilterStats", {
+      "viewId": viewId,
+    });
+    return ContentFilterStats.fromMap(result ?? const {});
+  }
+
+  @override
+  Future<WebviewMemoryUsage> getMemoryUsage() async {
+    final result = await channel.invokeMethod<Map>("getMemoryUsage", {
+      "viewId": viewId,
+    });
+    return WebviewMemoryUsage.fromMap(result ?? const {});
+  }
+
+  @override
+  Future<void> resizeTexture(int width, int height) async {
+    await channel.invokeMethod("resizeTexture", {
+      "viewId": viewId,
+      "width": width,
+      "height": height,
+    });
+  }
+
+  @override
+  Future<void> sendTexturePointerEvent(TexturePointerEvent event) async {
+    await channel.invokeMethod("sendTexturePointerEvent", {
+      "viewId": viewId,
+      ...event.toMap(),
+    });
+  }
+
+  @override
+  Future<void> sendTextureKeyEvent(TextureKeyEvent event) async {
+    await channel.invokeMethod("sendTextureKeyEvent", {
+      "viewId": viewId,
+      ...event.toMap(),
+    });
+  }
+
+  @override
+  Future<void> setTextureFocus(bool focused) async {
+    await channel.invokeMethod("setTextureFocus", {
+      "viewId": viewId,
+      "focused": focused,
+    });
+  }
+
+  @override
+  Future<WebviewTextureStats> getTextureStats() async {
+    final result = await channel.invokeMethod<Map>("getTextureStats", {
+      "viewId": viewId,
+    });
+    return WebviewTextureStats.fromMap(result ?? const {});
+  }
+
+  @override
+  Future<void> setOnCookiesChangedCallback(
+    OnCookiesChangedCallback? callback, {
+    String? domain,
+    Duration interval = const Duration(milliseconds: 250),
+  }) async {
+    _onCookiesChanged = callback;
+    await channel.invokeMethod("setCookieWatch", {
+      "viewId": viewId,
+      "enabled": callback != null,
+      if (domain != null) "domain": domain,
+      "intervalMs": interval.inMilliseconds,
+    });
+  }
+
+  @override
+  Future<void> setDownloadHandler({
+    DownloadConfiguration configuration = const DownloadConfiguration(),
+    OnDownloadChangedCallback? onChanged,
+    DownloadDestinationCallback? onDestination,
+  }) async {
+    _onDownloadChanged = onChanged;
+    _onDownloadDestination = onDestination;
+    await channel.invokeMethod("setDownloadConfig", {
+      "viewId": viewId,
+      ...configuration.toMap(),
+      "askDestination": onDestination != null,
+    });
+  }
+
+  @override
+  Future<int> startDownload(String url) async {
+    final downloadId = await channel.invokeMethod<int>("startDownload", {
+      "viewId": viewId,
+      "url": url,
+    });
+    return downloadId!;
+  }
+
+  @override
+  Future<bool> cancelDownload(int downloadId) async {
+    final cancelled = await channel.invokeMethod<bool>("cancelDownload", {
+      "viewId": viewId,
+      "downloadId": downloadId,
+    });
+    return cancelled ?? false;
+  }
+
+  @override
+  Future<bool> resumeDownload(int downloadId) async {
+    final resumed = await channel.invokeMethod<bool>("resumeDownload", {
+      "viewId": viewId,
+      "downloadId": downloadId,
+    });
+    return resumed ?? false;
+  }
+
+  @override
+  Future<List<WebviewDownload>> getDownloads() async {
+    final result = await channel.invokeMethod<List>("getDownloads", {
+      "viewId": viewId,
+    });
+    return (result ?? const [])
+        .map((e) => WebviewDownload.fromMap(e as Map))
+        .toList();
+  }
+
+  @override
+  Future<void> startNetworkRecording([
+    NetworkRecordingConfiguration configuration =
+        const NetworkRecordingConfiguration(),
+  ]) async {
+    await channel.invokeMethod("startNetworkRecording", {
+      "viewId": viewId,
+      ...configuration.toMap(),
+    });
+  }
+
+  @override
+  Future<void> stopNetworkRecording() async {
+    await channel.invokeMethod("stopNetworkRecording", {"viewId": viewId});
+  }
+
+  @override
+  Future<void> clearNetworkRecording() async {
+    await channel.invokeMethod("clearNetworkRecording", {"viewId": viewId});
+  }
+
+  @override
+  Future<NetworkRecordingStats> getNetworkRecordingStats() async {
+    final result = await channel.invokeMethod<Map>(
+        "getNetworkRecordingStats", {"viewId": viewId});
+    return NetworkRecordingStats.fromMap(result ?? const {});
+  }
+
+  @override
+  Future<HarExportResult> exportHar(String path) async {
+    final result = await channel.invokeMethod<Map>("exportHar", {
+      "viewId": viewId,
+      "path": path,
+    });
+    return HarExportResult.fromMap(result ?? const {});
+  }
+
   @override
   void close() {
     if (_closed) {
@@ -269,6 +645,44 @@ class WebviewImpl extends Webview {
     return json.encode(result);
   }
 
+  @override
+  Future<dynamic> evaluateJavaScriptValue(String javaScript) {
+    return channel.invokeMethod("evaluateJavaScript", {
+      "viewId": viewId,
+      "javaScriptString": javaScript,
+      "nativeResult": true,
+    });
+  }
+
+  @override
+  Future<WebviewSnapshot> takeSnapshot({
+    SnapshotRegion region = SnapshotRegion.visible,
+    SnapshotFormat format = SnapshotFormat.png,
+  }) async {
+    final result = await channel.invokeMethod<Map>("takeSnapshot", {
+      "viewId": viewId,
+      "region": region.index,
+      "format": format.index,
+    });
+    return WebviewSnapshot.fromMap(result!);
+  }
+
+  @override
+  Future<List<JavaScriptResult>> evaluateJavaScriptBatch(
+      List<String> scripts) async {
+    final results = await channel.invokeMethod<List>(
+      "evaluateJavaScriptBatch",
+      {
+        "viewId": viewId,
+        "scripts": scripts,
+        "nativeResult": true,
+      },
+    );
+    return (results ?? const [])
+        .map((e) => JavaScriptResult.fromMap(e as Map))
+        .toList();
+  }
+
   @override
   Future<void> postWebMessageAsString(String webMessage) async {
     return channel.invokeMethod("postWebMessageAsString", {
@@ -286,9 +700,16 @@ class WebviewImpl extends Webview {
   }
 
   @override
-  Future<List<WebviewCookie>> getAllCookies() async {
+  Future<List<WebviewCookie>> getAllCookies({
+    String? domain,
+    String? namePrefix,
+    List<String>? fields,
+  }) async {
     final result = await channel.invokeListMethod<Map>("getAllCookies", {
       "viewId": viewId,
+      if (domain != null) "domain": domain,
+      if (namePrefix != null) "namePrefix": namePrefix,
+      if (fields != null) "fields": fields,
     });
 
     return result
@@ -296,4 +717,42 @@ class WebviewImpl extends Webview {
             .toList() ??
         [];
   }
+
+  Future<CookieBatchResult> _invokeCookieMethod(
+    String method,
+    Map<String, dynamic> arguments,
+  ) async {
+    final result = await channel.invokeMapMethod(method, {
+      "viewId": viewId,
+      ...arguments,
+    });
+    return CookieBatchResult.fromMap(result ?? const {});
+  }
+
+  @override
+  Future<CookieBatchResult> setCookies(List<WebviewCookie> cookies) {
+    return _invokeCookieMethod("setCookies", {
+      "cookies": cookies.map((e) => e.toJson()).toList(),
+    });
+  }
+
+  @override
+  Future<CookieBatchResult> deleteCookies(List<WebviewCookie> cookies) {
+    return _invokeCookieMethod("deleteCookies", {
+      "cookies": cookies.map((e) => e.toJson()).toList(),
+    });
+  }
+
+  @override
+  Future<CookieBatchResult> exportCookies(String path) {
+    return _invokeCookieMethod("exportCookies", {"path": path});
+  }
+
+  @override
+  Future<CookieBatchResult> importCookies(String path, {bool replace = false}) {
+    return _invokeCookieMethod("importCookies", {
+      "path": path,
+      "replace": replace,
+    });
+  }
 }
@@ -0,0 +1,56 @@
+/// An isolated browsing session.
+///
+/// Each session has its own cookies, storage, cache, proxy settings and
+/// network process, so webviews in different sessions never affect each
+/// other. Webviews created with the same [name] share one session; a
+/// session without a name belongs to a single webview.
+class WebviewSession {
+  /// Name shared by the webviews of this session, `null` for a private one.
+  final String? name;
+
+  /// Keep all website data in memory, nothing is written to disk.
+  final bool ephemeral;
+
+  /// Base directory for persistent website data. WebKit picks one if null.
+  final String? dataDirectory;
+
+  /// Base directory for caches. WebKit picks one if null.
+  final String? cacheDirectory;
+
+  /// Size limit of the HTTP disk cache in MB, WebKit sizes it if null.
+  ///
+  /// WebKit has no setting for this, so the largest sites are evicted from
+  /// the cache once it grows over the limit. Ignored for [ephemeral]
+  /// sessions.
+  final int? diskCacheLimitMB;
+
+  /// SQLite file the cookies of this session are kept in. Cookies only live
+  /// in memory if null. Ignored for [ephemeral] sessions.
+  final String? cookieStoragePath;
+
+  /// Upper bound on the web processes of this session, 0 for no limit.
+  ///
+  /// Only honored by WebKitGTK releases before 2.26, which share web
+  /// processes between views; newer releases run one per view.
+  final int webProcessCountLimit;
+
+  const WebviewSession({
+    this.name,
+    this.ephemeral = false,
+    this.dataDirectory,
+    this.cacheDirectory,
+    this.diskCacheLimitMB,
+    this.cookieStoragePath,
+    this.webProcessCountLimit = 0,
+  });
+
+  Map<String, dynamic> toMap() => {
+        'name': name,
+        'ephemeral': ephemeral,
+        'dataDirectory': dataDirectory,
+        'cacheDirectory': cacheDirectory,
+        'diskCacheLimitMB': diskCacheLimitMB ?? 0,
+        'cookieStoragePath': cookieStoragePath,
+        'webProcessCountLimit': webProcessCountLimit,
+      };
+}
@@ -0,0 +1,137 @@
+/// Renders a webview into a Flutter texture instead of its own window, see
+/// [CreateConfiguration.texture] and [WebviewTextureView].
+class TextureConfiguration {
+  /// The texture is updated at most this often, however often the page
+  /// repaints. Pages that do not change cost no copies.
+  final int maxFrameRate;
+
+  /// Render the page without the GPU. This also works on machines without
+  /// one and is the only mode offscreen webviews reliably paint in.
+  final bool softwareRendering;
+
+  const TextureConfiguration({
+    this.maxFrameRate = 60,
+    this.softwareRendering = true,
+  });
+
+  Map<String, dynamic> toMap() => {
+        'maxFrameRate': maxFrameRate,
+        'softwareRendering': softwareRendering,
+      };
+}
+
+enum TexturePointerEventType { down, up, move, scroll, leave }
+
+/// Pointer input for a texture webview, in logical pixels of the view.
+class TexturePointerEvent {
+  final TexturePointerEventType type;
+  final double x;
+  final double y;
+
+  /// GDK button number: 1 primary, 2 middle, 3 secondary.
+  final int button;
+
+  final double scrollDeltaX;
+  final double scrollDeltaY;
+
+  /// GDK modifier mask.
+  final int modifiers;
+
+  const TexturePointerEvent({
+    required this.type,
+    required this.x,
+    required this.y,
+    this.button = 0,
+    this.scrollDeltaX = 0,
+    this.scrollDeltaY = 0,
+    this.modifiers = 0,
+  });
+
+  Map<String, dynamic> toMap() => {
+        'type': type.index,
+        'x': x,
+        'y': y,
+        'button': button,
+        'scrollDeltaX': scrollDeltaX,
+        'scrollDeltaY': scrollDeltaY,
+        'modifiers': modifiers,
+      };
+}
+
+/// Keyboard input for a texture webview, in GDK terms.
+class TextureKeyEvent {
+  final bool down;
+  final int keyval;
+  final int keycode;
+  final int modifiers;
+
+  const TextureKeyEvent({
+    required this.down,
+    required this.keyval,
+    required this.keycode,
+    this.modifiers = 0,
+  });
+
+  Map<String, dynamic> toMap() => {
+        'down': down,
+        'keyval': keyval,
+        'keycode': keycode,
+        'modifiers': modifiers,
+      };
+}
+
+/// Frame counters of a texture webview.
+class WebviewTextureStats {
+  final int textureId;
+
+  /// Size of the last frame in physical pixels.
+  final int width;
+  final int height;
+
+  /// Repaints reported by the webview.
+  final int damageEvents;
+
+  /// Frames copied into the texture. Repaints between two copies share one.
+  final int framesCopied;
+
+  /// Frames Flutter picked up.
+  final int framesPresented;
+
+  /// Copied frames replaced by a newer one before Flutter picked them up.
+  final int framesDropped;
+
+  final int bytesCopied;
+  final Duration averageCopyTime;
+
+  /// Copies per second, measured over the last second with copies.
+  final double frameRate;
+
+  const WebviewTextureStats({
+    required this.textureId,
+    required this.width,
+    required this.height,
+    required this.damageEvents,
+    required this.framesCopied,
+    required this.framesPresented,
+    required this.framesDropped,
+    required this.bytesCopied,
+    required this.averageCopyTime,
+    required this.frameRate,
+  });
+
+  factory WebviewTextureStats.fromMap(Map<dynamic, dynamic> map) {
+    final copyUs = (map['averageCopyUs'] as num?) ?? 0;
+    return WebviewTextureStats(
+      textureId: map['textureId'] ?? -1,
+      width: map['width'] ?? 0,
+      height: map['height'] ?? 0,
+      damageEvents: map['damageEvents'] ?? 0,
+      framesCopied: map['framesCopied'] ?? 0,
+      framesPresented: map['framesPresented'] ?? 0,
+      framesDropped: map['framesDropped'] ?? 0,
+      bytesCopied: map['bytesCopied'] ?? 0,
+      averageCopyTime: Duration(microseconds: copyUs.round()),
+      frameRate: ((map['frameRate'] as num?) ?? 0).toDouble(),
+    );
+  }
+}
@@ -0,0 +1,181 @@
+import 'package:desktop_webview_window/src/webview.dart';
+import 'package:desktop_webview_window/src/webview_texture.dart';
+import 'package:flutter/gestures.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter/widgets.dart';
+
+// GDK modifier masks.
+const int _kShiftMask = 1 << 0;
+const int _kControlMask = 1 << 2;
+const int _kAltMask = 1 << 3;
+const int _kSuperMask = 1 << 26;
+
+/// Shows a webview created with [CreateConfiguration.texture] and forwards
+/// pointer and keyboard input to it.
+///
+/// The webview is resized to the size of this widget. Only supported on
+/// Linux.
+class WebviewTextureView extends StatefulWidget {
+  const WebviewTextureView({Key? key, required this.webview}) : super(key: key);
+
+  final Webview webview;
+
+  @override
+  State<WebviewTextureView> createState() => _WebviewTextureViewState();
+}
+
+class _WebviewTextureViewState extends State<WebviewTextureView> {
+  final FocusNode _focusNode = FocusNode(debugLabel: 'WebviewTextureView');
+
+  Size? _size;
+  int _buttons = 0;
+
+  @override
+  void dispose() {
+    _focusNode.dispose();
+    super.dispose();
+  }
+
+  void _resize(Size size) {
+    if (size == _size || !size.isFinite || size.isEmpty) {
+      return;
+    }
+    _size = size;
+    widget.webview.resizeTexture(size.width.round(), size.height.round());
+  }
+
+  int _modifiers() {
+    final keys = RawKeyboard.instance.keysPressed;
+    var modifiers = 0;
+    if (keys.contains(LogicalKeyboardKey.shiftLeft) ||
+        keys.contains(LogicalKeyboardKey.shiftRight)) {
+      modifiers |= _kShiftMask;
+    }
+    if (keys.contains(LogicalKeyboardKey.controlLeft) ||
+        keys.contains(LogicalKeyboardKey.controlRight)) {
+      modifiers |= _kControlMask;
+    }
+    if (keys.contains(LogicalKeyboardKey.altLeft) ||
+        keys.contains(LogicalKeyboardKey.altRight)) {
+      modifiers |= _kAltMask;
+    }
+    if (keys.contains(LogicalKeyboardKey.metaLeft) ||
+        keys.contains(LogicalKeyboardKey.metaRight)) {
+      modifiers |= _kSuperMask;
+    }
+    return modifiers;
+  }
+
+  // Maps a Flutter button bit to the GDK button number.
+  static int _gdkButton(int button) {
+    switch (button) {
+      case kPrimaryButton:
+        return 1;
+      case kMiddleMouseButton:
+        return 2;
+      case kSecondaryButton:
+        return 3;
+      case kBackMouseButton:
+        return 8;
+      case kForwardMouseButton:
+        return 9;
+      default:
+        return 0;
+    }
+  }
+
+  void _send(
+    TexturePointerEventType type,
+    PointerEvent event, {
+    int button = 0,
+    Offset scrollDelta = Offset.zero,
+  }) {
+    widget.webview.sendTexturePointerEvent(TexturePointerEvent(
+      type: type,
+      x: event.localPosition.dx,
+      y: event.localPosition.dy,
+      button: button,
+      scrollDeltaX: scrollDelta.dx,
+      scrollDeltaY: scrollDelta.dy,
+      modifiers: _modifiers(),
+    ));
+  }
+
+  void _onButtons(PointerEvent event, bool down) {
+    // One event may press or release several buttons.
+    var changed = _buttons ^ event.buttons;
+    _buttons = event.buttons;
+    if (!down && changed == 0) {
+      // Up events of touch and stylus report no buttons.
+      changed = kPrimaryButton;
+    }
+    for (var bit = 1; bit <= kForwardMouseButton; bit <<= 1) {
+      if (changed & bit != 0) {
+        _send(
+          down ? TexturePointerEventType.down : TexturePointerEventType.up,
+          event,
+          button: _gdkButton(bit),
+        );
+      }
+    }
+  }
+
+  // ignore: deprecated_member_use
+  KeyEventResult _onKey(FocusNode node, RawKeyEvent event) {
+    final data = event.data;
+    // ignore: deprecated_member_use
+    if (data is! RawKeyEventDataLinux) {
+      return KeyEventResult.ignored;
+    }
+    widget.webview.sendTextureKeyEvent(TextureKeyEvent(
+      // ignore: deprecated_member_use
+      down: event is RawKeyDownEvent,
+      keyval: data.keyCode,
+      keycode: data.scanCode,
+      modifiers: data.modifiers,
+    ));
+    return KeyEventResult.handled;
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    final textureId = widget.webview.textureId;
+    if (textureId == null) {
+      return const SizedBox.shrink();
+    }
+    return LayoutBuilder(builder: (context, constraints) {
+      _resize(constraints.biggest);
+      return Focus(
+        focusNode: _focusNode,
+        onFocusChange: widget.webview.setTextureFocus,
+        // ignore: deprecated_member_use
+        onKey: _onKey,
+        child: Listener(
+          onPointerDown: (event) {
+            _focusNode.requestFocus();
+            _onButtons(event, true);
+          },
+          onPointerUp: (event) => _onButtons(event, false),
+          onPointerMove: (event) {
+            if (event.buttons != _buttons) {
+              _onButtons(event, event.buttons & ~_buttons != 0);
+            }
+            _send(TexturePointerEventType.move, event);
+          },
+          onPointerHover: (event) =>
+              _send(TexturePointerEventType.move, event),
+          onPointerSignal: (event) {
+            if (event is PointerScrollEvent) {
+              _send(TexturePointerEventType.scroll, event,
+                  scrollDelta: event.scrollDelta);
+            }
+          },
+          child: MouseRegion(
+            onExit: (event) => _send(TexturePointerEventType.leave, event),
+            child: Texture(textureId: textureId),
+          ),
+        ),
+      );
+    });
+  }
+}
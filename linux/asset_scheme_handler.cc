@@ -0,0 +1,311 @@
+#include "asset_scheme_handler.h"
+
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Files up to this size stay mapped in the cache.
+constexpr size_t kMaxCachedFileSize = 256 * 1024;
+
+// Schemes WebKit or the network stack already handle.
+const char *const kReservedSchemes[] = {
+    "about", "blob", "data", "file", "ftp", "http", "https", "javascript",
+    "ws",    "wss",
+};
+
+// Types that matter for web pages and that shared-mime-info either lacks or
+// maps to something WebKit refuses to run, e.g. text/plain for modules.
+const struct {
+  const char *extension;
+  const char *mime_type;
+} kWebMimeTypes[] = {
+    {".html", "text/html"},
+    {".htm", "text/html"},
+    {".js", "text/javascript"},
+    {".mjs", "text/javascript"},
+    {".css", "text/css"},
+    {".json", "application/json"},
+    {".map", "application/json"},
+    {".wasm", "application/wasm"},
+    {".svg", "image/svg+xml"},
+    {".woff2", "font/woff2"},
+};
+
+std::string guess_mime_type(const std::string &path, GBytes *bytes) {
+  for (const auto &entry : kWebMimeTypes) {
+    if (g_str_has_suffix(path.c_str(), entry.extension)) {
+      return entry.mime_type;
+    }
+  }
+  gsize size;
+  auto *data = g_bytes_get_data(bytes, &size);
+  g_autofree gchar *content_type = g_content_type_guess(
+      path.c_str(), static_cast<const guchar *>(data), MIN(size, 4096),
+      nullptr);
+  g_autofree gchar *mime_type = g_content_type_get_mime_type(content_type);
+  return mime_type ? mime_type : "application/octet-stream";
+}
+
+// Parses a single "bytes=first-last" range of a file of |size| bytes.
+// Returns false for a missing or multipart range, which is answered with
+// the whole file; sets |satisfiable| to false if the range lies outside it.
+bool parse_range(const char *header, gint64 size, gint64 *first, gint64 *last,
+                 bool *satisfiable) {
+  if (!header || !g_str_has_prefix(header, "bytes=") ||
+      strchr(header, ',')) {
+    return false;
+  }
+  const char *spec = header + strlen("bytes=");
+  char *end;
+  *satisfiable = true;
+  if (*spec == '-') {
+    // The last N bytes.
+    auto suffix = g_ascii_strtoll(spec + 1, &end, 10);
+    if (end == spec + 1 || *end != '\0') {
+      return false;
+    }
+    if (suffix <= 0 || size == 0) {
+      *satisfiable = false;
+      return true;
+    }
+    *first = suffix >= size ? 0 : size - suffix;
+    *last = size - 1;
+    return true;
+  }
+  *first = g_ascii_strtoll(spec, &end, 10);
+  if (end == spec || *end != '-') {
+    return false;
+  }
+  spec = end + 1;
+  if (*spec == '\0') {
+    *last = size - 1;
+  } else {
+    *last = g_ascii_strtoll(spec, &end, 10);
+    if (*end != '\0' || *last < *first) {
+      return false;
+    }
+    *last = MIN(*last, size - 1);
+  }
+  if (*first >= size) {
+    *satisfiable = false;
+  }
+  return true;
+}
+
+}  // namespace
+
+AssetSchemeHandler::AssetSchemeHandler(std::string scheme, std::string root,
+                                       size_t cache_capacity)
+    : scheme_(std::move(scheme)),
+      root_(std::move(root)),
+      cache_capacity_(cache_capacity) {}
+
+AssetSchemeHandler::~AssetSchemeHandler() { ClearCache(); }
+
+bool AssetSchemeHandler::IsValidScheme(const char *scheme) {
+  if (!scheme || !g_ascii_isalpha(scheme[0])) {
+    return false;
+  }
+  for (auto *c = scheme; *c; ++c) {
+    if (!g_ascii_isalnum(*c) && *c != '+' && *c != '-' && *c != '.') {
+      return false;
+    }
+  }
+  for (auto *reserved : kReservedSchemes) {
+    if (g_ascii_strcasecmp(scheme, reserved) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string AssetSchemeHandler::FlutterAssetsDirectory() {
+  g_autofree gchar *executable =
+      g_file_read_link("/proc/self/exe", nullptr);
+  if (!executable) {
+    return std::string();
+  }
+  g_autofree gchar *directory = g_path_get_dirname(executable);
+  g_autofree gchar *assets =
+      g_build_filename(directory, "data", "flutter_assets", nullptr);
+  return assets;
+}
+
+void AssetSchemeHandler::Reset(std::string root, size_t cache_capacity) {
+  root_ = std::move(root);
+  cache_capacity_ = cache_capacity;
+  ClearCache();
+}
+
+void AssetSchemeHandler::Register(
+    const std::shared_ptr<AssetSchemeHandler> &handler,
+    WebKitWebContext *context) {
+  webkit_web_context_register_uri_scheme(
+      context, handler->scheme_.c_str(), OnRequest,
+      new std::shared_ptr<AssetSchemeHandler>(handler), [](gpointer data) {
+        delete static_cast<std::shared_ptr<AssetSchemeHandler> *>(data);
+      });
+  // Pages from the bundle may use APIs limited to secure contexts and fetch
+  // each other's resources.
+  auto *security_manager = webkit_web_context_get_security_manager(context);
+  webkit_security_manager_register_uri_scheme_as_secure(
+      security_manager, handler->scheme_.c_str());
+  webkit_security_manager_register_uri_scheme_as_cors_enabled(
+      security_manager, handler->scheme_.c_str());
+}
+
+void AssetSchemeHandler::OnRequest(WebKitURISchemeRequest *request,
+                                   gpointer user_data) {
+  auto *handler = static_cast<std::shared_ptr<AssetSchemeHandler> *>(user_data);
+  (*handler)->HandleRequest(request);
+}
+
+std::string AssetSchemeHandler::ResolvePath(const char *request_path) const {
+  if (root_.empty()) {
+    return std::string();
+  }
+  // Percent-decoding fails on encoded NUL bytes and slashes.
+  g_autofree gchar *path = g_uri_unescape_string(request_path, "/");
+  if (!path) {
+    return std::string();
+  }
+  auto *relative = path;
+  while (*relative == '/') {
+    relative++;
+  }
+  if (*relative == '\0') {
+    relative = const_cast<gchar *>("index.html");
+  }
+  // Canonicalizing removes "." and ".." segments, anything that still
+  // resolves outside the root is rejected.
+  g_autofree gchar *file = g_canonicalize_filename(relative, root_.c_str());
+  g_autofree gchar *root = g_canonicalize_filename(root_.c_str(), nullptr);
+  auto root_length = strlen(root);
+  if (strncmp(file, root, root_length) != 0 || file[root_length] != '/') {
+    return std::string();
+  }
+  return file;
+}
+
+GBytes *AssetSchemeHandler::LoadFile(const std::string &path, gint64 modified,
+                                     size_t size, GError **error) {
+  auto it = cache_index_.find(path);
+  if (it != cache_index_.end()) {
+    if (it->second->modified == modified &&
+        g_bytes_get_size(it->second->bytes) == size) {
+      cache_.splice(cache_.begin(), cache_, it->second);
+      return g_bytes_ref(it->second->bytes);
+    }
+    cache_size_ -= g_bytes_get_size(it->second->bytes);
+    g_bytes_unref(it->second->bytes);
+    cache_.erase(it->second);
+    cache_index_.erase(it);
+  }
+
+  GBytes *bytes;
+  if (size == 0) {
+    // Empty files can not be mapped.
+    bytes = g_bytes_new(nullptr, 0);
+  } else {
+    auto *mapped_file = g_mapped_file_new(path.c_str(), FALSE, error);
+    if (!mapped_file) {
+      return nullptr;
+    }
+    // The bytes keep the mapping alive.
+    bytes = g_mapped_file_get_bytes(mapped_file);
+    g_mapped_file_unref(mapped_file);
+  }
+
+  auto length = g_bytes_get_size(bytes);
+  if (length <= kMaxCachedFileSize && length <= cache_capacity_) {
+    while (cache_size_ + length > cache_capacity_) {
+      auto &oldest = cache_.back();
+      cache_size_ -= g_bytes_get_size(oldest.bytes);
+      g_bytes_unref(oldest.bytes);
+      cache_index_.erase(oldest.path);
+      cache_.pop_back();
+    }
+    cache_.push_front({path, g_bytes_ref(bytes), modified});
+    cache_index_[path] = cache_.begin();
+    cache_size_ += length;
+  }
+  return bytes;
+}
+
+void AssetSchemeHandler::ClearCache() {
+  for (auto &file : cache_) {
+    g_bytes_unref(file.bytes);
+  }
+  cache_.clear();
+  cache_index_.clear();
+  cache_size_ = 0;
+}
+
+void AssetSchemeHandler::HandleRequest(WebKitURISchemeRequest *request) {
+  auto path = ResolvePath(webkit_uri_scheme_request_get_path(request));
+  GStatBuf stat_buf;
+  if (path.empty() || g_stat(path.c_str(), &stat_buf) != 0 ||
+      !S_ISREG(stat_buf.st_mode)) {
+    g_autoptr(GError) error =
+        g_error_new(G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s not found",
+                    webkit_uri_scheme_request_get_uri(request));
+    webkit_uri_scheme_request_finish_error(request, error);
+    return;
+  }
+
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GBytes) bytes =
+      LoadFile(path, static_cast<gint64>(stat_buf.st_mtime),
+               static_cast<size_t>(stat_buf.st_size), &error);
+  if (!bytes) {
+    webkit_uri_scheme_request_finish_error(request, error);
+    return;
+  }
+  auto mime_type = guess_mime_type(path, bytes);
+  auto size = static_cast<gint64>(g_bytes_get_size(bytes));
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+  auto *request_headers = webkit_uri_scheme_request_get_http_headers(request);
+  gint64 first = 0;
+  gint64 last = size - 1;
+  bool satisfiable = true;
+  bool partial =
+      request_headers &&
+      parse_range(soup_message_headers_get_one(request_headers, "Range"),
+                  size, &first, &last, &satisfiable);
+  auto *headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+  soup_message_headers_append(headers, "Accept-Ranges", "bytes");
+  if (partial && !satisfiable) {
+    g_autofree gchar *content_range =
+        g_strdup_printf("bytes */%" G_GINT64_FORMAT, size);
+    soup_message_headers_append(headers, "Content-Range", content_range);
+    first = 0;
+    last = -1;
+  } else if (partial) {
+    g_autofree gchar *content_range = g_strdup_printf(
+        "bytes %" G_GINT64_FORMAT "-%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
+        first, last, size);
+    soup_message_headers_append(headers, "Content-Range", content_range);
+  }
+  // A view of the mapped file, no copy.
+  g_autoptr(GBytes) body = g_bytes_new_from_bytes(
+      bytes, static_cast<gsize>(first), static_cast<gsize>(last - first + 1));
+  g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes(body);
+  auto *response =
+      webkit_uri_scheme_response_new(stream, g_bytes_get_size(body));
+  webkit_uri_scheme_response_set_content_type(response, mime_type.c_str());
+  webkit_uri_scheme_response_set_status(
+      response, partial ? (satisfiable ? 206 : 416) : 200, nullptr);
+  webkit_uri_scheme_response_set_http_headers(response, headers);
+  webkit_uri_scheme_request_finish_with_response(request, response);
+  g_object_unref(response);
+#else
+  g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes(bytes);
+  webkit_uri_scheme_request_finish(request, stream, size, mime_type.c_str());
+#endif
+}
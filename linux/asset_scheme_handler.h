@@ -0,0 +1,78 @@
+#ifndef WEBVIEW_WINDOW_LINUX_ASSET_SCHEME_HANDLER_H_
+#define WEBVIEW_WINDOW_LINUX_ASSET_SCHEME_HANDLER_H_
+
+#include <glib.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Serves the files below a root directory on a custom URI scheme, so pages
+// bundled with the app load without file:// restrictions or a local HTTP
+// server.
+//
+// app://<any host>/<path> maps to <root>/<path>, "/" to index.html. Files
+// are memory mapped and handed to WebKit without copying, small ones stay
+// mapped in an LRU cache. Range requests are answered with 206 responses on
+// WebKitGTK 2.36 and newer.
+class AssetSchemeHandler {
+ public:
+  AssetSchemeHandler(std::string scheme, std::string root,
+                     size_t cache_capacity);
+
+  ~AssetSchemeHandler();
+
+  AssetSchemeHandler(const AssetSchemeHandler &) = delete;
+  AssetSchemeHandler &operator=(const AssetSchemeHandler &) = delete;
+
+  // Whether |scheme| can be served by a handler. Schemes WebKit handles
+  // itself, like http or file, can not.
+  static bool IsValidScheme(const char *scheme);
+
+  // Returns the directory of the Flutter asset bundle of this app.
+  static std::string FlutterAssetsDirectory();
+
+  const std::string &scheme() const { return scheme_; }
+
+  // Serves |root| from now on and drops the cached files.
+  void Reset(std::string root, size_t cache_capacity);
+
+  // Registers the scheme on |context|. The context keeps |handler| alive.
+  static void Register(const std::shared_ptr<AssetSchemeHandler> &handler,
+                       WebKitWebContext *context);
+
+ private:
+  struct CachedFile {
+    std::string path;
+    GBytes *bytes;
+    gint64 modified;
+  };
+
+  std::string scheme_;
+  std::string root_;
+  size_t cache_capacity_;
+  size_t cache_size_ = 0;
+  // Most recently used first.
+  std::list<CachedFile> cache_;
+  std::unordered_map<std::string, std::list<CachedFile>::iterator>
+      cache_index_;
+
+  static void OnRequest(WebKitURISchemeRequest *request, gpointer user_data);
+
+  void HandleRequest(WebKitURISchemeRequest *request);
+
+  // Returns the file below the root for a request path, or an empty string
+  // if the path leaves the root.
+  std::string ResolvePath(const char *request_path) const;
+
+  // Returns a new reference to the contents of |path|, or null on error.
+  GBytes *LoadFile(const std::string &path, gint64 modified, size_t size,
+                   GError **error);
+
+  void ClearCache();
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_ASSET_SCHEME_HANDLER_H_
@@ -0,0 +1,236 @@
+#include "dispatch_benchmark.h"
+
+#include <glib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr int kCallsPerSample = 10000;
+constexpr int kWindows = 16;
+
+// The methods of the strcmp chain, in its order. Both dispatchers handle
+// exactly these, so the table is timed on the same method set.
+const char *const kMethods[] = {
+    "create",
+    "launch",
+    "addScriptToExecuteOnDocumentCreated",
+    "clearAll",
+    "setApplicationNameForUserAgent",
+    "back",
+    "forward",
+    "reload",
+    "stop",
+    "getAllCookies",
+    "close",
+    "evaluateJavaScript",
+};
+constexpr size_t kMethodCount = sizeof(kMethods) / sizeof(kMethods[0]);
+
+struct Window {
+  int64_t calls = 0;
+};
+
+struct Plugin {
+  int64_t calls = 0;
+};
+
+void handle_plugin(Plugin *plugin, size_t method) {
+  plugin->calls += method + 1;
+}
+
+void handle_window(Window *window, size_t method) {
+  window->calls += method + 1;
+}
+
+// The dispatch before the handler table: one strcmp per method until one
+// matches, then count() and at() on an ordered window map for the window
+// methods. create and clearAll look up no window.
+class ChainDispatcher {
+ public:
+  ChainDispatcher() {
+    for (int64_t id = 0; id < kWindows; ++id) {
+      windows_[id] = std::make_unique<Window>();
+    }
+  }
+
+  bool Dispatch(const char *method, int64_t window_id) {
+    if (strcmp(method, "create") == 0) {
+      handle_plugin(&plugin_, 0);
+      return true;
+    } else if (strcmp(method, "launch") == 0) {
+      return CallWindow(window_id, 1);
+    } else if (strcmp(method, "addScriptToExecuteOnDocumentCreated") == 0) {
+      return CallWindow(window_id, 2);
+    } else if (strcmp(method, "clearAll") == 0) {
+      handle_plugin(&plugin_, 3);
+      return true;
+    } else if (strcmp(method, "setApplicationNameForUserAgent") == 0) {
+      return CallWindow(window_id, 4);
+    } else if (strcmp(method, "back") == 0) {
+      return CallWindow(window_id, 5);
+    } else if (strcmp(method, "forward") == 0) {
+      return CallWindow(window_id, 6);
+    } else if (strcmp(method, "reload") == 0) {
+      return CallWindow(window_id, 7);
+    } else if (strcmp(method, "stop") == 0) {
+      return CallWindow(window_id, 8);
+    } else if (strcmp(method, "getAllCookies") == 0) {
+      return CallWindow(window_id, 9);
+    } else if (strcmp(method, "close") == 0) {
+      return CallWindow(window_id, 10);
+    } else if (strcmp(method, "evaluateJavaScript") == 0) {
+      return CallWindow(window_id, 11);
+    }
+    return false;
+  }
+
+ private:
+  Plugin plugin_;
+  std::map<int64_t, std::unique_ptr<Window>> windows_;
+
+  bool CallWindow(int64_t window_id, size_t method) {
+    if (!windows_.count(window_id)) {
+      return false;
+    }
+    handle_window(windows_.at(window_id).get(), method);
+    return true;
+  }
+};
+
+struct MethodNameHash {
+  size_t operator()(const char *name) const { return g_str_hash(name); }
+};
+
+struct MethodNameEqual {
+  bool operator()(const char *a, const char *b) const {
+    return strcmp(a, b) == 0;
+  }
+};
+
+// The dispatch of the plugin now, see build_method_table(): one lookup in
+// the handler table, then one find() in the unordered window registry for
+// the window methods.
+class TableDispatcher {
+ public:
+  TableDispatcher() {
+    for (size_t i = 0; i < kMethodCount; ++i) {
+      auto plugin_method = strcmp(kMethods[i], "create") == 0 ||
+                           strcmp(kMethods[i], "clearAll") == 0;
+      methods_.insert(
+          {kMethods[i],
+           {plugin_method ? handle_plugin : nullptr,
+            plugin_method ? nullptr : handle_window, i}});
+    }
+    for (int64_t id = 0; id < kWindows; ++id) {
+      windows_[id] = std::make_unique<Window>();
+    }
+  }
+
+  bool Dispatch(const char *method, int64_t window_id) {
+    auto entry = methods_.find(method);
+    if (entry == methods_.end()) {
+      return false;
+    }
+    if (entry->second.plugin_handler) {
+      entry->second.plugin_handler(&plugin_, entry->second.method);
+      return true;
+    }
+    auto window = windows_.find(window_id);
+    if (window == windows_.end()) {
+      return false;
+    }
+    entry->second.window_handler(window->second.get(), entry->second.method);
+    return true;
+  }
+
+ private:
+  struct Entry {
+    void (*plugin_handler)(Plugin *plugin, size_t method);
+    void (*window_handler)(Window *window, size_t method);
+    size_t method;
+  };
+
+  Plugin plugin_;
+  std::unordered_map<const char *, Entry, MethodNameHash, MethodNameEqual>
+      methods_;
+  std::unordered_map<int64_t, std::unique_ptr<Window>> windows_;
+};
+
+// Returns the median nanoseconds per call of |iterations| samples, each
+// dispatching |names| round robin kCallsPerSample times.
+template <typename Dispatcher>
+double time_dispatch(Dispatcher *dispatcher,
+                     const std::vector<std::string> &names, int iterations,
+                     int64_t *sink) {
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  for (int i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    for (int call = 0; call < kCallsPerSample; ++call) {
+      *sink += dispatcher->Dispatch(names[call % names.size()].c_str(),
+                                    call % kWindows);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start);
+    samples.push_back(elapsed.count() / kCallsPerSample);
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+}  // namespace
+
+void run_dispatch_benchmark(int iterations, bool json) {
+  // Method names arrive in buffers of their own, so no lookup can match
+  // them by pointer.
+  std::vector<std::string> all(kMethods, kMethods + kMethodCount);
+  struct Case {
+    const char *name;
+    std::vector<std::string> methods;
+  } cases[] = {
+      {"first method", {all.front()}},
+      {"last method", {all.back()}},
+      {"all methods", all},
+      {"unknown method", {"notAMethod"}},
+  };
+
+  ChainDispatcher chain;
+  TableDispatcher table;
+  int64_t sink = 0;
+  if (json) {
+    printf("{");
+  } else {
+    printf("%-16s %12s %12s %9s\n", "dispatch", "before", "after", "speedup");
+  }
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    auto before = time_dispatch(&chain, cases[i].methods, iterations, &sink);
+    auto after = time_dispatch(&table, cases[i].methods, iterations, &sink);
+    if (json) {
+      printf("%s\"%s\":{\"before\":%.2f,\"after\":%.2f}", i ? "," : "",
+             cases[i].name, before, after);
+    } else {
+      printf("%-16s %12.2f %12.2f %8.1fx\n", cases[i].name, before, after,
+             before / after);
+    }
+  }
+  if (json) {
+    printf("}\n");
+  } else {
+    printf("(nanoseconds per call, %zu methods, %d windows)\n", kMethodCount,
+           kWindows);
+  }
+  // Keeps the dispatches from being optimized away.
+  if (sink < 0) {
+    printf("%ld\n", sink);
+  }
+}
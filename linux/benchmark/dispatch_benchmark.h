@@ -0,0 +1,11 @@
+#ifndef WEBVIEW_WINDOW_LINUX_BENCHMARK_DISPATCH_BENCHMARK_H_
+#define WEBVIEW_WINDOW_LINUX_BENCHMARK_DISPATCH_BENCHMARK_H_
+
+// Times the method dispatch of the plugin in isolation: a model of the 12
+// method strcmp chain followed by count() and at() on an ordered window map
+// it had before the handler table, against the hashed handler table and the
+// unordered window registry it has now, on the same 12 methods. Prints
+// nanoseconds per call, as a table or as JSON.
+void run_dispatch_benchmark(int iterations, bool json);
+
+#endif  // WEBVIEW_WINDOW_LINUX_BENCHMARK_DISPATCH_BENCHMARK_H_
@@ -0,0 +1,261 @@
+#include "loopback_messenger.h"
+
+#include <map>
+#include <string>
+
+namespace {
+
+struct MessageHandler {
+  FlBinaryMessengerMessageHandler handler;
+  gpointer user_data;
+  GDestroyNotify destroy_notify;
+};
+
+void free_handler(MessageHandler *handler) {
+  if (handler->destroy_notify) {
+    handler->destroy_notify(handler->user_data);
+  }
+}
+
+}  // namespace
+
+G_DECLARE_FINAL_TYPE(LoopbackResponseHandle, loopback_response_handle,
+                     LOOPBACK, RESPONSE_HANDLE,
+                     FlBinaryMessengerResponseHandle)
+
+struct _LoopbackResponseHandle {
+  FlBinaryMessengerResponseHandle parent_instance;
+  // The send of the peer, null once answered.
+  GTask *task;
+};
+
+G_DEFINE_TYPE(LoopbackResponseHandle, loopback_response_handle,
+              fl_binary_messenger_response_handle_get_type())
+
+static void loopback_response_handle_dispose(GObject *object) {
+  auto *self = LOOPBACK_RESPONSE_HANDLE(object);
+  if (self->task) {
+    g_task_return_new_error(self->task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                            "message was not answered");
+    g_clear_object(&self->task);
+  }
+  G_OBJECT_CLASS(loopback_response_handle_parent_class)->dispose(object);
+}
+
+static void loopback_response_handle_class_init(
+    LoopbackResponseHandleClass *klass) {
+  G_OBJECT_CLASS(klass)->dispose = loopback_response_handle_dispose;
+}
+
+static void loopback_response_handle_init(LoopbackResponseHandle *self) {}
+
+struct _LoopbackMessenger {
+  GObject parent_instance;
+  // Weak, cleared when the peer is finalized.
+  LoopbackMessenger *peer;
+  std::map<std::string, MessageHandler> *handlers;
+};
+
+static void loopback_messenger_iface_init(FlBinaryMessengerInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(
+    LoopbackMessenger, loopback_messenger, G_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE(fl_binary_messenger_get_type(),
+                          loopback_messenger_iface_init))
+
+namespace {
+
+struct Delivery {
+  LoopbackMessenger *receiver;
+  std::string channel;
+  GBytes *message;
+  GTask *task;
+};
+
+gboolean deliver_message(gpointer user_data) {
+  auto *delivery = static_cast<Delivery *>(user_data);
+  auto *handlers = delivery->receiver->handlers;
+  auto it = handlers->find(delivery->channel);
+  if (it == handlers->end()) {
+    g_task_return_new_error(delivery->task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                            "no handler on %s", delivery->channel.c_str());
+    g_object_unref(delivery->task);
+  } else {
+    auto *handle = LOOPBACK_RESPONSE_HANDLE(
+        g_object_new(loopback_response_handle_get_type(), nullptr));
+    handle->task = delivery->task;
+    it->second.handler(FL_BINARY_MESSENGER(delivery->receiver),
+                       delivery->channel.c_str(), delivery->message,
+                       FL_BINARY_MESSENGER_RESPONSE_HANDLE(handle),
+                       it->second.user_data);
+    g_object_unref(handle);
+  }
+  g_bytes_unref(delivery->message);
+  g_object_unref(delivery->receiver);
+  delete delivery;
+  return G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+static void loopback_messenger_set_message_handler_on_channel(
+    FlBinaryMessenger *messenger, const gchar *channel,
+    FlBinaryMessengerMessageHandler handler, gpointer user_data,
+    GDestroyNotify destroy_notify) {
+  auto *self = LOOPBACK_MESSENGER(messenger);
+  auto it = self->handlers->find(channel);
+  if (it != self->handlers->end()) {
+    free_handler(&it->second);
+    self->handlers->erase(it);
+  }
+  if (handler) {
+    self->handlers->insert({channel, {handler, user_data, destroy_notify}});
+  }
+}
+
+static gboolean loopback_messenger_send_response(
+    FlBinaryMessenger *messenger,
+    FlBinaryMessengerResponseHandle *response_handle, GBytes *response,
+    GError **error) {
+  auto *handle = LOOPBACK_RESPONSE_HANDLE(response_handle);
+  if (handle->task == nullptr) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                "message was already answered");
+    return FALSE;
+  }
+  // Like the engine, a missing response arrives as an empty one.
+  g_task_return_pointer(
+      handle->task, response ? g_bytes_ref(response) : g_bytes_new(nullptr, 0),
+      reinterpret_cast<GDestroyNotify>(g_bytes_unref));
+  g_clear_object(&handle->task);
+  return TRUE;
+}
+
+static void loopback_messenger_send_on_channel(FlBinaryMessenger *messenger,
+                                               const gchar *channel,
+                                               GBytes *message,
+                                               GCancellable *cancellable,
+                                               GAsyncReadyCallback callback,
+                                               gpointer user_data) {
+  auto *self = LOOPBACK_MESSENGER(messenger);
+  auto *task = g_task_new(self, cancellable, callback, user_data);
+  if (self->peer == nullptr) {
+    g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_CLOSED,
+                            "peer is gone");
+    g_object_unref(task);
+    return;
+  }
+  g_idle_add(deliver_message,
+             new Delivery{LOOPBACK_MESSENGER(g_object_ref(self->peer)),
+                          channel,
+                          message ? g_bytes_ref(message)
+                                  : g_bytes_new(nullptr, 0),
+                          task});
+}
+
+static GBytes *loopback_messenger_send_on_channel_finish(
+    FlBinaryMessenger *messenger, GAsyncResult *result, GError **error) {
+  return static_cast<GBytes *>(g_task_propagate_pointer(G_TASK(result), error));
+}
+
+static void loopback_messenger_resize_channel(FlBinaryMessenger *messenger,
+                                              const gchar *channel,
+                                              int64_t new_size) {}
+
+static void loopback_messenger_set_warns_on_channel_overflow(
+    FlBinaryMessenger *messenger, const gchar *channel, bool warns) {}
+
+static void loopback_messenger_iface_init(FlBinaryMessengerInterface *iface) {
+  iface->set_message_handler_on_channel =
+      loopback_messenger_set_message_handler_on_channel;
+  iface->send_response = loopback_messenger_send_response;
+  iface->send_on_channel = loopback_messenger_send_on_channel;
+  iface->send_on_channel_finish = loopback_messenger_send_on_channel_finish;
+  iface->resize_channel = loopback_messenger_resize_channel;
+  iface->set_warns_on_channel_overflow =
+      loopback_messenger_set_warns_on_channel_overflow;
+}
+
+static void loopback_messenger_dispose(GObject *object) {
+  auto *self = LOOPBACK_MESSENGER(object);
+  if (self->peer) {
+    self->peer->peer = nullptr;
+    self->peer = nullptr;
+  }
+  if (self->handlers) {
+    for (auto &item : *self->handlers) {
+      free_handler(&item.second);
+    }
+    delete self->handlers;
+    self->handlers = nullptr;
+  }
+  G_OBJECT_CLASS(loopback_messenger_parent_class)->dispose(object);
+}
+
+static void loopback_messenger_class_init(LoopbackMessengerClass *klass) {
+  G_OBJECT_CLASS(klass)->dispose = loopback_messenger_dispose;
+}
+
+static void loopback_messenger_init(LoopbackMessenger *self) {
+  self->handlers = new std::map<std::string, MessageHandler>();
+}
+
+void loopback_messenger_new_pair(LoopbackMessenger **first,
+                                 LoopbackMessenger **second) {
+  *first = LOOPBACK_MESSENGER(
+      g_object_new(loopback_messenger_get_type(), nullptr));
+  *second = LOOPBACK_MESSENGER(
+      g_object_new(loopback_messenger_get_type(), nullptr));
+  (*first)->peer = *second;
+  (*second)->peer = *first;
+}
+
+struct _LoopbackRegistrar {
+  GObject parent_instance;
+  FlBinaryMessenger *messenger;
+};
+
+static void loopback_registrar_iface_init(FlPluginRegistrarInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(
+    LoopbackRegistrar, loopback_registrar, G_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE(fl_plugin_registrar_get_type(),
+                          loopback_registrar_iface_init))
+
+static FlBinaryMessenger *loopback_registrar_get_messenger(
+    FlPluginRegistrar *registrar) {
+  return LOOPBACK_REGISTRAR(registrar)->messenger;
+}
+
+static FlTextureRegistrar *loopback_registrar_get_texture_registrar(
+    FlPluginRegistrar *registrar) {
+  return nullptr;
+}
+
+static FlView *loopback_registrar_get_view(FlPluginRegistrar *registrar) {
+  return nullptr;
+}
+
+static void loopback_registrar_iface_init(FlPluginRegistrarInterface *iface) {
+  iface->get_messenger = loopback_registrar_get_messenger;
+  iface->get_texture_registrar = loopback_registrar_get_texture_registrar;
+  iface->get_view = loopback_registrar_get_view;
+}
+
+static void loopback_registrar_dispose(GObject *object) {
+  g_clear_object(&LOOPBACK_REGISTRAR(object)->messenger);
+  G_OBJECT_CLASS(loopback_registrar_parent_class)->dispose(object);
+}
+
+static void loopback_registrar_class_init(LoopbackRegistrarClass *klass) {
+  G_OBJECT_CLASS(klass)->dispose = loopback_registrar_dispose;
+}
+
+static void loopback_registrar_init(LoopbackRegistrar *self) {}
+
+LoopbackRegistrar *loopback_registrar_new(FlBinaryMessenger *messenger) {
+  auto *self = LOOPBACK_REGISTRAR(
+      g_object_new(loopback_registrar_get_type(), nullptr));
+  self->messenger = FL_BINARY_MESSENGER(g_object_ref(messenger));
+  return self;
+}
@@ -0,0 +1,23 @@
+#ifndef WEBVIEW_WINDOW_LINUX_BENCHMARK_LOOPBACK_MESSENGER_H_
+#define WEBVIEW_WINDOW_LINUX_BENCHMARK_LOOPBACK_MESSENGER_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+// A binary messenger connected to a peer instead of an engine. Messages
+// sent on one messenger of a pair arrive at the handlers registered on the
+// other, from the main loop, like platform messages of the engine do.
+G_DECLARE_FINAL_TYPE(LoopbackMessenger, loopback_messenger, LOOPBACK,
+                     MESSENGER, GObject)
+
+// Creates two connected messengers, each holding a weak pointer to the
+// other.
+void loopback_messenger_new_pair(LoopbackMessenger **first,
+                                 LoopbackMessenger **second);
+
+// A plugin registrar handing out |messenger|, without textures or a view.
+G_DECLARE_FINAL_TYPE(LoopbackRegistrar, loopback_registrar, LOOPBACK,
+                     REGISTRAR, GObject)
+
+LoopbackRegistrar *loopback_registrar_new(FlBinaryMessenger *messenger);
+
+#endif  // WEBVIEW_WINDOW_LINUX_BENCHMARK_LOOPBACK_MESSENGER_H_
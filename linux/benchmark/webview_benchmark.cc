@@ -0,0 +1,433 @@
+// Drives the plugin through its method channel the way the Dart side does,
+// against a local HTTP server, and prints the latency distribution of each
+// operation. Needs a display, run it under xvfb-run on headless machines.
+//
+//   webview_window_benchmark [--iterations N] [--pool N] [--json]
+//   webview_window_benchmark --dispatch [--iterations N] [--json]
+//
+// --dispatch only times the method dispatch, without a display or a
+// webview, see dispatch_benchmark.h.
+//
+// Exits with 1 if a call fails or a page does not load, so it also serves
+// as an integration test of the hot paths.
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+#include <libsoup/soup.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "desktop_webview_window/desktop_webview_window_plugin.h"
+#include "dispatch_benchmark.h"
+#include "loopback_messenger.h"
+
+namespace {
+
+constexpr int kNavigationTimeoutMs = 10000;
+
+struct Options {
+  int iterations = 50;
+  int pool_size = 0;
+  bool json = false;
+  bool dispatch = false;
+};
+
+bool parse_options(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      options->iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--pool") == 0 && i + 1 < argc) {
+      options->pool_size = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      options->json = true;
+    } else if (strcmp(argv[i], "--dispatch") == 0) {
+      options->dispatch = true;
+    } else {
+      return false;
+    }
+  }
+  return options->iterations > 0 && options->pool_size >= 0;
+}
+
+double now_ms() { return g_get_monotonic_time() / 1000.0; }
+
+// Latency samples per operation, reported in the order operations first
+// appeared.
+class LatencyRecorder {
+ public:
+  void Add(const std::string &operation, double ms) {
+    auto it = samples_.find(operation);
+    if (it == samples_.end()) {
+      order_.push_back(operation);
+      it = samples_.insert({operation, {}}).first;
+    }
+    it->second.push_back(ms);
+  }
+
+  void Print(bool json) const {
+    if (json) {
+      printf("{");
+    } else {
+      printf("%-20s %6s %9s %9s %9s %9s %9s %9s\n", "operation", "count",
+             "min", "p50", "p90", "p99", "max", "mean");
+    }
+    for (size_t i = 0; i < order_.size(); ++i) {
+      auto samples = samples_.at(order_[i]);
+      std::sort(samples.begin(), samples.end());
+      double sum = 0;
+      for (auto sample : samples) {
+        sum += sample;
+      }
+      auto mean = sum / samples.size();
+      if (json) {
+        printf("%s\"%s\":{\"count\":%zu,\"min\":%.3f,\"p50\":%.3f,"
+               "\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f,\"mean\":%.3f}",
+               i ? "," : "", order_[i].c_str(), samples.size(),
+               samples.front(), Percentile(samples, 50),
+               Percentile(samples, 90), Percentile(samples, 99),
+               samples.back(), mean);
+      } else {
+        printf("%-20s %6zu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+               order_[i].c_str(), samples.size(), samples.front(),
+               Percentile(samples, 50), Percentile(samples, 90),
+               Percentile(samples, 99), samples.back(), mean);
+      }
+    }
+    if (json) {
+      printf("}\n");
+    } else {
+      printf("(milliseconds)\n");
+    }
+  }
+
+ private:
+  std::map<std::string, std::vector<double>> samples_;
+  std::vector<std::string> order_;
+
+  // Nearest-rank percentile of sorted |samples|.
+  static double Percentile(const std::vector<double> &samples, int percent) {
+    auto rank = static_cast<size_t>(
+        std::ceil(percent / 100.0 * samples.size()));
+    return samples[std::max<size_t>(rank, 1) - 1];
+  }
+};
+
+// Serves a page with a few subresources and a cookie, standing in for the
+// network so runs are repeatable.
+class TestServer {
+ public:
+  TestServer() : server_(soup_server_new(nullptr)) {
+    soup_server_add_handler(server_, nullptr, HandleRequest, nullptr,
+                            nullptr);
+  }
+
+  ~TestServer() { g_object_unref(server_); }
+
+  bool Start(GError **error) {
+    if (!soup_server_listen_local(server_, 0, SOUP_SERVER_LISTEN_IPV4_ONLY,
+                                  error)) {
+      return false;
+    }
+    auto *uris = soup_server_get_uris(server_);
+    g_autofree gchar *uri =
+        g_uri_to_string(static_cast<GUri *>(uris->data));
+    base_url_ = uri;
+    g_slist_free_full(uris, reinterpret_cast<GDestroyNotify>(g_uri_unref));
+    return true;
+  }
+
+  // Ends with a slash.
+  const std::string &base_url() const { return base_url_; }
+
+ private:
+  SoupServer *server_;
+  std::string base_url_;
+
+  static void HandleRequest(SoupServer *server, SoupServerMessage *message,
+                            const char *path, GHashTable *query,
+                            gpointer user_data) {
+    static const char kPage[] =
+        "<!DOCTYPE html><html><head><title>benchmark</title>"
+        "<link rel=\"stylesheet\" href=\"/style.css\">"
+        "<script src=\"/script.js\"></script></head>"
+        "<body><h1>benchmark</h1><p id=\"text\"></p></body></html>";
+    static const char kStyle[] = "body { font-family: sans-serif; }";
+    static const char kScript[] =
+        "addEventListener('DOMContentLoaded', () => {"
+        "  document.getElementById('text').textContent = location.href;"
+        "});";
+
+    const char *content_type = "text/html";
+    const char *body = kPage;
+    if (strcmp(path, "/style.css") == 0) {
+      content_type = "text/css";
+      body = kStyle;
+    } else if (strcmp(path, "/script.js") == 0) {
+      content_type = "text/javascript";
+      body = kScript;
+    } else {
+      soup_message_headers_append(
+          soup_server_message_get_response_headers(message), "Set-Cookie",
+          "session=benchmark; Path=/");
+    }
+    soup_server_message_set_status(message, SOUP_STATUS_OK, nullptr);
+    soup_server_message_set_response(message, content_type, SOUP_MEMORY_STATIC,
+                                     body, strlen(body));
+  }
+};
+
+// Plays the Dart side of the webview_window channel.
+class Harness {
+ public:
+  Harness() {
+    LoopbackMessenger *plugin_side;
+    loopback_messenger_new_pair(&plugin_side, &dart_side_);
+    registrar_ = loopback_registrar_new(FL_BINARY_MESSENGER(plugin_side));
+    g_object_unref(plugin_side);
+    desktop_webview_window_plugin_register_with_registrar(
+        FL_PLUGIN_REGISTRAR(registrar_));
+
+    g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+    channel_ = fl_method_channel_new(FL_BINARY_MESSENGER(dart_side_),
+                                     "webview_window", FL_METHOD_CODEC(codec));
+    fl_method_channel_set_method_call_handler(channel_, HandleEvent, this,
+                                              nullptr);
+  }
+
+  ~Harness() {
+    g_object_unref(channel_);
+    g_object_unref(registrar_);
+    g_object_unref(dart_side_);
+  }
+
+  // Invokes |method| and runs the main loop until it is answered. Stores a
+  // new reference to the result in |result| if not null.
+  bool Call(const char *method, FlValue *args, FlValue **result = nullptr) {
+    struct PendingCall {
+      bool done = false;
+      FlMethodResponse *response = nullptr;
+      GError *error = nullptr;
+    } pending;
+    fl_method_channel_invoke_method(
+        channel_, method, args, nullptr,
+        [](GObject *object, GAsyncResult *async_result, gpointer user_data) {
+          auto *pending = static_cast<PendingCall *>(user_data);
+          pending->response = fl_method_channel_invoke_method_finish(
+              FL_METHOD_CHANNEL(object), async_result, &pending->error);
+          pending->done = true;
+        },
+        &pending);
+    while (!pending.done) {
+      g_main_context_iteration(nullptr, TRUE);
+    }
+    if (pending.response == nullptr) {
+      fprintf(stderr, "%s: %s\n", method, pending.error->message);
+      g_error_free(pending.error);
+      return false;
+    }
+    g_autoptr(FlMethodResponse) response = pending.response;
+    g_autoptr(GError) error = nullptr;
+    auto *value = fl_method_response_get_result(response, &error);
+    if (value == nullptr) {
+      fprintf(stderr, "%s: %s\n", method, error->message);
+      return false;
+    }
+    if (result) {
+      *result = fl_value_ref(value);
+    }
+    return true;
+  }
+
+  // Forgets the events received so far.
+  void ClearEvents() { events_.clear(); }
+
+  // Runs the main loop until |event| arrived for |view_id|, or for at most
+  // |timeout_ms|.
+  bool WaitForEvent(const char *event, int64_t view_id, int timeout_ms) {
+    auto key = std::make_pair(std::string(event), view_id);
+    auto timed_out = false;
+    auto timeout = g_timeout_add(
+        timeout_ms,
+        [](gpointer user_data) -> gboolean {
+          *static_cast<bool *>(user_data) = true;
+          return G_SOURCE_REMOVE;
+        },
+        &timed_out);
+    while (events_.count(key) == 0 && !timed_out) {
+      g_main_context_iteration(nullptr, TRUE);
+    }
+    if (!timed_out) {
+      g_source_remove(timeout);
+    }
+    return !timed_out;
+  }
+
+  // Runs the main loop until it has nothing left to do.
+  void Drain() {
+    while (g_main_context_iteration(nullptr, FALSE)) {
+    }
+  }
+
+ private:
+  LoopbackMessenger *dart_side_;
+  LoopbackRegistrar *registrar_;
+  FlMethodChannel *channel_;
+  std::map<std::pair<std::string, int64_t>, int> events_;
+
+  static void HandleEvent(FlMethodChannel *channel, FlMethodCall *call,
+                          gpointer user_data) {
+    auto *harness = static_cast<Harness *>(user_data);
+    auto *args = fl_method_call_get_args(call);
+    auto *id = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                   ? fl_value_lookup_string(args, "id")
+                   : nullptr;
+    if (id && fl_value_get_type(id) == FL_VALUE_TYPE_INT) {
+      harness->events_[{fl_method_call_get_name(call),
+                        fl_value_get_int(id)}]++;
+    }
+    // onUrlRequested waits for a decision, everything else ignores this.
+    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+    fl_method_call_respond_success(call, result, nullptr);
+  }
+};
+
+FlValue *view_args(int64_t view_id) {
+  auto *args = fl_value_new_map();
+  fl_value_set_string_take(args, "viewId", fl_value_new_int(view_id));
+  return args;
+}
+
+// Runs one create, navigate, evaluate, cookies, close cycle.
+bool run_iteration(Harness *harness, const std::string &url,
+                   LatencyRecorder *recorder) {
+  g_autoptr(FlValue) create_args = fl_value_new_map();
+  fl_value_set_string_take(create_args, "windowWidth", fl_value_new_int(800));
+  fl_value_set_string_take(create_args, "windowHeight", fl_value_new_int(600));
+  fl_value_set_string_take(create_args, "title", fl_value_new_string(""));
+  fl_value_set_string_take(create_args, "headless", fl_value_new_bool(TRUE));
+  auto start = now_ms();
+  g_autoptr(FlValue) view_id_value = nullptr;
+  if (!harness->Call("create", create_args, &view_id_value)) {
+    return false;
+  }
+  recorder->Add("create", now_ms() - start);
+  auto view_id = fl_value_get_int(view_id_value);
+
+  g_autoptr(FlValue) launch_args = view_args(view_id);
+  fl_value_set_string_take(launch_args, "url",
+                           fl_value_new_string(url.c_str()));
+  harness->ClearEvents();
+  start = now_ms();
+  if (!harness->Call("launch", launch_args)) {
+    return false;
+  }
+  if (!harness->WaitForEvent("onNavigationCompleted", view_id,
+                             kNavigationTimeoutMs)) {
+    fprintf(stderr, "navigation to %s timed out\n", url.c_str());
+    return false;
+  }
+  recorder->Add("navigate", now_ms() - start);
+
+  g_autoptr(FlValue) evaluate_args = view_args(view_id);
+  fl_value_set_string_take(
+      evaluate_args, "javaScriptString",
+      fl_value_new_string("document.getElementById('text').textContent"));
+  start = now_ms();
+  if (!harness->Call("evaluateJavaScript", evaluate_args)) {
+    return false;
+  }
+  recorder->Add("evaluateJavaScript", now_ms() - start);
+
+  g_autoptr(FlValue) cookie_args = view_args(view_id);
+  start = now_ms();
+  g_autoptr(FlValue) cookies = nullptr;
+  if (!harness->Call("getAllCookies", cookie_args, &cookies)) {
+    return false;
+  }
+  recorder->Add("getAllCookies", now_ms() - start);
+  if (fl_value_get_type(cookies) != FL_VALUE_TYPE_LIST ||
+      fl_value_get_length(cookies) == 0) {
+    fprintf(stderr, "getAllCookies returned no cookies\n");
+    return false;
+  }
+
+  // The cheapest window method, so this is the cost of the channel, the
+  // codec and the dispatch.
+  g_autoptr(FlValue) stats_args = view_args(view_id);
+  start = now_ms();
+  if (!harness->Call("getMessageStats", stats_args)) {
+    return false;
+  }
+  recorder->Add("dispatch", now_ms() - start);
+
+  g_autoptr(FlValue) close_args = view_args(view_id);
+  start = now_ms();
+  if (!harness->Call("close", close_args)) {
+    return false;
+  }
+  if (!harness->WaitForEvent("onWindowClose", view_id, kNavigationTimeoutMs)) {
+    fprintf(stderr, "close of %ld timed out\n", view_id);
+    return false;
+  }
+  recorder->Add("close", now_ms() - start);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--iterations N] [--pool N] [--json]\n"
+            "       %s --dispatch [--iterations N] [--json]\n",
+            argv[0], argv[0]);
+    return 2;
+  }
+  if (options.dispatch) {
+    run_dispatch_benchmark(options.iterations, options.json);
+    return 0;
+  }
+  if (!gtk_init_check(&argc, &argv)) {
+    fprintf(stderr, "no display, run under xvfb-run\n");
+    return 2;
+  }
+
+  TestServer server;
+  g_autoptr(GError) error = nullptr;
+  if (!server.Start(&error)) {
+    fprintf(stderr, "failed to start the server: %s\n", error->message);
+    return 1;
+  }
+
+  auto *harness = new Harness();
+  if (options.pool_size > 0) {
+    g_autoptr(FlValue) pool_args = fl_value_new_map();
+    fl_value_set_string_take(pool_args, "size",
+                             fl_value_new_int(options.pool_size));
+    if (!harness->Call("configurePool", pool_args)) {
+      return 1;
+    }
+  }
+
+  LatencyRecorder recorder;
+  auto ok = true;
+  for (int i = 0; i < options.iterations && ok; ++i) {
+    // Give the pool its idle time to refill, like an app between creates.
+    harness->Drain();
+    auto url = server.base_url() + "page/" + std::to_string(i);
+    ok = run_iteration(harness, url, &recorder);
+  }
+  recorder.Print(options.json);
+
+  delete harness;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+#include "content_filter_registry.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+struct ContentFilterRegistry::Operation {
+  ContentFilterRegistry *registry;
+  std::string identifier;
+  GBytes *source;
+  std::string checksum;
+  gint64 start_time;
+  AddCallback callback;
+};
+
+ContentFilterRegistry::ContentFilterRegistry()
+    : cancellable_(g_cancellable_new()) {
+  // g_build_filename() stops at the first null, so an unset program name
+  // would put the filters straight into the user data directory.
+  auto *program_name = g_get_prgname();
+  g_autofree gchar *directory = g_build_filename(
+      g_get_user_data_dir(),
+      program_name ? program_name : "desktop_webview_window",
+      "webview_content_filters", nullptr);
+  store_directory_ = directory;
+  store_ = webkit_user_content_filter_store_new(directory);
+}
+
+ContentFilterRegistry::~ContentFilterRegistry() {
+  // Pending operations see the cancellation and only free themselves.
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  for (auto &item : filters_) {
+    webkit_user_content_filter_unref(item.second);
+  }
+  g_object_unref(store_);
+}
+
+bool ContentFilterRegistry::IsValidIdentifier(const char *identifier) {
+  // Identifiers become file names in the store.
+  return identifier && *identifier && !strchr(identifier, '/') &&
+         strcmp(identifier, ".") != 0 && strcmp(identifier, "..") != 0;
+}
+
+void ContentFilterRegistry::Add(const std::string &identifier,
+                                GBytes *source, AddCallback callback) {
+  gsize size;
+  auto *data = g_bytes_get_data(source, &size);
+  g_autofree gchar *checksum = g_compute_checksum_for_data(
+      G_CHECKSUM_SHA256, static_cast<const guchar *>(data), size);
+  auto *operation =
+      new Operation{this,     identifier,           g_bytes_ref(source),
+                    checksum, g_get_monotonic_time(), std::move(callback)};
+
+  g_autofree gchar *stored_checksum = nullptr;
+  if (g_file_get_contents(ChecksumPath(identifier).c_str(), &stored_checksum,
+                          nullptr, nullptr) &&
+      operation->checksum == stored_checksum) {
+    webkit_user_content_filter_store_load(store_, identifier.c_str(),
+                                          cancellable_, OnLoaded, operation);
+  } else {
+    Compile(operation);
+  }
+}
+
+void ContentFilterRegistry::Remove(const std::string &identifier) {
+  auto it = filters_.find(identifier);
+  if (it != filters_.end()) {
+    webkit_user_content_filter_unref(it->second);
+    filters_.erase(it);
+  }
+  remove(ChecksumPath(identifier).c_str());
+  webkit_user_content_filter_store_remove(store_, identifier.c_str(), nullptr,
+                                          nullptr, nullptr);
+}
+
+void ContentFilterRegistry::ForEachFilter(
+    const FilterCallback &callback) const {
+  for (const auto &item : filters_) {
+    callback(item.second);
+  }
+}
+
+std::string ContentFilterRegistry::ChecksumPath(
+    const std::string &identifier) const {
+  auto name = identifier + ".sha256";
+  g_autofree gchar *path =
+      g_build_filename(store_directory_.c_str(), name.c_str(), nullptr);
+  return path;
+}
+
+void ContentFilterRegistry::Compile(Operation *operation) {
+  // The checksum is written once the compiled filter is saved, a crash in
+  // between only costs another compilation.
+  remove(ChecksumPath(operation->identifier).c_str());
+  webkit_user_content_filter_store_save(store_, operation->identifier.c_str(),
+                                        operation->source, cancellable_,
+                                        OnSaved, operation);
+}
+
+void ContentFilterRegistry::Finish(Operation *operation,
+                                   WebKitUserContentFilter *filter,
+                                   bool compiled, const GError *error) {
+  auto elapsed_ms =
+      (g_get_monotonic_time() - operation->start_time) / 1000.0;
+  if (filter) {
+    auto it = filters_.find(operation->identifier);
+    if (it != filters_.end()) {
+      webkit_user_content_filter_unref(it->second);
+    }
+    filters_[operation->identifier] = webkit_user_content_filter_ref(filter);
+  }
+  operation->callback(filter, compiled, elapsed_ms, error);
+  g_bytes_unref(operation->source);
+  delete operation;
+}
+
+void ContentFilterRegistry::OnLoaded(GObject *object, GAsyncResult *result,
+                                     gpointer user_data) {
+  auto *operation = static_cast<Operation *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  auto *filter = webkit_user_content_filter_store_load_finish(
+      WEBKIT_USER_CONTENT_FILTER_STORE(object), result, &error);
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    g_bytes_unref(operation->source);
+    delete operation;
+    return;
+  }
+  if (!filter) {
+    // The stored filter is gone or was written by another WebKit version.
+    operation->registry->Compile(operation);
+    return;
+  }
+  operation->registry->Finish(operation, filter, false, nullptr);
+  webkit_user_content_filter_unref(filter);
+}
+
+void ContentFilterRegistry::OnSaved(GObject *object, GAsyncResult *result,
+                                    gpointer user_data) {
+  auto *operation = static_cast<Operation *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  auto *filter = webkit_user_content_filter_store_save_finish(
+      WEBKIT_USER_CONTENT_FILTER_STORE(object), result, &error);
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    g_bytes_unref(operation->source);
+    delete operation;
+    return;
+  }
+  auto *registry = operation->registry;
+  if (filter) {
+    g_file_set_contents(registry->ChecksumPath(operation->identifier).c_str(),
+                        operation->checksum.c_str(), -1, nullptr);
+  }
+  registry->Finish(operation, filter, true, error);
+  if (filter) {
+    webkit_user_content_filter_unref(filter);
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef WEBVIEW_WINDOW_LINUX_CONTENT_FILTER_REGISTRY_H_
+#define WEBVIEW_WINDOW_LINUX_CONTENT_FILTER_REGISTRY_H_
+
+#include <glib.h>
+#include <webkit2/webkit2.h>
+
+#include <functional>
+#include <map>
+#include <string>
+
+// Compiles content-blocker JSON into a WebKitUserContentFilterStore and
+// keeps the compiled filters for attaching to every window.
+//
+// Next to each compiled list the store directory holds a SHA-256 of its
+// source, so adding an unchanged list again, also after a restart, loads
+// the compiled filter instead of compiling it again.
+class ContentFilterRegistry {
+ public:
+  // Receives the filter, or null and |error| if it could not be compiled;
+  // |compiled| tells whether the source was compiled or the stored filter
+  // was reused, |elapsed_ms| how long that took.
+  typedef std::function<void(WebKitUserContentFilter *filter, bool compiled,
+                             double elapsed_ms, const GError *error)>
+      AddCallback;
+  typedef std::function<void(WebKitUserContentFilter *filter)> FilterCallback;
+
+  ContentFilterRegistry();
+
+  ~ContentFilterRegistry();
+
+  ContentFilterRegistry(const ContentFilterRegistry &) = delete;
+  ContentFilterRegistry &operator=(const ContentFilterRegistry &) = delete;
+
+  // Whether |identifier| can name a filter in the store.
+  static bool IsValidIdentifier(const char *identifier);
+
+  // Compiles |source| as filter |identifier|, replacing a filter with the
+  // same identifier. |callback| is not run if the registry is destroyed
+  // first.
+  void Add(const std::string &identifier, GBytes *source,
+           AddCallback callback);
+
+  // Forgets filter |identifier| and deletes it from the store.
+  void Remove(const std::string &identifier);
+
+  void ForEachFilter(const FilterCallback &callback) const;
+
+ private:
+  struct Operation;
+
+  std::string store_directory_;
+  WebKitUserContentFilterStore *store_;
+  GCancellable *cancellable_;
+  std::map<std::string, WebKitUserContentFilter *> filters_;
+
+  std::string ChecksumPath(const std::string &identifier) const;
+
+  void Compile(Operation *operation);
+
+  void Finish(Operation *operation, WebKitUserContentFilter *filter,
+              bool compiled, const GError *error);
+
+  static void OnLoaded(GObject *object, GAsyncResult *result,
+                       gpointer user_data);
+
+  static void OnSaved(GObject *object, GAsyncResult *result,
+                      gpointer user_data);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_CONTENT_FILTER_REGISTRY_H_
@@ -0,0 +1,626 @@
+#include "cookies.h"
+
+#include <cstring>
+#include <memory>
+#include <utility>
+
+unsigned int cookie_field_from_name(const char *name) {
+  static const struct {
+    const char *name;
+    unsigned int field;
+  } kFields[] = {
+      {"name", kCookieFieldName},
+      {"value", kCookieFieldValue},
+      {"domain", kCookieFieldDomain},
+      {"path", kCookieFieldPath},
+      {"expires", kCookieFieldExpires},
+      {"httpOnly", kCookieFieldHttpOnly},
+      {"secure", kCookieFieldSecure},
+      {"sessionOnly", kCookieFieldSessionOnly},
+  };
+  for (const auto &entry : kFields) {
+    if (strcmp(entry.name, name) == 0) {
+      return entry.field;
+    }
+  }
+  return 0;
+}
+
+bool cookie_domain_matches(const char *cookie_domain,
+                           const std::string &domain) {
+  if (cookie_domain == nullptr) {
+    return false;
+  }
+  while (*cookie_domain == '.') {
+    cookie_domain++;
+  }
+  auto offset = domain.find_first_not_of('.');
+  if (offset == std::string::npos) {
+    return true;
+  }
+  auto wanted = domain.c_str() + offset;
+  auto cookie_length = strlen(cookie_domain);
+  auto wanted_length = domain.size() - offset;
+  if (cookie_length < wanted_length) {
+    return false;
+  }
+  auto *suffix = cookie_domain + cookie_length - wanted_length;
+  if (g_ascii_strcasecmp(suffix, wanted) != 0) {
+    return false;
+  }
+  return suffix == cookie_domain || suffix[-1] == '.';
+}
+
+bool cookie_matches(SoupCookie *cookie, const CookieFilter &filter) {
+  if (!filter.domain.empty() &&
+      !cookie_domain_matches(soup_cookie_get_domain(cookie), filter.domain)) {
+    return false;
+  }
+  return filter.name_prefix.empty() ||
+         g_str_has_prefix(soup_cookie_get_name(cookie),
+                          filter.name_prefix.c_str());
+}
+
+FlValue *cookie_to_fl_value(SoupCookie *cookie, unsigned int fields) {
+  auto *cookie_map = fl_value_new_map();
+  if (fields & kCookieFieldName) {
+    fl_value_set_string_take(cookie_map, "name",
+                             fl_value_new_string(soup_cookie_get_name(cookie)));
+  }
+  if (fields & kCookieFieldValue) {
+    fl_value_set_string_take(
+        cookie_map, "value",
+        fl_value_new_string(soup_cookie_get_value(cookie)));
+  }
+  if (fields & kCookieFieldDomain) {
+    fl_value_set_string_take(
+        cookie_map, "domain",
+        fl_value_new_string(soup_cookie_get_domain(cookie)));
+  }
+  if (fields & kCookieFieldPath) {
+    fl_value_set_string_take(cookie_map, "path",
+                             fl_value_new_string(soup_cookie_get_path(cookie)));
+  }
+  // Session cookies have no expiry date.
+  auto *expires = soup_cookie_get_expires(cookie);
+  if (fields & kCookieFieldExpires) {
+    fl_value_set_string_take(
+        cookie_map, "expires",
+        expires ? fl_value_new_float(
+                      static_cast<double>(g_date_time_to_unix(expires)))
+                : fl_value_new_null());
+  }
+  if (fields & kCookieFieldHttpOnly) {
+    fl_value_set_string_take(
+        cookie_map, "httpOnly",
+        fl_value_new_bool(soup_cookie_get_http_only(cookie)));
+  }
+  if (fields & kCookieFieldSecure) {
+    fl_value_set_string_take(cookie_map, "secure",
+                             fl_value_new_bool(soup_cookie_get_secure(cookie)));
+  }
+  if (fields & kCookieFieldSessionOnly) {
+    fl_value_set_string_take(cookie_map, "sessionOnly",
+                             fl_value_new_bool(expires == nullptr));
+  }
+  return cookie_map;
+}
+
+namespace {
+
+const char *lookup_string(FlValue *map, const char *key) {
+  auto *value = fl_value_lookup_string(map, key);
+  return value && fl_value_get_type(value) == FL_VALUE_TYPE_STRING
+             ? fl_value_get_string(value)
+             : nullptr;
+}
+
+bool lookup_bool(FlValue *map, const char *key) {
+  auto *value = fl_value_lookup_string(map, key);
+  return value && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL &&
+         fl_value_get_bool(value);
+}
+
+// Counts the answers to the calls of one apply_cookies().
+struct CookieBatch {
+  FlMethodCall *call;
+  bool remove;
+  int count;
+  int remaining;
+  int failed;
+};
+
+void respond_cookie_count(FlMethodCall *call, int count, int failed) {
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "count", fl_value_new_int(count));
+  fl_value_set_string_take(result, "failed", fl_value_new_int(failed));
+  fl_method_call_respond_success(call, result, nullptr);
+}
+
+void on_cookie_applied(GObject *object, GAsyncResult *result,
+                       gpointer user_data) {
+  auto *batch = static_cast<CookieBatch *>(user_data);
+  auto *cookie_manager = WEBKIT_COOKIE_MANAGER(object);
+  g_autoptr(GError) error = nullptr;
+  auto applied =
+      batch->remove
+          ? webkit_cookie_manager_delete_cookie_finish(cookie_manager, result,
+                                                       &error)
+          : webkit_cookie_manager_add_cookie_finish(cookie_manager, result,
+                                                    &error);
+  if (!applied) {
+    batch->failed++;
+  }
+  if (--batch->remaining == 0) {
+    respond_cookie_count(batch->call, batch->count, batch->failed);
+    g_object_unref(batch->call);
+    delete batch;
+  }
+}
+
+// Strips the leading dots, which only mark a domain cookie.
+const char *bare_domain(const char *domain) {
+  while (domain && *domain == '.') {
+    domain++;
+  }
+  return domain;
+}
+
+// Deletes the live cookies matching the name, domain and path of the
+// cookies of one delete, so their values do not have to be known.
+struct CookieDeleteRequest {
+  FlMethodCall *call;
+  WebKitCookieManager *cookie_manager;
+  int count;
+  int remaining;
+  int failed = 0;
+  // Live cookies to delete.
+  GList *matches = nullptr;
+
+  ~CookieDeleteRequest() {
+    g_object_unref(call);
+    g_object_unref(cookie_manager);
+  }
+};
+
+struct CookieLookup {
+  CookieDeleteRequest *request;
+  SoupCookie *wanted;
+};
+
+void on_cookies_for_delete(GObject *object, GAsyncResult *result,
+                           gpointer user_data) {
+  std::unique_ptr<CookieLookup> lookup(static_cast<CookieLookup *>(user_data));
+  auto *request = lookup->request;
+  g_autoptr(GError) error = nullptr;
+  auto *cookies = webkit_cookie_manager_get_cookies_finish(
+      WEBKIT_COOKIE_MANAGER(object), result, &error);
+  auto *wanted = lookup->wanted;
+  auto matched = false;
+  for (auto *item = cookies; item; item = item->next) {
+    auto *cookie = static_cast<SoupCookie *>(item->data);
+    if (strcmp(soup_cookie_get_name(cookie), soup_cookie_get_name(wanted)) ==
+            0 &&
+        strcmp(soup_cookie_get_path(cookie), soup_cookie_get_path(wanted)) ==
+            0 &&
+        g_ascii_strcasecmp(bare_domain(soup_cookie_get_domain(cookie)),
+                           bare_domain(soup_cookie_get_domain(wanted))) ==
+            0) {
+      request->matches =
+          g_list_prepend(request->matches, soup_cookie_copy(cookie));
+      matched = true;
+    }
+  }
+  g_list_free_full(cookies, reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+  soup_cookie_free(wanted);
+  if (!matched) {
+    request->failed++;
+  }
+  if (--request->remaining > 0) {
+    return;
+  }
+
+  std::unique_ptr<CookieDeleteRequest> done(request);
+  auto live = static_cast<int>(g_list_length(done->matches));
+  if (live == 0) {
+    respond_cookie_count(done->call, done->count, done->failed);
+    return;
+  }
+  auto *batch = new CookieBatch{FL_METHOD_CALL(g_object_ref(done->call)),
+                                true, done->count, live, done->failed};
+  for (auto *item = done->matches; item; item = item->next) {
+    webkit_cookie_manager_delete_cookie(
+        done->cookie_manager, static_cast<SoupCookie *>(item->data), nullptr,
+        on_cookie_applied, batch);
+  }
+  g_list_free_full(done->matches,
+                   reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+}
+
+// Looks up the live cookies of |cookies| and deletes them, see
+// apply_cookies(). Takes ownership of |cookies|.
+void delete_cookies(WebKitCookieManager *cookie_manager, GList *cookies,
+                    FlMethodCall *call) {
+  auto count = static_cast<int>(g_list_length(cookies));
+  auto *request = new CookieDeleteRequest{
+      FL_METHOD_CALL(g_object_ref(call)),
+      WEBKIT_COOKIE_MANAGER(g_object_ref(cookie_manager)), count, count};
+  // Every release can read the cookies of a URI, and those of the domain
+  // and path of a cookie include it. https, so secure cookies are listed.
+  for (auto *item = cookies; item; item = item->next) {
+    auto *cookie = static_cast<SoupCookie *>(item->data);
+    g_autofree gchar *uri =
+        g_strconcat("https://", bare_domain(soup_cookie_get_domain(cookie)),
+                    soup_cookie_get_path(cookie), nullptr);
+    webkit_cookie_manager_get_cookies(cookie_manager, uri, nullptr,
+                                      on_cookies_for_delete,
+                                      new CookieLookup{request, cookie});
+  }
+  g_list_free(cookies);
+}
+
+struct CookieFileRequest {
+  FlMethodCall *call;
+  WebKitCookieManager *cookie_manager;
+  std::string path;
+  bool replace;
+  // Cookies written by an export.
+  int count = 0;
+
+  ~CookieFileRequest() {
+    g_object_unref(call);
+    g_object_unref(cookie_manager);
+  }
+};
+
+void on_cookie_file_written(GObject *object, GAsyncResult *result,
+                            gpointer user_data) {
+  std::unique_ptr<CookieFileRequest> request(
+      static_cast<CookieFileRequest *>(user_data));
+  g_autoptr(GError) error = nullptr;
+  if (!g_file_replace_contents_finish(G_FILE(object), result, nullptr,
+                                      &error)) {
+    fl_method_call_respond_error(request->call, "0", error->message, nullptr,
+                                 nullptr);
+    return;
+  }
+  g_autoptr(FlValue) response = fl_value_new_map();
+  fl_value_set_string_take(response, "count",
+                           fl_value_new_int(request->count));
+  fl_method_call_respond_success(request->call, response, nullptr);
+}
+
+#if WEBKIT_CHECK_VERSION(2, 42, 0)
+void on_cookies_for_export(GObject *object, GAsyncResult *result,
+                           gpointer user_data) {
+  std::unique_ptr<CookieFileRequest> request(
+      static_cast<CookieFileRequest *>(user_data));
+  g_autoptr(GError) error = nullptr;
+  auto *cookies = webkit_cookie_manager_get_all_cookies_finish(
+      WEBKIT_COOKIE_MANAGER(object), result, &error);
+  if (error) {
+    fl_method_call_respond_error(request->call, "0", error->message, nullptr,
+                                 nullptr);
+    return;
+  }
+  g_autoptr(FlValue) list = fl_value_new_list();
+  for (auto *item = cookies; item; item = item->next) {
+    fl_value_append_take(list,
+                         cookie_to_fl_value(static_cast<SoupCookie *>(
+                                                item->data),
+                                            kCookieFieldAll));
+  }
+  g_list_free_full(cookies, reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+
+  g_autoptr(FlJsonMessageCodec) codec = fl_json_message_codec_new();
+  g_autofree gchar *json = fl_json_message_codec_encode(codec, list, &error);
+  if (json == nullptr) {
+    fl_method_call_respond_error(request->call, "0", error->message, nullptr,
+                                 nullptr);
+    return;
+  }
+  request->count = static_cast<int>(fl_value_get_length(list));
+  auto length = strlen(json);
+  g_autoptr(GBytes) bytes = g_bytes_new_take(g_steal_pointer(&json), length);
+  g_autoptr(GFile) file = g_file_new_for_path(request->path.c_str());
+  g_file_replace_contents_bytes_async(
+      file, bytes, nullptr, FALSE, G_FILE_CREATE_PRIVATE, nullptr,
+      on_cookie_file_written, request.release());
+}
+#endif
+
+void on_cookie_file_loaded(GObject *object, GAsyncResult *result,
+                           gpointer user_data) {
+  std::unique_ptr<CookieFileRequest> request(
+      static_cast<CookieFileRequest *>(user_data));
+  g_autoptr(GError) error = nullptr;
+  g_autofree gchar *contents = nullptr;
+  if (!g_file_load_contents_finish(G_FILE(object), result, &contents, nullptr,
+                                   nullptr, &error)) {
+    fl_method_call_respond_error(request->call, "0", error->message, nullptr,
+                                 nullptr);
+    return;
+  }
+  g_autoptr(FlJsonMessageCodec) codec = fl_json_message_codec_new();
+  g_autoptr(FlValue) list =
+      fl_json_message_codec_decode(codec, contents, &error);
+  if (list == nullptr || fl_value_get_type(list) != FL_VALUE_TYPE_LIST) {
+    fl_method_call_respond_error(
+        request->call, "0",
+        error ? error->message : "cookie file does not hold a list", nullptr,
+        nullptr);
+    return;
+  }
+  // Entries without a name or domain are skipped.
+  GList *cookies = nullptr;
+  for (size_t i = 0; i < fl_value_get_length(list); ++i) {
+    auto *cookie = cookie_from_fl_value(fl_value_get_list_value(list, i));
+    if (cookie) {
+      cookies = g_list_prepend(cookies, cookie);
+    }
+  }
+  cookies = g_list_reverse(cookies);
+  if (!request->replace) {
+    apply_cookies(request->cookie_manager, cookies, false, request->call);
+    return;
+  }
+#if WEBKIT_CHECK_VERSION(2, 42, 0)
+  auto count = static_cast<int>(g_list_length(cookies));
+  struct ReplaceRequest {
+    FlMethodCall *call;
+    int count;
+  };
+  webkit_cookie_manager_replace_cookies(
+      request->cookie_manager, cookies, nullptr,
+      [](GObject *object, GAsyncResult *result, gpointer user_data) {
+        std::unique_ptr<ReplaceRequest> request(
+            static_cast<ReplaceRequest *>(user_data));
+        g_autoptr(GError) error = nullptr;
+        if (webkit_cookie_manager_replace_cookies_finish(
+                WEBKIT_COOKIE_MANAGER(object), result, &error)) {
+          respond_cookie_count(request->call, request->count, 0);
+        } else {
+          fl_method_call_respond_error(request->call, "0", error->message,
+                                       nullptr, nullptr);
+        }
+        g_object_unref(request->call);
+      },
+      new ReplaceRequest{FL_METHOD_CALL(g_object_ref(request->call)), count});
+#else
+  fl_method_call_respond_error(request->call, "0",
+                               "replacing cookies needs WebKitGTK 2.42",
+                               nullptr, nullptr);
+#endif
+  g_list_free_full(cookies, reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+}
+
+}  // namespace
+
+SoupCookie *cookie_from_fl_value(FlValue *value) {
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_MAP) {
+    return nullptr;
+  }
+  auto *name = lookup_string(value, "name");
+  auto *domain = lookup_string(value, "domain");
+  if (name == nullptr || domain == nullptr) {
+    return nullptr;
+  }
+  auto *cookie_value = lookup_string(value, "value");
+  auto *path = lookup_string(value, "path");
+  auto *cookie = soup_cookie_new(name, cookie_value ? cookie_value : "",
+                                 domain, path && *path ? path : "/", -1);
+  auto *expires = fl_value_lookup_string(value, "expires");
+  if (expires && (fl_value_get_type(expires) == FL_VALUE_TYPE_INT ||
+                  fl_value_get_type(expires) == FL_VALUE_TYPE_FLOAT)) {
+    auto seconds = fl_value_get_type(expires) == FL_VALUE_TYPE_INT
+                       ? fl_value_get_int(expires)
+                       : static_cast<int64_t>(fl_value_get_float(expires));
+    g_autoptr(GDateTime) date = g_date_time_new_from_unix_utc(seconds);
+    soup_cookie_set_expires(cookie, date);
+  }
+  soup_cookie_set_secure(cookie, lookup_bool(value, "secure"));
+  soup_cookie_set_http_only(cookie, lookup_bool(value, "httpOnly"));
+  return cookie;
+}
+
+void apply_cookies(WebKitCookieManager *cookie_manager, GList *cookies,
+                   bool remove, FlMethodCall *call) {
+  auto count = static_cast<int>(g_list_length(cookies));
+  if (count == 0) {
+    respond_cookie_count(call, 0, 0);
+    return;
+  }
+  if (remove) {
+    delete_cookies(cookie_manager, cookies, call);
+    return;
+  }
+  auto *batch = new CookieBatch{FL_METHOD_CALL(g_object_ref(call)), remove,
+                                count, count, 0};
+  // WebKit copies each cookie before it returns.
+  for (auto *item = cookies; item; item = item->next) {
+    webkit_cookie_manager_add_cookie(cookie_manager,
+                                     static_cast<SoupCookie *>(item->data),
+                                     nullptr, on_cookie_applied, batch);
+  }
+  g_list_free_full(cookies, reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+}
+
+void export_cookies(WebKitCookieManager *cookie_manager, const char *path,
+                    FlMethodCall *call) {
+#if WEBKIT_CHECK_VERSION(2, 42, 0)
+  webkit_cookie_manager_get_all_cookies(
+      cookie_manager, nullptr, on_cookies_for_export,
+      new CookieFileRequest{
+          FL_METHOD_CALL(g_object_ref(call)),
+          WEBKIT_COOKIE_MANAGER(g_object_ref(cookie_manager)), path, false});
+#else
+  fl_method_call_respond_error(call, "0",
+                               "exporting cookies needs WebKitGTK 2.42",
+                               nullptr, nullptr);
+#endif
+}
+
+void import_cookies(WebKitCookieManager *cookie_manager, const char *path,
+                    bool replace, FlMethodCall *call) {
+  g_autoptr(GFile) file = g_file_new_for_path(path);
+  g_file_load_contents_async(
+      file, nullptr, on_cookie_file_loaded,
+      new CookieFileRequest{
+          FL_METHOD_CALL(g_object_ref(call)),
+          WEBKIT_COOKIE_MANAGER(g_object_ref(cookie_manager)), path, replace});
+}
+
+bool CookieWatcher::CookieState::operator==(const CookieState &other) const {
+  return value == other.value && expires == other.expires &&
+         http_only == other.http_only && secure == other.secure;
+}
+
+CookieWatcher::CookieWatcher(FlMethodChannel *method_channel,
+                             int64_t window_id,
+                             WebKitCookieManager *cookie_manager,
+                             const CookieWatchConfig &config)
+    : method_channel_(method_channel),
+      window_id_(window_id),
+      cookie_manager_(
+          WEBKIT_COOKIE_MANAGER(g_object_ref(cookie_manager))),
+      config_(config),
+      cancellable_(g_cancellable_new()) {
+  g_signal_connect(cookie_manager_, "changed", G_CALLBACK(OnChanged), this);
+  // Reads the jar the index starts from.
+  Read();
+}
+
+CookieWatcher::~CookieWatcher() {
+  g_signal_handlers_disconnect_by_data(cookie_manager_, this);
+  if (read_source_) {
+    g_source_remove(read_source_);
+  }
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  g_object_unref(cookie_manager_);
+}
+
+void CookieWatcher::OnChanged(WebKitCookieManager *cookie_manager,
+                              gpointer user_data) {
+  static_cast<CookieWatcher *>(user_data)->ScheduleRead();
+}
+
+void CookieWatcher::ScheduleRead() {
+  if (reading_) {
+    changed_while_reading_ = true;
+    return;
+  }
+  if (read_source_) {
+    return;
+  }
+  read_source_ = g_timeout_add(
+      static_cast<guint>(config_.interval_ms),
+      [](gpointer user_data) -> gboolean {
+        auto *self = static_cast<CookieWatcher *>(user_data);
+        self->read_source_ = 0;
+        self->Read();
+        return G_SOURCE_REMOVE;
+      },
+      this);
+}
+
+void CookieWatcher::Read() {
+  reading_ = true;
+  changed_while_reading_ = false;
+  auto on_ready = [](GObject *object, GAsyncResult *result,
+                     gpointer user_data) {
+    g_autoptr(GError) error = nullptr;
+#if WEBKIT_CHECK_VERSION(2, 42, 0)
+    auto *cookies = webkit_cookie_manager_get_all_cookies_finish(
+        WEBKIT_COOKIE_MANAGER(object), result, &error);
+#else
+    auto *cookies = webkit_cookie_manager_get_cookies_finish(
+        WEBKIT_COOKIE_MANAGER(object), result, &error);
+#endif
+    // Cancelled when the watcher has been deleted.
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      return;
+    }
+    auto *self = static_cast<CookieWatcher *>(user_data);
+    if (error) {
+      g_warning("reading cookies failed: %s", error->message);
+    } else {
+      self->OnCookies(cookies);
+    }
+    g_list_free_full(cookies,
+                     reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+    self->reading_ = false;
+    if (self->changed_while_reading_) {
+      self->ScheduleRead();
+    }
+  };
+#if WEBKIT_CHECK_VERSION(2, 42, 0)
+  webkit_cookie_manager_get_all_cookies(cookie_manager_, cancellable_,
+                                        on_ready, this);
+#else
+  // Older releases only return the cookies of a URI, so the watcher sees
+  // the cookies sent to the root of the domain.
+  auto uri = "https://" + config_.domain.substr(
+                              config_.domain.find_first_not_of('.')) + "/";
+  webkit_cookie_manager_get_cookies(cookie_manager_, uri.c_str(),
+                                    cancellable_, on_ready, this);
+#endif
+}
+
+void CookieWatcher::OnCookies(GList *cookies) {
+  std::map<std::string, CookieState> index;
+  g_autoptr(FlValue) added = fl_value_new_list();
+  g_autoptr(FlValue) modified = fl_value_new_list();
+  for (auto *item = cookies; item; item = item->next) {
+    auto *cookie = static_cast<SoupCookie *>(item->data);
+    if (!config_.domain.empty() &&
+        !cookie_domain_matches(soup_cookie_get_domain(cookie),
+                               config_.domain)) {
+      continue;
+    }
+    auto *expires = soup_cookie_get_expires(cookie);
+    CookieState state{soup_cookie_get_name(cookie),
+                      soup_cookie_get_domain(cookie),
+                      soup_cookie_get_path(cookie),
+                      soup_cookie_get_value(cookie),
+                      expires ? g_date_time_to_unix(expires) : -1,
+                      soup_cookie_get_http_only(cookie) != FALSE,
+                      soup_cookie_get_secure(cookie) != FALSE};
+    auto key = state.domain + "\t" + state.path + "\t" + state.name;
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      fl_value_append_take(added, cookie_to_fl_value(cookie, kCookieFieldAll));
+    } else if (!(it->second == state)) {
+      fl_value_append_take(modified,
+                           cookie_to_fl_value(cookie, kCookieFieldAll));
+    }
+    index.insert({std::move(key), std::move(state)});
+  }
+  g_autoptr(FlValue) removed = fl_value_new_list();
+  for (const auto &item : index_) {
+    if (index.find(item.first) != index.end()) {
+      continue;
+    }
+    auto *cookie = fl_value_new_map();
+    fl_value_set_string_take(cookie, "name",
+                             fl_value_new_string(item.second.name.c_str()));
+    fl_value_set_string_take(cookie, "domain",
+                             fl_value_new_string(item.second.domain.c_str()));
+    fl_value_set_string_take(cookie, "path",
+                             fl_value_new_string(item.second.path.c_str()));
+    fl_value_append_take(removed, cookie);
+  }
+  index_ = std::move(index);
+  if (fl_value_get_length(added) == 0 && fl_value_get_length(modified) == 0 &&
+      fl_value_get_length(removed) == 0) {
+    return;
+  }
+  auto *args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(window_id_));
+  fl_value_set_string(args, "added", added);
+  fl_value_set_string(args, "modified", modified);
+  fl_value_set_string(args, "removed", removed);
+  fl_method_channel_invoke_method(method_channel_, "onCookiesChanged", args,
+                                  nullptr, nullptr, nullptr);
+  fl_value_unref(args);
+}
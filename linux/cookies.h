@@ -0,0 +1,133 @@
+#ifndef WEBVIEW_WINDOW_LINUX_COOKIES_H_
+#define WEBVIEW_WINDOW_LINUX_COOKIES_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <libsoup/soup.h>
+#include <webkit2/webkit2.h>
+
+#include <map>
+#include <string>
+
+// Cookie fields that can be requested from getAllCookies.
+enum CookieField {
+  kCookieFieldName = 1 << 0,
+  kCookieFieldValue = 1 << 1,
+  kCookieFieldDomain = 1 << 2,
+  kCookieFieldPath = 1 << 3,
+  kCookieFieldExpires = 1 << 4,
+  kCookieFieldHttpOnly = 1 << 5,
+  kCookieFieldSecure = 1 << 6,
+  kCookieFieldSessionOnly = 1 << 7,
+  kCookieFieldAll = (1 << 8) - 1,
+};
+
+// Returns the CookieField for a Dart field name, or 0 if unknown.
+unsigned int cookie_field_from_name(const char *name);
+
+struct CookieFilter {
+  // Only cookies for this domain or its subdomains, if not empty.
+  std::string domain;
+  // Only cookies whose name starts with this prefix, if not empty.
+  std::string name_prefix;
+  // Bitmask of CookieField values to serialize.
+  unsigned int fields = kCookieFieldAll;
+};
+
+// Whether |cookie_domain| is |domain| or one of its subdomains. Leading dots
+// are ignored on both sides.
+bool cookie_domain_matches(const char *cookie_domain,
+                           const std::string &domain);
+
+bool cookie_matches(SoupCookie *cookie, const CookieFilter &filter);
+
+// Returns a map with the |fields| of |cookie|, see the Dart WebviewCookie.
+FlValue *cookie_to_fl_value(SoupCookie *cookie, unsigned int fields);
+
+// Builds a cookie from a map like cookie_to_fl_value() returns. The path
+// defaults to "/" and a missing expiry makes a session cookie. Returns null
+// without a name or domain.
+SoupCookie *cookie_from_fl_value(FlValue *value);
+
+// Adds |cookies|, or deletes the cookies of the jar with their name, domain
+// and path whatever their value, and responds to |call| with {"count",
+// "failed"} once WebKit applied all of them. Cookies to delete that match
+// nothing count as failed. Takes ownership of |cookies|.
+void apply_cookies(WebKitCookieManager *cookie_manager, GList *cookies,
+                   bool remove, FlMethodCall *call);
+
+// Writes every cookie of |cookie_manager| to |path| as a JSON list of
+// cookie_to_fl_value() maps, and responds to |call| with {"count"}. Needs
+// WebKitGTK 2.42.
+void export_cookies(WebKitCookieManager *cookie_manager, const char *path,
+                    FlMethodCall *call);
+
+// Adds the cookies of a file written by export_cookies(), or with |replace|
+// replaces the whole jar with them, and responds like apply_cookies().
+// Replacing needs WebKitGTK 2.42.
+void import_cookies(WebKitCookieManager *cookie_manager, const char *path,
+                    bool replace, FlMethodCall *call);
+
+struct CookieWatchConfig {
+  // Only cookies for this domain or its subdomains, if not empty. Required
+  // before WebKitGTK 2.42, which can only read the cookies of a URI.
+  std::string domain;
+  // Changes are collected for this long before the jar is read, so a
+  // burst of changes ends up in one event.
+  int interval_ms = 250;
+};
+
+// Keeps an index of the cookies of a cookie manager and sends the
+// differences to Dart with onCookiesChanged.
+//
+// The "changed" signal of WebKitCookieManager does not say what changed, so
+// every batch of changes reads the jar once and compares it with the index.
+// The first event lists the cookies present when watching starts.
+class CookieWatcher {
+ public:
+  CookieWatcher(FlMethodChannel *method_channel, int64_t window_id,
+                WebKitCookieManager *cookie_manager,
+                const CookieWatchConfig &config);
+
+  ~CookieWatcher();
+
+  CookieWatcher(const CookieWatcher &) = delete;
+  CookieWatcher &operator=(const CookieWatcher &) = delete;
+
+ private:
+  // What is compared to detect a modified cookie.
+  struct CookieState {
+    std::string name;
+    std::string domain;
+    std::string path;
+    std::string value;
+    // Seconds since the epoch, -1 for session cookies.
+    gint64 expires;
+    bool http_only;
+    bool secure;
+
+    bool operator==(const CookieState &other) const;
+  };
+
+  FlMethodChannel *method_channel_;
+  int64_t window_id_;
+  WebKitCookieManager *cookie_manager_;
+  CookieWatchConfig config_;
+  // Cookies by domain, path and name.
+  std::map<std::string, CookieState> index_;
+  guint read_source_ = 0;
+  bool reading_ = false;
+  // The jar changed while it was read, so it is read again.
+  bool changed_while_reading_ = false;
+  GCancellable *cancellable_;
+
+  static void OnChanged(WebKitCookieManager *cookie_manager,
+                        gpointer user_data);
+
+  void ScheduleRead();
+
+  void Read();
+
+  void OnCookies(GList *cookies);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_COOKIES_H_
@@ -4,17 +4,83 @@
 #include <gtk/gtk.h>
 #include <webkit2/webkit2.h>
 
+#include <algorithm>
 #include <cstring>
-#include <map>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "asset_scheme_handler.h"
+#include "content_filter_registry.h"
+#include "disk_cache_limiter.h"
+#include "session_registry.h"
+#include "web_extension/web_extension_protocol.h"
+#include "web_extension_client.h"
 #include "webview_window.h"
 
 namespace {
 
 int64_t next_window_id_ = 0;
 
-}
+// Handler for methods that operate on the plugin itself.
+typedef void (*PluginMethodHandler)(WebviewWindowPlugin *self,
+                                    FlMethodCall *method_call, FlValue *args);
+
+// Handler for methods that target one window. The window is resolved from
+// the "viewId" argument before the handler is invoked.
+typedef void (*WindowMethodHandler)(WebviewWindowPlugin *self,
+                                    WebviewWindow *window,
+                                    FlMethodCall *method_call, FlValue *args);
+
+struct MethodEntry {
+  PluginMethodHandler plugin_handler;
+  WindowMethodHandler window_handler;
+  // Plugin handlers only: whether args must be a map.
+  bool requires_args;
+  // Window handlers only: whether the call leaves a discarded window
+  // discarded instead of restoring it.
+  bool passive;
+};
+
+// Method names are looked up by their C string, so a dispatch never
+// allocates. Keys point to string literals registered at plugin init.
+struct MethodNameHash {
+  size_t operator()(const char *name) const { return g_str_hash(name); }
+};
+
+struct MethodNameEqual {
+  bool operator()(const char *a, const char *b) const {
+    return strcmp(a, b) == 0;
+  }
+};
+
+typedef std::unordered_map<const char *, MethodEntry, MethodNameHash,
+                           MethodNameEqual>
+    MethodTable;
+
+typedef std::unordered_map<int64_t, std::unique_ptr<WebviewWindow>>
+    WindowRegistry;
+
+// Hidden, pre-warmed windows waiting to be claimed by "create".
+struct WindowPool {
+  std::deque<std::unique_ptr<WebviewWindow>> windows;
+  size_t size = 0;
+  guint refill_source = 0;
+};
+
+// Custom URI scheme handlers by scheme.
+typedef std::unordered_map<std::string, std::shared_ptr<AssetSchemeHandler>>
+    AssetSchemeRegistry;
+
+// Cache of small asset files per scheme unless configured otherwise.
+constexpr int64_t kDefaultAssetCacheSize = 8 * 1024 * 1024;
+
+}  // namespace
 
 #define WEBVIEW_WINDOW_PLUGIN(obj)                                     \
   (G_TYPE_CHECK_INSTANCE_CAST((obj), webview_window_plugin_get_type(), \
@@ -23,301 +89,1509 @@ int64_t next_window_id_ = 0;
 struct _WebviewWindowPlugin {
   GObject parent_instance;
   FlMethodChannel *method_channel;
-  std::map<int64_t, std::unique_ptr<WebviewWindow>> *windows;
+  WindowRegistry *windows;
+  WindowPool *pool;
+  SessionRegistry *sessions;
+  AssetSchemeRegistry *asset_schemes;
+  ContentFilterRegistry *content_filters;
+  UserScriptRegistry *user_scripts;
+  WindowDiscarder *discarder;
+  FlTextureRegistrar *texture_registrar;
+  MethodTable *methods;
 };
 
 G_DEFINE_TYPE(WebviewWindowPlugin, webview_window_plugin, g_object_get_type())
 
-// Called when a method call is received from Flutter.
-static void webview_window_plugin_handle_method_call(
-    WebviewWindowPlugin *self, FlMethodCall *method_call) {
-  const gchar *method = fl_method_call_get_name(method_call);
+static void respond_args_error(FlMethodCall *method_call) {
+  g_autofree gchar *message = g_strdup_printf(
+      "%s args is not map", fl_method_call_get_name(method_call));
+  fl_method_call_respond_error(method_call, "0", message, nullptr, nullptr);
+}
 
-  if (strcmp(method, "create") == 0) {
-
-    /// Menthod Channel test
-    // FlValue* args_value = fl_method_call_get_args(method_call);
-    // if (fl_value_get_type(args_value) == FL_VALUE_TYPE_MAP) {
-    //     g_print("Received keys:\n");
-    //     for (int i = 0; i < fl_value_get_length(args_value); ++i) {
-    //         FlValue* key = fl_value_get_map_key(args_value, i);
-    //         if (fl_value_get_type(key) == FL_VALUE_TYPE_STRING) {
-    //             g_print("- %s\n", fl_value_get_string(key));
-    //         }
-    //     }
-    // }
-
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "create args is not map",
-                                   nullptr, nullptr);
-      return;
-    }
-    auto width = fl_value_get_int(fl_value_lookup_string(args, "windowWidth"));
-    auto height =
-        fl_value_get_int(fl_value_lookup_string(args, "windowHeight"));
-    auto title = fl_value_get_string(fl_value_lookup_string(args, "title"));
-    auto headless_value = fl_value_lookup_string(args, "headless");
-    auto headless = false;
-    if (fl_value_get_type(headless_value) == FL_VALUE_TYPE_BOOL) {
-      headless = fl_value_get_bool(headless_value);
-    }
+static WebviewWindow *lookup_window(WebviewWindowPlugin *self,
+                                    FlValue *args) {
+  auto *view_id = fl_value_lookup_string(args, "viewId");
+  if (view_id == nullptr || fl_value_get_type(view_id) != FL_VALUE_TYPE_INT) {
+    return nullptr;
+  }
+  auto it = self->windows->find(fl_value_get_int(view_id));
+  return it == self->windows->end() ? nullptr : it->second.get();
+}
+
+static const gchar *lookup_string(FlValue *args, const char *key) {
+  auto *value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return nullptr;
+  }
+  return fl_value_get_string(value);
+}
+
+static int64_t lookup_int(FlValue *args, const char *key,
+                          int64_t default_value) {
+  auto *value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_INT) {
+    return default_value;
+  }
+  return fl_value_get_int(value);
+}
+
+static bool lookup_bool(FlValue *args, const char *key, bool default_value) {
+  auto *value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_BOOL) {
+    return default_value;
+  }
+  return fl_value_get_bool(value);
+}
+
+static double lookup_double(FlValue *args, const char *key,
+                            double default_value) {
+  auto *value = fl_value_lookup_string(args, key);
+  if (value == nullptr) {
+    return default_value;
+  }
+  switch (fl_value_get_type(value)) {
+    case FL_VALUE_TYPE_FLOAT:
+      return fl_value_get_float(value);
+    case FL_VALUE_TYPE_INT:
+      return static_cast<double>(fl_value_get_int(value));
+    default:
+      return default_value;
+  }
+}
+
+// Decodes a MessageBatchingConfiguration map. A missing or null map turns
+// batching off.
+static MessageBatchingConfig parse_message_batching(FlValue *value) {
+  MessageBatchingConfig config;
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_MAP) {
+    return config;
+  }
+  config.enabled = true;
+  config.flush_interval_ms = static_cast<int>(
+      lookup_int(value, "flushIntervalMs", config.flush_interval_ms));
+  config.max_batch_size = static_cast<size_t>(
+      lookup_int(value, "maxBatchSize", config.max_batch_size));
+  config.max_queue_size = static_cast<size_t>(
+      lookup_int(value, "maxQueueSize", config.max_queue_size));
+  auto policy = lookup_int(value, "overflowPolicy", 0);
+  if (policy >= 0 &&
+      policy <= static_cast<int64_t>(MessageOverflowPolicy::kBlock)) {
+    config.overflow_policy = static_cast<MessageOverflowPolicy>(policy);
+  }
+  return config;
+}
+
+static void attach_content_filters(WebviewWindowPlugin *self,
+                                   WebviewWindow *window) {
+  self->content_filters->ForEachFilter(
+      [window](WebKitUserContentFilter *filter) {
+        window->AddContentFilter(filter);
+      });
+}
+
+// Runs |callback| on every open and pooled window.
+static void for_each_window(
+    WebviewWindowPlugin *self,
+    const std::function<void(WebviewWindow *)> &callback) {
+  for (const auto &item : *self->windows) {
+    callback(item.second.get());
+  }
+  for (const auto &window : self->pool->windows) {
+    callback(window.get());
+  }
+}
+
+static void schedule_pool_refill(WebviewWindowPlugin *self);
 
-    auto window_id = next_window_id_;
-    g_object_ref(self);
-
-    auto user_scripts_value = fl_value_lookup_string(args, "userScripts");
-    std::vector<UserScript> user_scripts;
-    // g_print("userScripts list length: %zu\n", fl_value_get_length(user_scripts_value));
-    if (user_scripts_value != nullptr &&
-        fl_value_get_type(user_scripts_value) == FL_VALUE_TYPE_LIST) {
-      for (int i = 0; i < fl_value_get_length(user_scripts_value); ++i) {
-        auto script_map = fl_value_get_list_value(user_scripts_value, i);
-        if (fl_value_get_type(script_map) == FL_VALUE_TYPE_MAP) {
-          auto source = fl_value_get_string(
-              fl_value_lookup_string(script_map, "source"));
-          // g_print("script: %s\n", source);
-          auto injection_time = fl_value_get_int(
-              fl_value_lookup_string(script_map, "injectionTime"));
-          auto for_all_frames = fl_value_get_bool(
-              fl_value_lookup_string(script_map, "forAllFrames"));
-          user_scripts.push_back(
-              {source, static_cast<int>(injection_time), for_all_frames});
+// Adds one pre-warmed window to the pool. Runs at low priority so refilling
+// never delays frames or method calls.
+static gboolean refill_pool(gpointer user_data) {
+  auto *self = WEBVIEW_WINDOW_PLUGIN(user_data);
+  auto *pool = self->pool;
+  if (pool->windows.size() >= pool->size) {
+    pool->refill_source = 0;
+    return G_SOURCE_REMOVE;
+  }
+  // The close callback needs the window, which only exists once the
+  // callback has been passed to its constructor.
+  auto window = std::make_shared<WebviewWindow *>(nullptr);
+  auto pooled = std::make_unique<WebviewWindow>(
+      self->method_channel,
+      // Only runs while the window is pooled, Claim() replaces it.
+      [pool, window]() {
+        for (auto it = pool->windows.begin(); it != pool->windows.end(); ++it) {
+          if (it->get() == *window) {
+            pool->windows.erase(it);
+            return;
+          }
         }
-      }
-    }
+      },
+      nullptr, self->user_scripts);
+  *window = pooled.get();
+  attach_content_filters(self, pooled.get());
+  pooled->Prewarm();
+  pool->windows.push_back(std::move(pooled));
+  return G_SOURCE_CONTINUE;
+}
 
-    // Extract proxy configuration
-    auto proxy_args = fl_value_lookup_string(args, "proxy");
-    char *proxy_url = nullptr;
-    if (proxy_args != nullptr && fl_value_get_type(proxy_args) == FL_VALUE_TYPE_MAP) {
-      auto host = fl_value_get_string(fl_value_lookup_string(proxy_args, "host"));
-      auto port = fl_value_get_int(fl_value_lookup_string(proxy_args, "port"));
-      proxy_url = g_strdup_printf("http://%s:%ld", host, port);
-    }
+static void schedule_pool_refill(WebviewWindowPlugin *self) {
+  auto *pool = self->pool;
+  if (pool->refill_source || pool->windows.size() >= pool->size) {
+    return;
+  }
+  pool->refill_source = g_idle_add_full(G_PRIORITY_LOW, refill_pool,
+                                        g_object_ref(self), g_object_unref);
+}
 
-    auto webview = std::make_unique<WebviewWindow>(
-        self->method_channel, window_id,
-        [self, window_id]() {
-          self->windows->erase(window_id);
-          g_object_unref(self);
-        },
-        title, width, height, headless, user_scripts, proxy_url);
-    if (proxy_url) {
-      g_free(proxy_url);
-    }
-    self->windows->insert({window_id, std::move(webview)});
-    next_window_id_++;
-    fl_method_call_respond_success(method_call, fl_value_new_int(window_id),
-                                   nullptr);
-  } else if (strcmp(method, "launch") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "create args is not map",
-                                   nullptr, nullptr);
-      return;
-    }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    auto url = fl_value_get_string(fl_value_lookup_string(args, "url"));
+static bool has_map(FlValue *args, const char *key) {
+  auto *value = fl_value_lookup_string(args, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_MAP;
+}
 
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
-    }
+static MemoryProfile parse_memory_profile(FlValue *args) {
+  auto profile = lookup_int(args, "memoryProfile", 0);
+  if (profile < 0 || profile > static_cast<int>(MemoryProfile::kBrowser)) {
+    return MemoryProfile::kDefault;
+  }
+  return static_cast<MemoryProfile>(profile);
+}
 
-    self->windows->at(window_id)->Navigate(url);
-    fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "addScriptToExecuteOnDocumentCreated") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "args is not map", nullptr,
-                                   nullptr);
-      return;
-    }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    auto java_script =
-        fl_value_get_string(fl_value_lookup_string(args, "javaScript"));
+static bool has_memory_settings(FlValue *args) {
+  return parse_memory_profile(args) != MemoryProfile::kDefault ||
+         lookup_int(args, "memoryLimitMB", 0) > 0;
+}
 
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
-    }
-    self->windows->at(window_id)->RunJavaScriptWhenContentReady(java_script);
-    fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "clearAll") == 0) {
-    for (const auto &item : *self->windows) {
-      item.second->Close();
-    }
-    // If application didn't create a webview, but we called
-    // webkit_website_data_manager_clear, there will be a segment fault. To
-    // avoid crash, we create a fake webview first and then clear all data.
-    auto *web_view = webkit_web_view_new();
-    auto *context = webkit_web_view_get_context(WEBKIT_WEB_VIEW(web_view));
-    auto *website_data_manager =
-        webkit_web_context_get_website_data_manager(context);
-    webkit_website_data_manager_clear(website_data_manager,
-                                      WEBKIT_WEBSITE_DATA_ALL, 0, nullptr,
-                                      nullptr, nullptr);
-    fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "setApplicationNameForUserAgent") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(
-          method_call, "0", "setApplicationNameForUserAgent args is not map",
-          nullptr, nullptr);
-      return;
+// Whether a window for these create args can be taken from the pool. Pooled
+// windows use the default context without a proxy.
+static bool can_use_pool(FlValue *args) {
+  return !has_map(args, "proxy") && !has_map(args, "session") &&
+         !has_memory_settings(args);
+}
+
+// Returns a new reference to the context requested by the create args, or
+// null for the default context.
+static WebKitWebContext *acquire_session_context(WebviewWindowPlugin *self,
+                                                 FlValue *args) {
+  SessionConfig config;
+  config.memory_profile = parse_memory_profile(args);
+  config.memory_limit_mb =
+      static_cast<int>(lookup_int(args, "memoryLimitMB", 0));
+  if (!has_map(args, "session")) {
+    if (!has_memory_settings(args)) {
+      return nullptr;
     }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    auto application_name =
-        fl_value_get_string(fl_value_lookup_string(args, "applicationName"));
+    // Memory settings belong to the context, so share one context per
+    // setting among windows that otherwise use the default session.
+    config.use_default_data = true;
+    config.name = "\x01memory:" +
+                  std::to_string(static_cast<int>(config.memory_profile)) +
+                  ":" + std::to_string(config.memory_limit_mb);
+    return self->sessions->Acquire(config);
+  }
+  auto *session = fl_value_lookup_string(args, "session");
+  if (auto *name = lookup_string(session, "name")) {
+    config.name = name;
+  }
+  config.ephemeral = lookup_bool(session, "ephemeral", false);
+  if (auto *data_directory = lookup_string(session, "dataDirectory")) {
+    config.data_directory = data_directory;
+  }
+  if (auto *cache_directory = lookup_string(session, "cacheDirectory")) {
+    config.cache_directory = cache_directory;
+  }
+  config.disk_cache_limit_mb =
+      static_cast<int>(lookup_int(session, "diskCacheLimitMB", 0));
+  if (auto *cookie_storage_path = lookup_string(session, "cookieStoragePath")) {
+    config.cookie_storage_path = cookie_storage_path;
+  }
+  config.web_process_count_limit =
+      static_cast<int>(lookup_int(session, "webProcessCountLimit", 0));
+  return self->sessions->Acquire(config);
+}
 
-    if (!self->windows->count(window_id)) {
+// Parses a map of the Dart UserScript.toMap().
+static bool parse_user_script(FlValue *value, UserScript *script) {
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_MAP) {
+    return false;
+  }
+  auto *source = lookup_string(value, "source");
+  if (source == nullptr) {
+    return false;
+  }
+  script->source = source;
+  script->injection_time =
+      static_cast<int>(lookup_int(value, "injectionTime", 0));
+  script->for_all_frames = lookup_bool(value, "forAllFrames", false);
+  return true;
+}
+
+static WebKitSnapshotRegion parse_snapshot_region(FlValue *args) {
+  return lookup_int(args, "region", 0) == 1
+             ? WEBKIT_SNAPSHOT_REGION_FULL_DOCUMENT
+             : WEBKIT_SNAPSHOT_REGION_VISIBLE;
+}
+
+static SnapshotFormat parse_snapshot_format(FlValue *args) {
+  return lookup_int(args, "format", 0) == 1 ? SnapshotFormat::kPng
+                                            : SnapshotFormat::kBgra;
+}
+
+// Decodes a TextureConfiguration map.
+static TextureConfig parse_texture_config(FlValue *value) {
+  TextureConfig config;
+  config.max_frame_rate = static_cast<int>(
+      lookup_int(value, "maxFrameRate", config.max_frame_rate));
+  config.software_rendering =
+      lookup_bool(value, "softwareRendering", config.software_rendering);
+  return config;
+}
+
+static TexturePointerEvent parse_texture_pointer_event(FlValue *args) {
+  TexturePointerEvent event;
+  auto type = lookup_int(args, "type", 0);
+  if (type >= 0 && type <= static_cast<int>(TexturePointerEventType::kLeave)) {
+    event.type = static_cast<TexturePointerEventType>(type);
+  }
+  event.x = lookup_double(args, "x", 0);
+  event.y = lookup_double(args, "y", 0);
+  event.button = static_cast<guint>(lookup_int(args, "button", 0));
+  event.scroll_dx = lookup_double(args, "scrollDeltaX", 0);
+  event.scroll_dy = lookup_double(args, "scrollDeltaY", 0);
+  event.modifiers = static_cast<guint>(lookup_int(args, "modifiers", 0));
+  return event;
+}
+
+static TextureKeyEvent parse_texture_key_event(FlValue *args) {
+  TextureKeyEvent event;
+  event.down = lookup_bool(args, "down", true);
+  event.keyval = static_cast<guint>(lookup_int(args, "keyval", 0));
+  event.keycode = static_cast<guint16>(lookup_int(args, "keycode", 0));
+  event.modifiers = static_cast<guint>(lookup_int(args, "modifiers", 0));
+  return event;
+}
+
+static void handle_create(WebviewWindowPlugin *self, FlMethodCall *method_call,
+                          FlValue *args) {
+  auto width = fl_value_get_int(fl_value_lookup_string(args, "windowWidth"));
+  auto height = fl_value_get_int(fl_value_lookup_string(args, "windowHeight"));
+  auto title = fl_value_get_string(fl_value_lookup_string(args, "title"));
+  auto headless = lookup_bool(args, "headless", false);
+  // Texture mode renders offscreen, like a headless window.
+  auto texture_mode = has_map(args, "texture");
+  if (texture_mode) {
+    if (self->texture_registrar == nullptr) {
       fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
+                                   "textures are not available", nullptr,
                                    nullptr);
       return;
     }
-    self->windows->at(window_id)->SetApplicationNameForUserAgent(
-        application_name);
-    fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "back") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "back args is not map",
+    headless = true;
+  }
+
+  // Parsed first, so an invalid state fails before a window exists.
+  WebKitWebViewSessionState *session_state = nullptr;
+  auto *session_state_value = fl_value_lookup_string(args, "sessionState");
+  if (session_state_value != nullptr &&
+      fl_value_get_type(session_state_value) == FL_VALUE_TYPE_UINT8_LIST) {
+    g_autoptr(GBytes) bytes =
+        g_bytes_new(fl_value_get_uint8_list(session_state_value),
+                    fl_value_get_length(session_state_value));
+    session_state = webkit_web_view_session_state_new(bytes);
+    if (session_state == nullptr) {
+      fl_method_call_respond_error(method_call, "0", "invalid session state",
                                    nullptr, nullptr);
       return;
     }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
-    }
-    self->windows->at(window_id)->GoBack();
-    fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "forward") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "forward args is not map",
-                                   nullptr, nullptr);
-      return;
+  }
+
+  auto window_id = next_window_id_;
+  g_object_ref(self);
+
+  auto user_scripts_value = fl_value_lookup_string(args, "userScripts");
+  std::vector<UserScript> user_scripts;
+  if (user_scripts_value != nullptr &&
+      fl_value_get_type(user_scripts_value) == FL_VALUE_TYPE_LIST) {
+    for (size_t i = 0; i < fl_value_get_length(user_scripts_value); ++i) {
+      UserScript script;
+      if (parse_user_script(fl_value_get_list_value(user_scripts_value, i),
+                            &script)) {
+        user_scripts.push_back(std::move(script));
+      }
     }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
+  }
+
+  // Extract proxy configuration
+  auto proxy_args = fl_value_lookup_string(args, "proxy");
+  char *proxy_url = nullptr;
+  if (proxy_args != nullptr &&
+      fl_value_get_type(proxy_args) == FL_VALUE_TYPE_MAP) {
+    auto host = fl_value_get_string(fl_value_lookup_string(proxy_args, "host"));
+    auto port = fl_value_get_int(fl_value_lookup_string(proxy_args, "port"));
+    proxy_url = g_strdup_printf("http://%s:%ld", host, port);
+  }
+
+  auto on_close_callback = [self, window_id]() {
+    // Erasing the window destroys this lambda, so copy the capture first.
+    auto *plugin = self;
+    plugin->windows->erase(window_id);
+    g_object_unref(plugin);
+  };
+  std::unique_ptr<WebviewWindow> webview;
+  if (can_use_pool(args) && !self->pool->windows.empty()) {
+    webview = std::move(self->pool->windows.front());
+    self->pool->windows.pop_front();
+    webview->Claim(window_id, on_close_callback, title, width, height,
+                   headless, user_scripts);
+    // Pooled windows are only claimed without a proxy, which resets the
+    // proxy of the default context like a new window does.
+    webview->ApplyProxy(nullptr);
+  } else {
+    auto *context = acquire_session_context(self, args);
+    webview = std::make_unique<WebviewWindow>(
+        self->method_channel, window_id, on_close_callback, title, width,
+        height, headless, user_scripts, context, proxy_url,
+        self->user_scripts);
+    attach_content_filters(self, webview.get());
+    g_clear_object(&context);
+  }
+  schedule_pool_refill(self);
+  if (proxy_url) {
+    g_free(proxy_url);
+  }
+  webview->SetMessageBatching(
+      parse_message_batching(fl_value_lookup_string(args, "messageBatching")));
+  webview->SetPageCacheEnabled(
+      memory_profile_uses_page_cache(parse_memory_profile(args)));
+  int64_t texture_id = -1;
+  if (texture_mode) {
+    texture_id = webview->AttachTexture(
+        self->texture_registrar,
+        parse_texture_config(fl_value_lookup_string(args, "texture")));
+  }
+  webview->SetDiscarder(self->discarder);
+  webview->MarkActive();
+  if (session_state) {
+    webview->RestoreSessionState(session_state);
+    webkit_web_view_session_state_unref(session_state);
+  }
+  self->windows->insert({window_id, std::move(webview)});
+  next_window_id_++;
+  if (texture_mode) {
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "viewId", fl_value_new_int(window_id));
+    fl_value_set_string_take(result, "textureId",
+                             fl_value_new_int(texture_id));
+    fl_method_call_respond_success(method_call, result, nullptr);
+    return;
+  }
+  fl_method_call_respond_success(method_call, fl_value_new_int(window_id),
+                                 nullptr);
+}
+
+static void handle_clear_all(WebviewWindowPlugin *self,
+                             FlMethodCall *method_call, FlValue *args) {
+  // Closing a window erases it from the registry, so close from a snapshot
+  // of the ids instead of iterating the registry itself.
+  std::vector<int64_t> window_ids;
+  window_ids.reserve(self->windows->size());
+  for (const auto &item : *self->windows) {
+    window_ids.push_back(item.first);
+  }
+  for (auto window_id : window_ids) {
+    auto it = self->windows->find(window_id);
+    if (it != self->windows->end()) {
+      it->second->Close();
     }
-    self->windows->at(window_id)->GoForward();
-    fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "reload") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "reload args is not map",
-                                   nullptr, nullptr);
-      return;
+  }
+  // If application didn't create a webview, but we called
+  // webkit_website_data_manager_clear, there will be a segment fault. To
+  // avoid crash, we create a fake webview first and then clear all data.
+  webkit_web_view_new();
+  self->sessions->ForEachContext([](WebKitWebContext *context) {
+    webkit_website_data_manager_clear(
+        webkit_web_context_get_website_data_manager(context),
+        WEBKIT_WEBSITE_DATA_ALL, 0, nullptr, nullptr, nullptr);
+  });
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_configure_pool(WebviewWindowPlugin *self,
+                                  FlMethodCall *method_call, FlValue *args) {
+  auto size = lookup_int(args, "size", 0);
+  if (size < 0) {
+    fl_method_call_respond_error(method_call, "0", "pool size is negative",
+                                 nullptr, nullptr);
+    return;
+  }
+  auto *pool = self->pool;
+  pool->size = static_cast<size_t>(size);
+  // Closing a pooled window removes it from the pool.
+  while (pool->windows.size() > pool->size) {
+    pool->windows.back()->Close();
+  }
+  schedule_pool_refill(self);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_register_asset_scheme(WebviewWindowPlugin *self,
+                                         FlMethodCall *method_call,
+                                         FlValue *args) {
+  auto *scheme = lookup_string(args, "scheme");
+  if (!AssetSchemeHandler::IsValidScheme(scheme)) {
+    fl_method_call_respond_error(method_call, "0", "invalid scheme", nullptr,
+                                 nullptr);
+    return;
+  }
+  auto *directory = lookup_string(args, "directory");
+  std::string root = directory ? directory
+                               : AssetSchemeHandler::FlutterAssetsDirectory();
+  auto cache_size = lookup_int(args, "cacheSize", kDefaultAssetCacheSize);
+  if (cache_size < 0) {
+    cache_size = 0;
+  }
+
+  // Scheme names are case-insensitive.
+  g_autofree gchar *key = g_ascii_strdown(scheme, -1);
+  auto it = self->asset_schemes->find(key);
+  if (it != self->asset_schemes->end()) {
+    // WebKit does not allow registering a scheme twice on a context, so
+    // point the existing handler to the new root instead.
+    it->second->Reset(root, static_cast<size_t>(cache_size));
+  } else {
+    auto handler = std::make_shared<AssetSchemeHandler>(
+        key, root, static_cast<size_t>(cache_size));
+    self->asset_schemes->insert({key, handler});
+    self->sessions->AddContextInitializer(
+        [handler](WebKitWebContext *context) {
+          AssetSchemeHandler::Register(handler, context);
+        });
+  }
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_add_content_filter(WebviewWindowPlugin *self,
+                                      FlMethodCall *method_call,
+                                      FlValue *args) {
+  auto *identifier = lookup_string(args, "identifier");
+  auto *source = lookup_string(args, "source");
+  if (!ContentFilterRegistry::IsValidIdentifier(identifier) || !source) {
+    fl_method_call_respond_error(method_call, "0",
+                                 "invalid content filter identifier or source",
+                                 nullptr, nullptr);
+    return;
+  }
+  g_autoptr(GBytes) bytes = g_bytes_new(source, strlen(source));
+  // Keeps the call alive until the filter is compiled, also when the
+  // registry drops the callback without running it.
+  std::shared_ptr<FlMethodCall> call(
+      FL_METHOD_CALL(g_object_ref(method_call)), g_object_unref);
+  self->content_filters->Add(
+      identifier, bytes,
+      [self, call](WebKitUserContentFilter *filter, bool compiled,
+                   double elapsed_ms, const GError *error) {
+        if (!filter) {
+          fl_method_call_respond_error(
+              call.get(), "0", error ? error->message : "compile failed",
+              nullptr, nullptr);
+          return;
+        }
+        for_each_window(self, [filter](WebviewWindow *window) {
+          window->AddContentFilter(filter);
+        });
+        g_autoptr(FlValue) result = fl_value_new_map();
+        fl_value_set_string_take(result, "identifier",
+                                 fl_value_new_string(
+                                     webkit_user_content_filter_get_identifier(
+                                         filter)));
+        fl_value_set_string_take(result, "compiled",
+                                 fl_value_new_bool(compiled));
+        fl_value_set_string_take(result, "compileTimeMs",
+                                 fl_value_new_float(elapsed_ms));
+        fl_method_call_respond_success(call.get(), result, nullptr);
+      });
+}
+
+static void handle_remove_content_filter(WebviewWindowPlugin *self,
+                                         FlMethodCall *method_call,
+                                         FlValue *args) {
+  auto *identifier = lookup_string(args, "identifier");
+  if (!ContentFilterRegistry::IsValidIdentifier(identifier)) {
+    fl_method_call_respond_error(method_call, "0",
+                                 "invalid content filter identifier", nullptr,
+                                 nullptr);
+    return;
+  }
+  for_each_window(self, [identifier](WebviewWindow *window) {
+    window->RemoveContentFilter(identifier);
+  });
+  self->content_filters->Remove(identifier);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+// Reads the string list "urls" of |args|, skipping other values.
+static bool parse_urls(FlValue *args, std::vector<std::string> *urls) {
+  auto *urls_value = fl_value_lookup_string(args, "urls");
+  if (urls_value == nullptr ||
+      fl_value_get_type(urls_value) != FL_VALUE_TYPE_LIST) {
+    return false;
+  }
+  for (size_t i = 0; i < fl_value_get_length(urls_value); ++i) {
+    auto *url = fl_value_get_list_value(urls_value, i);
+    if (fl_value_get_type(url) == FL_VALUE_TYPE_STRING) {
+      urls->push_back(fl_value_get_string(url));
     }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
+  }
+  return true;
+}
+
+static void handle_snapshot_urls(WebviewWindowPlugin *self,
+                                 FlMethodCall *method_call, FlValue *args) {
+  std::vector<std::string> urls;
+  if (!parse_urls(args, &urls)) {
+    fl_method_call_respond_error(method_call, "0", "urls is not list",
+                                 nullptr, nullptr);
+    return;
+  }
+  SnapshotJobOptions options;
+  options.width = static_cast<int>(lookup_int(args, "width", options.width));
+  options.height =
+      static_cast<int>(lookup_int(args, "height", options.height));
+  options.region = parse_snapshot_region(args);
+  options.format = parse_snapshot_format(args);
+  options.timeout_ms =
+      static_cast<int>(lookup_int(args, "timeoutMs", options.timeout_ms));
+  auto parallelism = static_cast<int>(lookup_int(args, "parallelism", 4));
+
+  if (urls.empty()) {
+    g_autoptr(FlValue) results = fl_value_new_list();
+    fl_method_call_respond_success(method_call, results, nullptr);
+    return;
+  }
+  g_object_ref(method_call);
+  SnapshotQueue::Run(nullptr, std::move(urls), parallelism, options,
+                     [method_call](FlValue *results) {
+                       fl_method_call_respond_success(method_call, results,
+                                                      nullptr);
+                       g_object_unref(method_call);
+                     });
+}
+
+static void handle_prefetch(WebviewWindowPlugin *self,
+                            FlMethodCall *method_call, FlValue *args) {
+  std::vector<std::string> urls;
+  if (!parse_urls(args, &urls)) {
+    fl_method_call_respond_error(method_call, "0", "urls is not list",
+                                 nullptr, nullptr);
+    return;
+  }
+  // An unnamed session would get a context of its own, dropped with the
+  // queue, so the cache it warms could never be used.
+  if (has_map(args, "session")) {
+    auto *name = lookup_string(fl_value_lookup_string(args, "session"), "name");
+    if (name == nullptr || *name == '\0') {
+      fl_method_call_respond_error(
+          method_call, "0", "prefetch needs a named session or none", nullptr,
+          nullptr);
       return;
     }
-    self->windows->at(window_id)->Reload();
-    fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "stop") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "stop args is not map",
-                                   nullptr, nullptr);
-      return;
+  }
+  auto *context = acquire_session_context(self, args);
+  // Resolve every host first, that is cheap and helps the pages that are
+  // not loaded below as well.
+  std::set<std::string> hosts;
+  for (const auto &url : urls) {
+    auto host = UrlRuleEngine::HostOf(url.c_str());
+    if (!host.empty() && hosts.insert(host).second) {
+      webkit_web_context_prefetch_dns(
+          context ? context : webkit_web_context_get_default(), host.c_str());
     }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
+  }
+  if (urls.empty() || !lookup_bool(args, "load", true)) {
+    g_clear_object(&context);
+    g_autoptr(FlValue) results = fl_value_new_list();
+    fl_method_call_respond_success(method_call, results, nullptr);
+    return;
+  }
+  SnapshotJobOptions options;
+  options.snapshot = false;
+  options.timeout_ms =
+      static_cast<int>(lookup_int(args, "timeoutMs", options.timeout_ms));
+  auto parallelism = static_cast<int>(lookup_int(args, "parallelism", 4));
+  g_object_ref(method_call);
+  // The web views of the queue hold the context while they load.
+  SnapshotQueue::Run(context, std::move(urls), parallelism, options,
+                     [method_call](FlValue *results) {
+                       fl_method_call_respond_success(method_call, results,
+                                                      nullptr);
+                       g_object_unref(method_call);
+                     });
+  g_clear_object(&context);
+}
+
+static void handle_set_default_disk_cache_limit(WebviewWindowPlugin *self,
+                                                FlMethodCall *method_call,
+                                                FlValue *args) {
+  auto limit_mb = lookup_int(args, "limitMB", 0);
+  DiskCacheLimiter::Attach(
+      webkit_web_context_get_website_data_manager(
+          webkit_web_context_get_default()),
+      limit_mb > 0 ? static_cast<guint64>(limit_mb) * 1024 * 1024 : 0);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_set_default_cookie_storage(WebviewWindowPlugin *self,
+                                              FlMethodCall *method_call,
+                                              FlValue *args) {
+  auto *path = lookup_string(args, "path");
+  if (path == nullptr || *path == '\0') {
+    fl_method_call_respond_error(method_call, "0", "path is required",
+                                 nullptr, nullptr);
+    return;
+  }
+  webkit_cookie_manager_set_persistent_storage(
+      webkit_web_context_get_cookie_manager(webkit_web_context_get_default()),
+      path, WEBKIT_COOKIE_PERSISTENT_STORAGE_SQLITE);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_set_discard_policy(WebviewWindowPlugin *self,
+                                      FlMethodCall *method_call,
+                                      FlValue *args) {
+  DiscardPolicy policy;
+  policy.enabled = lookup_bool(args, "enabled", false);
+  policy.idle_timeout_ms = static_cast<int>(std::max<int64_t>(
+      0, lookup_int(args, "idleTimeoutMs", policy.idle_timeout_ms)));
+  policy.on_memory_pressure =
+      lookup_bool(args, "onMemoryPressure", policy.on_memory_pressure);
+  policy.pressure_min_idle_ms = static_cast<int>(std::max<int64_t>(
+      0, lookup_int(args, "pressureMinIdleMs", policy.pressure_min_idle_ms)));
+  policy.discard_visible =
+      lookup_bool(args, "discardVisible", policy.discard_visible);
+  self->discarder->SetPolicy(policy);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_get_discard_stats(WebviewWindowPlugin *self,
+                                     FlMethodCall *method_call,
+                                     FlValue *args) {
+  g_autoptr(FlValue) stats = self->discarder->GetStats();
+  fl_method_call_respond_success(method_call, stats, nullptr);
+}
+
+static void handle_launch(WebviewWindowPlugin *self, WebviewWindow *window,
+                          FlMethodCall *method_call, FlValue *args) {
+  auto url = fl_value_get_string(fl_value_lookup_string(args, "url"));
+  window->Navigate(url);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_add_script_to_execute_on_document_created(
+    WebviewWindowPlugin *self, WebviewWindow *window,
+    FlMethodCall *method_call, FlValue *args) {
+  auto java_script =
+      fl_value_get_string(fl_value_lookup_string(args, "javaScript"));
+  window->RunJavaScriptWhenContentReady(java_script);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_add_user_script(WebviewWindowPlugin *self,
+                                   WebviewWindow *window,
+                                   FlMethodCall *method_call, FlValue *args) {
+  UserScript script;
+  if (!parse_user_script(fl_value_lookup_string(args, "script"), &script)) {
+    fl_method_call_respond_error(method_call, "0", "script is not map",
+                                 nullptr, nullptr);
+    return;
+  }
+  g_autoptr(FlValue) script_id =
+      fl_value_new_int(window->AddUserScript(script));
+  fl_method_call_respond_success(method_call, script_id, nullptr);
+}
+
+static void handle_remove_user_script(WebviewWindowPlugin *self,
+                                      WebviewWindow *window,
+                                      FlMethodCall *method_call,
+                                      FlValue *args) {
+  g_autoptr(FlValue) removed = fl_value_new_bool(
+      window->RemoveUserScript(lookup_int(args, "scriptId", 0)));
+  fl_method_call_respond_success(method_call, removed, nullptr);
+}
+
+static void handle_replace_user_script(WebviewWindowPlugin *self,
+                                       WebviewWindow *window,
+                                       FlMethodCall *method_call,
+                                       FlValue *args) {
+  UserScript script;
+  if (!parse_user_script(fl_value_lookup_string(args, "script"), &script)) {
+    fl_method_call_respond_error(method_call, "0", "script is not map",
+                                 nullptr, nullptr);
+    return;
+  }
+  g_autoptr(FlValue) replaced = fl_value_new_bool(
+      window->ReplaceUserScript(lookup_int(args, "scriptId", 0), script));
+  fl_method_call_respond_success(method_call, replaced, nullptr);
+}
+
+static void handle_get_user_script_stats(WebviewWindowPlugin *self,
+                                         FlMethodCall *method_call,
+                                         FlValue *args) {
+  g_autoptr(FlValue) stats = self->user_scripts->GetStats();
+  fl_method_call_respond_success(method_call, stats, nullptr);
+}
+
+static void handle_set_application_name_for_user_agent(
+    WebviewWindowPlugin *self, WebviewWindow *window,
+    FlMethodCall *method_call, FlValue *args) {
+  auto application_name =
+      fl_value_get_string(fl_value_lookup_string(args, "applicationName"));
+  window->SetApplicationNameForUserAgent(application_name);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_back(WebviewWindowPlugin *self, WebviewWindow *window,
+                        FlMethodCall *method_call, FlValue *args) {
+  window->GoBack();
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_forward(WebviewWindowPlugin *self, WebviewWindow *window,
+                           FlMethodCall *method_call, FlValue *args) {
+  window->GoForward();
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_reload(WebviewWindowPlugin *self, WebviewWindow *window,
+                          FlMethodCall *method_call, FlValue *args) {
+  window->Reload();
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_stop(WebviewWindowPlugin *self, WebviewWindow *window,
+                        FlMethodCall *method_call, FlValue *args) {
+  window->StopLoading();
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_get_all_cookies(WebviewWindowPlugin *self,
+                                   WebviewWindow *window,
+                                   FlMethodCall *method_call, FlValue *args) {
+  CookieFilter filter;
+  if (auto *domain = lookup_string(args, "domain")) {
+    filter.domain = domain;
+  }
+  if (auto *name_prefix = lookup_string(args, "namePrefix")) {
+    filter.name_prefix = name_prefix;
+  }
+  auto *fields = fl_value_lookup_string(args, "fields");
+  if (fields != nullptr && fl_value_get_type(fields) == FL_VALUE_TYPE_LIST) {
+    filter.fields = 0;
+    for (size_t i = 0; i < fl_value_get_length(fields); ++i) {
+      auto *field = fl_value_get_list_value(fields, i);
+      if (fl_value_get_type(field) == FL_VALUE_TYPE_STRING) {
+        filter.fields |= cookie_field_from_name(fl_value_get_string(field));
+      }
     }
-    self->windows->at(window_id)->StopLoading();
+  }
+  window->GetAllCookies(filter, method_call);
+}
+
+static void handle_set_cookie_watch(WebviewWindowPlugin *self,
+                                    WebviewWindow *window,
+                                    FlMethodCall *method_call, FlValue *args) {
+  if (!lookup_bool(args, "enabled", false)) {
+    window->SetCookieWatch(nullptr);
     fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "getAllCookies") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(
-          method_call, "0", "getAllCookies args is not map", nullptr, nullptr);
-      return;
-    }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
+    return;
+  }
+  CookieWatchConfig config;
+  if (auto *domain = lookup_string(args, "domain")) {
+    config.domain = domain;
+  }
+#if !WEBKIT_CHECK_VERSION(2, 42, 0)
+  if (config.domain.find_first_not_of('.') == std::string::npos) {
+    fl_method_call_respond_error(
+        method_call, "0",
+        "watching cookies needs a domain before WebKitGTK 2.42", nullptr,
+        nullptr);
+    return;
+  }
+#endif
+  config.interval_ms = std::max(
+      1, static_cast<int>(lookup_int(args, "intervalMs", config.interval_ms)));
+  window->SetCookieWatch(&config);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+// Parses the "cookies" list of |args|, skipping invalid entries.
+static GList *parse_cookies(FlValue *args) {
+  GList *cookies = nullptr;
+  auto *list = fl_value_lookup_string(args, "cookies");
+  if (list == nullptr || fl_value_get_type(list) != FL_VALUE_TYPE_LIST) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < fl_value_get_length(list); ++i) {
+    if (auto *cookie = cookie_from_fl_value(fl_value_get_list_value(list, i))) {
+      cookies = g_list_prepend(cookies, cookie);
     }
+  }
+  return g_list_reverse(cookies);
+}
 
-    FlValue *data = nullptr;
+static void handle_set_cookies(WebviewWindowPlugin *self,
+                               WebviewWindow *window,
+                               FlMethodCall *method_call, FlValue *args) {
+  apply_cookies(window->cookie_manager(), parse_cookies(args), false,
+                method_call);
+}
 
-    data = self->windows->at(window_id)->GetAllCookies();
+static void handle_delete_cookies(WebviewWindowPlugin *self,
+                                  WebviewWindow *window,
+                                  FlMethodCall *method_call, FlValue *args) {
+  apply_cookies(window->cookie_manager(), parse_cookies(args), true,
+                method_call);
+}
 
-    if (data == nullptr) {
-      fl_method_call_respond_error(method_call, "0", "get all cookies failed",
-                                   nullptr, nullptr);
-      return;
-    }
+static void handle_export_cookies(WebviewWindowPlugin *self,
+                                  WebviewWindow *window,
+                                  FlMethodCall *method_call, FlValue *args) {
+  auto *path = lookup_string(args, "path");
+  if (path == nullptr) {
+    fl_method_call_respond_error(method_call, "0", "path is required",
+                                 nullptr, nullptr);
+    return;
+  }
+  export_cookies(window->cookie_manager(), path, method_call);
+}
+
+static void handle_import_cookies(WebviewWindowPlugin *self,
+                                  WebviewWindow *window,
+                                  FlMethodCall *method_call, FlValue *args) {
+  auto *path = lookup_string(args, "path");
+  if (path == nullptr) {
+    fl_method_call_respond_error(method_call, "0", "path is required",
+                                 nullptr, nullptr);
+    return;
+  }
+  import_cookies(window->cookie_manager(), path,
+                 lookup_bool(args, "replace", false), method_call);
+}
+
+static void handle_save_session_state(WebviewWindowPlugin *self,
+                                      WebviewWindow *window,
+                                      FlMethodCall *method_call,
+                                      FlValue *args) {
+  g_autoptr(FlValue) state = window->SaveSessionState();
+  fl_method_call_respond_success(method_call, state, nullptr);
+}
 
+static void handle_discard(WebviewWindowPlugin *self, WebviewWindow *window,
+                           FlMethodCall *method_call, FlValue *args) {
+  g_autoptr(FlValue) result =
+      fl_value_new_bool(self->discarder->Discard(window));
+  fl_method_call_respond_success(method_call, result, nullptr);
+}
+
+static void handle_is_discarded(WebviewWindowPlugin *self,
+                                WebviewWindow *window,
+                                FlMethodCall *method_call, FlValue *args) {
+  g_autoptr(FlValue) result = fl_value_new_bool(window->IsDiscarded());
+  fl_method_call_respond_success(method_call, result, nullptr);
+}
+
+static void handle_restore(WebviewWindowPlugin *self, WebviewWindow *window,
+                           FlMethodCall *method_call, FlValue *args) {
+  // Restored by the dispatch, like every other call.
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_close(WebviewWindowPlugin *self, WebviewWindow *window,
+                         FlMethodCall *method_call, FlValue *args) {
+  window->Close();
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_evaluate_java_script(WebviewWindowPlugin *self,
+                                        WebviewWindow *window,
+                                        FlMethodCall *method_call,
+                                        FlValue *args) {
+  auto *js = lookup_string(args, "javaScriptString");
+  if (js == nullptr) {
+    fl_method_call_respond_error(method_call, "0",
+                                 "javaScriptString is not string", nullptr,
+                                 nullptr);
+    return;
+  }
+  window->EvaluateJavaScript(js, lookup_bool(args, "nativeResult", false),
+                             method_call);
+}
 
-    fl_method_call_respond_success(method_call, data, nullptr);
-    fl_value_unref(data);
-  } else if (strcmp(method, "close") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0", "close args is not map",
+static void handle_evaluate_java_script_batch(WebviewWindowPlugin *self,
+                                              WebviewWindow *window,
+                                              FlMethodCall *method_call,
+                                              FlValue *args) {
+  auto *scripts_value = fl_value_lookup_string(args, "scripts");
+  if (scripts_value == nullptr ||
+      fl_value_get_type(scripts_value) != FL_VALUE_TYPE_LIST) {
+    fl_method_call_respond_error(method_call, "0", "scripts is not list",
+                                 nullptr, nullptr);
+    return;
+  }
+  std::vector<std::string> scripts;
+  scripts.reserve(fl_value_get_length(scripts_value));
+  for (size_t i = 0; i < fl_value_get_length(scripts_value); ++i) {
+    auto *script = fl_value_get_list_value(scripts_value, i);
+    if (fl_value_get_type(script) != FL_VALUE_TYPE_STRING) {
+      fl_method_call_respond_error(method_call, "0", "script is not string",
                                    nullptr, nullptr);
       return;
     }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
-    }
-    self->windows->at(window_id)->Close();
+    scripts.push_back(fl_value_get_string(script));
+  }
+  window->EvaluateJavaScriptBatch(std::move(scripts),
+                                  lookup_bool(args, "nativeResult", true),
+                                  method_call);
+}
+
+static void handle_set_message_batching(WebviewWindowPlugin *self,
+                                        WebviewWindow *window,
+                                        FlMethodCall *method_call,
+                                        FlValue *args) {
+  window->SetMessageBatching(
+      parse_message_batching(fl_value_lookup_string(args, "configuration")));
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_get_message_stats(WebviewWindowPlugin *self,
+                                     WebviewWindow *window,
+                                     FlMethodCall *method_call, FlValue *args) {
+  g_autoptr(FlValue) stats = window->GetMessageStats();
+  fl_method_call_respond_success(method_call, stats, nullptr);
+}
+
+static void post_web_message(WebviewWindow *window, FlMethodCall *method_call,
+                             FlValue *args, bool is_json) {
+  auto *message = lookup_string(args, "webMessage");
+  if (message == nullptr) {
+    fl_method_call_respond_error(method_call, "0", "webMessage is required",
+                                 nullptr, nullptr);
+    return;
+  }
+  window->PostWebMessage(message, is_json);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_post_web_message_as_string(WebviewWindowPlugin *self,
+                                              WebviewWindow *window,
+                                              FlMethodCall *method_call,
+                                              FlValue *args) {
+  post_web_message(window, method_call, args, false);
+}
+
+static void handle_post_web_message_as_json(WebviewWindowPlugin *self,
+                                            WebviewWindow *window,
+                                            FlMethodCall *method_call,
+                                            FlValue *args) {
+  post_web_message(window, method_call, args, true);
+}
+
+static void handle_set_url_rules(WebviewWindowPlugin *self,
+                                 WebviewWindow *window,
+                                 FlMethodCall *method_call, FlValue *args) {
+  auto *rules_value = fl_value_lookup_string(args, "rules");
+  if (rules_value == nullptr ||
+      fl_value_get_type(rules_value) != FL_VALUE_TYPE_LIST) {
+    window->SetUrlRules(nullptr);
     fl_method_call_respond_success(method_call, nullptr, nullptr);
-  } else if (strcmp(method, "evaluateJavaScript") == 0) {
-    auto *args = fl_method_call_get_args(method_call);
-    if (fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "evaluateJavaScript args is not map",
+    return;
+  }
+  std::vector<UrlRule> rules;
+  rules.reserve(fl_value_get_length(rules_value));
+  for (size_t i = 0; i < fl_value_get_length(rules_value); ++i) {
+    auto *rule = fl_value_get_list_value(rules_value, i);
+    auto *pattern = fl_value_get_type(rule) == FL_VALUE_TYPE_MAP
+                        ? lookup_string(rule, "pattern")
+                        : nullptr;
+    auto type = pattern ? lookup_int(rule, "type", -1) : -1;
+    auto action = pattern ? lookup_int(rule, "action", -1) : -1;
+    if (type < 0 || type > static_cast<int>(UrlRuleType::kGlob) ||
+        action < 0 || action > static_cast<int>(UrlRuleAction::kAsk)) {
+      fl_method_call_respond_error(method_call, "0", "invalid url rule",
                                    nullptr, nullptr);
       return;
     }
-    auto window_id = fl_value_get_int(fl_value_lookup_string(args, "viewId"));
-    if (!self->windows->count(window_id)) {
-      fl_method_call_respond_error(method_call, "0",
-                                   "can not found webview for viewId", nullptr,
-                                   nullptr);
-      return;
+    rules.push_back({static_cast<UrlRuleType>(type), pattern,
+                     static_cast<UrlRuleAction>(action)});
+  }
+  auto default_action = lookup_int(args, "defaultAction", 0);
+  if (default_action < 0 ||
+      default_action > static_cast<int>(UrlRuleAction::kAsk)) {
+    default_action = 0;
+  }
+  window->SetUrlRules(std::make_unique<UrlRuleEngine>(
+      rules, static_cast<UrlRuleAction>(default_action)));
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_get_content_filter_stats(WebviewWindowPlugin *self,
+                                           WebviewWindow *window,
+                                           FlMethodCall *method_call,
+                                           FlValue *args) {
+  g_autoptr(FlValue) stats = window->GetContentFilterStats();
+  fl_method_call_respond_success(method_call, stats, nullptr);
+}
+
+static void handle_set_navigation_metrics(WebviewWindowPlugin *self,
+                                          WebviewWindow *window,
+                                          FlMethodCall *method_call,
+                                          FlValue *args) {
+  NavigationMetricsConfig config;
+  config.metrics = lookup_bool(args, "metrics", false);
+  config.progress_interval_ms =
+      static_cast<int>(lookup_int(args, "progressIntervalMs", 0));
+  window->SetNavigationMetrics(config);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_take_snapshot(WebviewWindowPlugin *self,
+                                 WebviewWindow *window,
+                                 FlMethodCall *method_call, FlValue *args) {
+  window->TakeSnapshot(parse_snapshot_region(args),
+                       parse_snapshot_format(args), method_call);
+}
+
+static void handle_get_memory_usage(WebviewWindowPlugin *self,
+                                    WebviewWindow *window,
+                                    FlMethodCall *method_call, FlValue *args) {
+  g_autoptr(FlValue) usage = window->GetMemoryUsage();
+  fl_method_call_respond_success(method_call, usage, nullptr);
+}
+
+static void handle_query_dom(WebviewWindowPlugin *self, WebviewWindow *window,
+                             FlMethodCall *method_call, FlValue *args) {
+  auto *selector = lookup_string(args, "selector");
+  if (selector == nullptr) {
+    fl_method_call_respond_error(method_call, "0", "selector is required",
+                                 nullptr, nullptr);
+    return;
+  }
+  DomQuery query;
+  query.selector = selector;
+  // DomQueryField bits, the text by default.
+  query.fields =
+      static_cast<guint32>(lookup_int(args, "fields", kDomQueryText));
+  query.limit = static_cast<guint32>(std::max<int64_t>(
+      0, lookup_int(args, "limit", 0)));
+  auto *attributes = fl_value_lookup_string(args, "attributes");
+  if (attributes != nullptr &&
+      fl_value_get_type(attributes) == FL_VALUE_TYPE_LIST) {
+    for (size_t i = 0; i < fl_value_get_length(attributes); ++i) {
+      auto *attribute = fl_value_get_list_value(attributes, i);
+      if (fl_value_get_type(attribute) == FL_VALUE_TYPE_STRING) {
+        query.attributes.push_back(fl_value_get_string(attribute));
+      }
     }
-    auto *js =
-        fl_value_get_string(fl_value_lookup_string(args, "javaScriptString"));
-    self->windows->at(window_id)->EvaluateJavaScript(js, method_call);
-  } else {
+  }
+  window->QueryDom(query, method_call);
+}
+
+// Returns the texture of |window|, or responds with an error and returns
+// null if it has none.
+static WebviewTexture *lookup_texture(WebviewWindow *window,
+                                      FlMethodCall *method_call) {
+  auto *texture = window->texture();
+  if (texture == nullptr) {
+    fl_method_call_respond_error(method_call, "0", "webview has no texture",
+                                 nullptr, nullptr);
+  }
+  return texture;
+}
+
+static void handle_resize_texture(WebviewWindowPlugin *self,
+                                  WebviewWindow *window,
+                                  FlMethodCall *method_call, FlValue *args) {
+  auto *texture = lookup_texture(window, method_call);
+  if (texture == nullptr) {
+    return;
+  }
+  auto width = lookup_int(args, "width", 0);
+  auto height = lookup_int(args, "height", 0);
+  if (width <= 0 || height <= 0) {
+    fl_method_call_respond_error(method_call, "0", "invalid texture size",
+                                 nullptr, nullptr);
+    return;
+  }
+  texture->Resize(static_cast<int>(width), static_cast<int>(height));
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_send_texture_pointer_event(WebviewWindowPlugin *self,
+                                              WebviewWindow *window,
+                                              FlMethodCall *method_call,
+                                              FlValue *args) {
+  auto *texture = lookup_texture(window, method_call);
+  if (texture == nullptr) {
+    return;
+  }
+  texture->SendPointerEvent(parse_texture_pointer_event(args));
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_send_texture_key_event(WebviewWindowPlugin *self,
+                                          WebviewWindow *window,
+                                          FlMethodCall *method_call,
+                                          FlValue *args) {
+  auto *texture = lookup_texture(window, method_call);
+  if (texture == nullptr) {
+    return;
+  }
+  texture->SendKeyEvent(parse_texture_key_event(args));
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_set_texture_focus(WebviewWindowPlugin *self,
+                                     WebviewWindow *window,
+                                     FlMethodCall *method_call, FlValue *args) {
+  auto *texture = lookup_texture(window, method_call);
+  if (texture == nullptr) {
+    return;
+  }
+  texture->SetFocused(lookup_bool(args, "focused", false));
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_get_texture_stats(WebviewWindowPlugin *self,
+                                     WebviewWindow *window,
+                                     FlMethodCall *method_call, FlValue *args) {
+  auto *texture = lookup_texture(window, method_call);
+  if (texture == nullptr) {
+    return;
+  }
+  g_autoptr(FlValue) stats = texture->GetStats();
+  fl_method_call_respond_success(method_call, stats, nullptr);
+}
+
+static DownloadConfig parse_download_config(FlValue *args) {
+  DownloadConfig config;
+  if (auto *directory = lookup_string(args, "directory")) {
+    config.directory = directory;
+  }
+  config.overwrite = lookup_bool(args, "overwrite", config.overwrite);
+  config.ask_destination =
+      lookup_bool(args, "askDestination", config.ask_destination);
+  config.progress_interval_ms = static_cast<int>(
+      lookup_int(args, "progressIntervalMs", config.progress_interval_ms));
+  return config;
+}
+
+static DownloadController *lookup_downloads(WebviewWindow *window,
+                                            FlMethodCall *method_call) {
+  auto *downloads = window->downloads();
+  if (downloads == nullptr) {
+    fl_method_call_respond_error(method_call, "0",
+                                 "downloads are not configured", nullptr,
+                                 nullptr);
+  }
+  return downloads;
+}
+
+static void handle_set_download_config(WebviewWindowPlugin *self,
+                                       WebviewWindow *window,
+                                       FlMethodCall *method_call,
+                                       FlValue *args) {
+  window->SetDownloadConfig(parse_download_config(args));
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_start_download(WebviewWindowPlugin *self,
+                                  WebviewWindow *window,
+                                  FlMethodCall *method_call, FlValue *args) {
+  auto *url = lookup_string(args, "url");
+  if (url == nullptr) {
+    fl_method_call_respond_error(method_call, "0", "url is not string",
+                                 nullptr, nullptr);
+    return;
+  }
+  auto *downloads = lookup_downloads(window, method_call);
+  if (downloads == nullptr) {
+    return;
+  }
+  g_autoptr(FlValue) download_id = fl_value_new_int(downloads->Start(url));
+  fl_method_call_respond_success(method_call, download_id, nullptr);
+}
+
+static void handle_cancel_download(WebviewWindowPlugin *self,
+                                   WebviewWindow *window,
+                                   FlMethodCall *method_call, FlValue *args) {
+  auto *downloads = lookup_downloads(window, method_call);
+  if (downloads == nullptr) {
+    return;
+  }
+  g_autoptr(FlValue) cancelled = fl_value_new_bool(
+      downloads->Cancel(lookup_int(args, "downloadId", 0)));
+  fl_method_call_respond_success(method_call, cancelled, nullptr);
+}
+
+static void handle_resume_download(WebviewWindowPlugin *self,
+                                   WebviewWindow *window,
+                                   FlMethodCall *method_call, FlValue *args) {
+  auto *downloads = lookup_downloads(window, method_call);
+  if (downloads == nullptr) {
+    return;
+  }
+  g_autoptr(FlValue) resumed = fl_value_new_bool(
+      downloads->Resume(lookup_int(args, "downloadId", 0)));
+  fl_method_call_respond_success(method_call, resumed, nullptr);
+}
+
+static void handle_get_downloads(WebviewWindowPlugin *self,
+                                 WebviewWindow *window,
+                                 FlMethodCall *method_call, FlValue *args) {
+  auto *downloads = lookup_downloads(window, method_call);
+  if (downloads == nullptr) {
+    return;
+  }
+  g_autoptr(FlValue) result = downloads->GetDownloads();
+  fl_method_call_respond_success(method_call, result, nullptr);
+}
+
+static void handle_start_network_recording(WebviewWindowPlugin *self,
+                                           WebviewWindow *window,
+                                           FlMethodCall *method_call,
+                                           FlValue *args) {
+  NetworkRecorderConfig config;
+  auto max_entries = lookup_int(args, "maxEntries",
+                                static_cast<int64_t>(config.max_entries));
+  auto max_body_bytes = lookup_int(
+      args, "maxBodyBytes", static_cast<int64_t>(config.max_body_bytes));
+  auto max_total_body_bytes =
+      lookup_int(args, "maxTotalBodyBytes",
+                 static_cast<int64_t>(config.max_total_body_bytes));
+  if (max_entries <= 0 || max_body_bytes < 0 || max_total_body_bytes < 0) {
+    fl_method_call_respond_error(method_call, "0",
+                                 "invalid network recording limits", nullptr,
+                                 nullptr);
+    return;
+  }
+  config.max_entries = static_cast<size_t>(max_entries);
+  config.max_body_bytes = static_cast<size_t>(max_body_bytes);
+  config.max_total_body_bytes = static_cast<size_t>(max_total_body_bytes);
+  config.fetch_bodies = lookup_bool(args, "fetchBodies", config.fetch_bodies);
+  window->StartNetworkRecording(config);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static NetworkRecorder *lookup_network_recorder(WebviewWindow *window,
+                                                FlMethodCall *method_call) {
+  auto *recorder = window->network_recorder();
+  if (recorder == nullptr) {
+    fl_method_call_respond_error(method_call, "0",
+                                 "network recording was not started", nullptr,
+                                 nullptr);
+  }
+  return recorder;
+}
+
+static void handle_stop_network_recording(WebviewWindowPlugin *self,
+                                          WebviewWindow *window,
+                                          FlMethodCall *method_call,
+                                          FlValue *args) {
+  auto *recorder = lookup_network_recorder(window, method_call);
+  if (recorder == nullptr) {
+    return;
+  }
+  recorder->SetRecording(false);
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_clear_network_recording(WebviewWindowPlugin *self,
+                                           WebviewWindow *window,
+                                           FlMethodCall *method_call,
+                                           FlValue *args) {
+  auto *recorder = lookup_network_recorder(window, method_call);
+  if (recorder == nullptr) {
+    return;
+  }
+  recorder->Clear();
+  fl_method_call_respond_success(method_call, nullptr, nullptr);
+}
+
+static void handle_get_network_recording_stats(WebviewWindowPlugin *self,
+                                               WebviewWindow *window,
+                                               FlMethodCall *method_call,
+                                               FlValue *args) {
+  auto *recorder = lookup_network_recorder(window, method_call);
+  if (recorder == nullptr) {
+    return;
+  }
+  g_autoptr(FlValue) stats = recorder->GetStats();
+  fl_method_call_respond_success(method_call, stats, nullptr);
+}
+
+static void handle_export_har(WebviewWindowPlugin *self, WebviewWindow *window,
+                              FlMethodCall *method_call, FlValue *args) {
+  auto *path = lookup_string(args, "path");
+  if (path == nullptr) {
+    fl_method_call_respond_error(method_call, "0", "path is not string",
+                                 nullptr, nullptr);
+    return;
+  }
+  auto *recorder = lookup_network_recorder(window, method_call);
+  if (recorder == nullptr) {
+    return;
+  }
+  recorder->ExportHar(path, method_call);
+}
+
+static MethodTable *build_method_table() {
+  auto *table = new MethodTable();
+  auto plugin_method = [table](const char *name, PluginMethodHandler handler,
+                               bool requires_args) {
+    table->insert({name, {handler, nullptr, requires_args, false}});
+  };
+  auto window_method = [table](const char *name, WindowMethodHandler handler) {
+    table->insert({name, {nullptr, handler, true, false}});
+  };
+  auto passive_window_method = [table](const char *name,
+                                       WindowMethodHandler handler) {
+    table->insert({name, {nullptr, handler, true, true}});
+  };
+
+  plugin_method("create", handle_create, true);
+  plugin_method("clearAll", handle_clear_all, false);
+  plugin_method("configurePool", handle_configure_pool, true);
+  plugin_method("registerAssetScheme", handle_register_asset_scheme, true);
+  plugin_method("addContentFilter", handle_add_content_filter, true);
+  plugin_method("removeContentFilter", handle_remove_content_filter, true);
+  plugin_method("getUserScriptStats", handle_get_user_script_stats, false);
+  plugin_method("snapshotUrls", handle_snapshot_urls, true);
+  plugin_method("prefetch", handle_prefetch, true);
+  plugin_method("setDefaultDiskCacheLimit",
+                handle_set_default_disk_cache_limit, true);
+  plugin_method("setDefaultCookieStorage", handle_set_default_cookie_storage,
+                true);
+  plugin_method("setDiscardPolicy", handle_set_discard_policy, true);
+  plugin_method("getDiscardStats", handle_get_discard_stats, false);
+
+  window_method("launch", handle_launch);
+  window_method("addScriptToExecuteOnDocumentCreated",
+                handle_add_script_to_execute_on_document_created);
+  window_method("addUserScript", handle_add_user_script);
+  window_method("removeUserScript", handle_remove_user_script);
+  window_method("replaceUserScript", handle_replace_user_script);
+  window_method("setApplicationNameForUserAgent",
+                handle_set_application_name_for_user_agent);
+  window_method("back", handle_back);
+  window_method("forward", handle_forward);
+  window_method("reload", handle_reload);
+  window_method("stop", handle_stop);
+  window_method("getAllCookies", handle_get_all_cookies);
+  window_method("setCookieWatch", handle_set_cookie_watch);
+  window_method("setCookies", handle_set_cookies);
+  window_method("deleteCookies", handle_delete_cookies);
+  window_method("exportCookies", handle_export_cookies);
+  window_method("importCookies", handle_import_cookies);
+  passive_window_method("close", handle_close);
+  passive_window_method("discard", handle_discard);
+  passive_window_method("isDiscarded", handle_is_discarded);
+  passive_window_method("saveSessionState", handle_save_session_state);
+  window_method("restore", handle_restore);
+  window_method("evaluateJavaScript", handle_evaluate_java_script);
+  window_method("evaluateJavaScriptBatch", handle_evaluate_java_script_batch);
+  window_method("takeSnapshot", handle_take_snapshot);
+  window_method("setMessageBatching", handle_set_message_batching);
+  window_method("getMessageStats", handle_get_message_stats);
+  window_method("postWebMessageAsString", handle_post_web_message_as_string);
+  window_method("postWebMessageAsJson", handle_post_web_message_as_json);
+  passive_window_method("getMemoryUsage", handle_get_memory_usage);
+  window_method("queryDom", handle_query_dom);
+  window_method("setUrlRules", handle_set_url_rules);
+  window_method("getContentFilterStats", handle_get_content_filter_stats);
+  window_method("setNavigationMetrics", handle_set_navigation_metrics);
+  window_method("resizeTexture", handle_resize_texture);
+  window_method("sendTexturePointerEvent", handle_send_texture_pointer_event);
+  window_method("sendTextureKeyEvent", handle_send_texture_key_event);
+  window_method("setTextureFocus", handle_set_texture_focus);
+  window_method("getTextureStats", handle_get_texture_stats);
+  window_method("setDownloadConfig", handle_set_download_config);
+  window_method("startDownload", handle_start_download);
+  window_method("cancelDownload", handle_cancel_download);
+  window_method("resumeDownload", handle_resume_download);
+  window_method("getDownloads", handle_get_downloads);
+  window_method("startNetworkRecording", handle_start_network_recording);
+  window_method("stopNetworkRecording", handle_stop_network_recording);
+  window_method("clearNetworkRecording", handle_clear_network_recording);
+  window_method("getNetworkRecordingStats",
+                handle_get_network_recording_stats);
+  window_method("exportHar", handle_export_har);
+  return table;
+}
+
+// Called when a method call is received from Flutter.
+static void webview_window_plugin_handle_method_call(
+    WebviewWindowPlugin *self, FlMethodCall *method_call) {
+  const gchar *method = fl_method_call_get_name(method_call);
+
+  auto entry = self->methods->find(method);
+  if (entry == self->methods->end()) {
     fl_method_call_respond_not_implemented(method_call, nullptr);
+    return;
   }
+
+  auto *args = fl_method_call_get_args(method_call);
+  auto is_map = args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP;
+  if (entry->second.requires_args && !is_map) {
+    respond_args_error(method_call);
+    return;
+  }
+
+  if (entry->second.plugin_handler) {
+    entry->second.plugin_handler(self, method_call, args);
+    return;
+  }
+
+  auto *window = lookup_window(self, args);
+  if (window == nullptr) {
+    fl_method_call_respond_error(method_call, "0",
+                                 "can not found webview for viewId", nullptr,
+                                 nullptr);
+    return;
+  }
+  if (!entry->second.passive) {
+    self->discarder->OnWindowCall(window);
+  }
+  entry->second.window_handler(self, window, method_call, args);
 }
 
 static void webview_window_plugin_dispose(GObject *object) {
-  delete WEBVIEW_WINDOW_PLUGIN(object)->windows;
-  g_object_unref(WEBVIEW_WINDOW_PLUGIN(object)->method_channel);
+  auto *self = WEBVIEW_WINDOW_PLUGIN(object);
+  delete self->windows;
+  self->windows = nullptr;
+  if (self->pool) {
+    while (!self->pool->windows.empty()) {
+      self->pool->windows.back()->Close();
+    }
+    delete self->pool;
+    self->pool = nullptr;
+  }
+  // Windows unregister their textures, so this goes after them.
+  g_clear_object(&self->texture_registrar);
+  // Windows release their scripts, so this goes after them.
+  delete self->user_scripts;
+  self->user_scripts = nullptr;
+  // Windows report restores to the discarder, so it goes after them.
+  delete self->discarder;
+  self->discarder = nullptr;
+  delete self->methods;
+  self->methods = nullptr;
+  g_clear_object(&self->method_channel);
+  delete self->sessions;
+  self->sessions = nullptr;
+  // Contexts keep their handlers alive.
+  delete self->asset_schemes;
+  self->asset_schemes = nullptr;
+  // Drops pending compilations without answering them.
+  delete self->content_filters;
+  self->content_filters = nullptr;
   G_OBJECT_CLASS(webview_window_plugin_parent_class)->dispose(object);
 }
 
@@ -326,7 +1600,22 @@ static void webview_window_plugin_class_init(WebviewWindowPluginClass *klass) {
 }
 
 static void webview_window_plugin_init(WebviewWindowPlugin *self) {
-  self->windows = new std::map<int64_t, std::unique_ptr<WebviewWindow>>();
+  self->windows = new WindowRegistry();
+  self->pool = new WindowPool();
+  self->sessions = new SessionRegistry();
+  self->sessions->AddContextInitializer(web_extension_client_attach);
+  self->asset_schemes = new AssetSchemeRegistry();
+  self->content_filters = new ContentFilterRegistry();
+  self->user_scripts = new UserScriptRegistry();
+  self->discarder = new WindowDiscarder([self] {
+    std::vector<WebviewWindow *> windows;
+    windows.reserve(self->windows->size());
+    for (const auto &item : *self->windows) {
+      windows.push_back(item.second.get());
+    }
+    return windows;
+  });
+  self->methods = build_method_table();
 }
 
 static void method_call_cb(FlMethodChannel *channel, FlMethodCall *method_call,
@@ -346,6 +1635,13 @@ void desktop_webview_window_plugin_register_with_registrar(
                             "webview_window", FL_METHOD_CODEC(codec));
   g_object_ref(channel);
   plugin->method_channel = channel;
+  // Registrars without an engine, like the benchmark's, have none.
+  auto *texture_registrar =
+      fl_plugin_registrar_get_texture_registrar(registrar);
+  plugin->texture_registrar =
+      texture_registrar
+          ? FL_TEXTURE_REGISTRAR(g_object_ref(texture_registrar))
+          : nullptr;
   fl_method_channel_set_method_call_handler(
       channel, method_call_cb, g_object_ref(plugin), g_object_unref);
 
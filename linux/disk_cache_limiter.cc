@@ -0,0 +1,116 @@
+#include "disk_cache_limiter.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr char kLimiterDataKey[] = "webview-disk-cache-limiter";
+
+constexpr guint kTrimIntervalSeconds = 60;
+
+struct FetchRequest {
+  DiskCacheLimiter *limiter;
+  GCancellable *cancellable;
+};
+
+}  // namespace
+
+void DiskCacheLimiter::Attach(WebKitWebsiteDataManager *manager,
+                              guint64 limit_bytes) {
+  if (limit_bytes == 0) {
+    g_object_set_data(G_OBJECT(manager), kLimiterDataKey, nullptr);
+    return;
+  }
+  g_object_set_data_full(G_OBJECT(manager), kLimiterDataKey,
+                         new DiskCacheLimiter(manager, limit_bytes),
+                         [](gpointer data) {
+                           delete static_cast<DiskCacheLimiter *>(data);
+                         });
+}
+
+DiskCacheLimiter::DiskCacheLimiter(WebKitWebsiteDataManager *manager,
+                                   guint64 limit_bytes)
+    : manager_(manager),
+      limit_bytes_(limit_bytes),
+      cancellable_(g_cancellable_new()) {
+  timer_source_ = g_timeout_add_seconds(
+      kTrimIntervalSeconds,
+      [](gpointer user_data) -> gboolean {
+        static_cast<DiskCacheLimiter *>(user_data)->Trim();
+        return G_SOURCE_CONTINUE;
+      },
+      this);
+  // The cache may already be over a new limit.
+  Trim();
+}
+
+DiskCacheLimiter::~DiskCacheLimiter() {
+  g_source_remove(timer_source_);
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+}
+
+void DiskCacheLimiter::Trim() {
+  if (trimming_) {
+    return;
+  }
+  trimming_ = true;
+  webkit_website_data_manager_fetch(
+      manager_, WEBKIT_WEBSITE_DATA_DISK_CACHE, cancellable_, OnFetched,
+      new FetchRequest{this, G_CANCELLABLE(g_object_ref(cancellable_))});
+}
+
+void DiskCacheLimiter::OnFetched(GObject *object, GAsyncResult *result,
+                                 gpointer user_data) {
+  auto *request = static_cast<FetchRequest *>(user_data);
+  auto cancelled = g_cancellable_is_cancelled(request->cancellable);
+  auto *limiter = request->limiter;
+  g_object_unref(request->cancellable);
+  delete request;
+
+  g_autoptr(GError) error = nullptr;
+  auto *list = webkit_website_data_manager_fetch_finish(
+      WEBKIT_WEBSITE_DATA_MANAGER(object), result, &error);
+  if (cancelled) {
+    g_list_free_full(
+        list, reinterpret_cast<GDestroyNotify>(webkit_website_data_unref));
+    return;
+  }
+  limiter->trimming_ = false;
+
+  // Only the disk cache has a known size, which is what was fetched.
+  std::vector<std::pair<guint64, WebKitWebsiteData *>> origins;
+  guint64 total = 0;
+  for (auto *item = list; item; item = item->next) {
+    auto *data = static_cast<WebKitWebsiteData *>(item->data);
+    auto size =
+        webkit_website_data_get_size(data, WEBKIT_WEBSITE_DATA_DISK_CACHE);
+    total += size;
+    origins.push_back({size, data});
+  }
+  if (total > limiter->limit_bytes_) {
+    std::sort(origins.begin(), origins.end(),
+              [](const std::pair<guint64, WebKitWebsiteData *> &a,
+                 const std::pair<guint64, WebKitWebsiteData *> &b) {
+                return a.first > b.first;
+              });
+    // Trim below the limit, so the next pages do not trigger it again.
+    auto target = limiter->limit_bytes_ / 4 * 3;
+    GList *evicted = nullptr;
+    for (const auto &origin : origins) {
+      if (total <= target) {
+        break;
+      }
+      evicted = g_list_prepend(evicted, origin.second);
+      total -= origin.first;
+    }
+    webkit_website_data_manager_remove(limiter->manager_,
+                                       WEBKIT_WEBSITE_DATA_DISK_CACHE,
+                                       evicted, nullptr, nullptr, nullptr);
+    g_list_free(evicted);
+  }
+  g_list_free_full(list,
+                   reinterpret_cast<GDestroyNotify>(webkit_website_data_unref));
+}
@@ -0,0 +1,40 @@
+#ifndef WEBVIEW_WINDOW_LINUX_DISK_CACHE_LIMITER_H_
+#define WEBVIEW_WINDOW_LINUX_DISK_CACHE_LIMITER_H_
+
+#include <webkit2/webkit2.h>
+
+// Keeps the HTTP disk cache of a website data manager under a size limit.
+//
+// WebKit sizes its disk cache from the cache model and the free disk space
+// and has no setting for it. The limiter measures the cache per origin
+// every minute and, once it is over the limit, evicts the largest origins
+// until it is back under three quarters of it.
+class DiskCacheLimiter {
+ public:
+  // Limits the cache of |manager|, replacing an earlier limit. The manager
+  // owns the limiter. A limit of 0 removes it.
+  static void Attach(WebKitWebsiteDataManager *manager, guint64 limit_bytes);
+
+  ~DiskCacheLimiter();
+
+  DiskCacheLimiter(const DiskCacheLimiter &) = delete;
+  DiskCacheLimiter &operator=(const DiskCacheLimiter &) = delete;
+
+ private:
+  DiskCacheLimiter(WebKitWebsiteDataManager *manager, guint64 limit_bytes);
+
+  // Not owned, the manager owns this.
+  WebKitWebsiteDataManager *manager_;
+  guint64 limit_bytes_;
+  guint timer_source_ = 0;
+  bool trimming_ = false;
+  // Cancelled when the limiter goes away with a measurement in flight.
+  GCancellable *cancellable_;
+
+  void Trim();
+
+  static void OnFetched(GObject *object, GAsyncResult *result,
+                        gpointer user_data);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_DISK_CACHE_LIMITER_H_
@@ -0,0 +1,397 @@
+#include "download_controller.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr char kRecordDataKey[] = "webview-download-record";
+
+constexpr char kFallbackFilename[] = "download";
+
+// Returns |filename| with " (n)" added before its extension.
+std::string numbered_filename(const std::string &filename, int n) {
+  auto dot = filename.rfind('.');
+  // A leading dot marks a hidden file, not an extension.
+  if (dot == std::string::npos || dot == 0) {
+    dot = filename.size();
+  }
+  return filename.substr(0, dot) + " (" + std::to_string(n) + ")" +
+         filename.substr(dot);
+}
+
+}  // namespace
+
+DownloadController::DownloadController(FlMethodChannel *method_channel,
+                                       int64_t window_id, GtkWidget *view)
+    : method_channel_(method_channel),
+      window_id_(window_id),
+      view_(view),
+      context_(WEBKIT_WEB_CONTEXT(g_object_ref(
+          webkit_web_view_get_context(WEBKIT_WEB_VIEW(view))))),
+      cancellable_(g_cancellable_new()) {
+  // Downloads of all views of the context arrive here, OnStarted() picks
+  // the ones of |view_|.
+  started_handler_ = g_signal_connect(context_, "download-started",
+                                      G_CALLBACK(OnStarted), this);
+}
+
+DownloadController::~DownloadController() {
+  g_signal_handler_disconnect(context_, started_handler_);
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  for (auto &item : downloads_) {
+    auto *record = item.second.get();
+    if (record->progress_source) {
+      g_source_remove(record->progress_source);
+    }
+    if (record->download) {
+      // Disconnected first, so the cancellation sends no events.
+      auto *download = WEBKIT_DOWNLOAD(g_object_ref(record->download));
+      Release(record);
+      webkit_download_cancel(download);
+      g_object_unref(download);
+    }
+  }
+  g_object_unref(context_);
+}
+
+void DownloadController::SetConfig(const DownloadConfig &config) {
+  config_ = config;
+}
+
+int64_t DownloadController::Start(const char *url) {
+  auto record = std::make_unique<Download>();
+  record->controller = this;
+  record->id = next_download_id_++;
+  record->url = url;
+  auto *download = record.get();
+  downloads_.insert({download->id, std::move(record)});
+  Restart(download);
+  return download->id;
+}
+
+bool DownloadController::Cancel(int64_t download_id) {
+  auto it = downloads_.find(download_id);
+  if (it == downloads_.end() || it->second->state != State::kInProgress ||
+      it->second->download == nullptr) {
+    return false;
+  }
+  // Ends in OnFailed() with a cancelled error.
+  webkit_download_cancel(it->second->download);
+  return true;
+}
+
+bool DownloadController::Resume(int64_t download_id) {
+  auto it = downloads_.find(download_id);
+  if (it == downloads_.end() ||
+      (it->second->state != State::kFailed &&
+       it->second->state != State::kCancelled)) {
+    return false;
+  }
+  auto *record = it->second.get();
+  // The "finished" of the old download may still be on its way.
+  if (record->download) {
+    Release(record);
+  }
+  record->received_bytes = 0;
+  record->total_bytes = 0;
+  record->state = State::kInProgress;
+  record->error.clear();
+  Restart(record);
+  return true;
+}
+
+FlValue *DownloadController::GetDownloads() const {
+  auto *list = fl_value_new_list();
+  for (const auto &item : downloads_) {
+    fl_value_append_take(list, DownloadToFlValue(item.second.get()));
+  }
+  return list;
+}
+
+void DownloadController::Restart(Download *record) {
+  // WebKit may announce the download before download_uri() returns.
+  adopting_ = record;
+  auto *download = webkit_web_view_download_uri(WEBKIT_WEB_VIEW(view_),
+                                                record->url.c_str());
+  adopting_ = nullptr;
+  if (record->download == nullptr) {
+    Track(download, record);
+  }
+  g_object_unref(download);
+}
+
+void DownloadController::Track(WebKitDownload *download, Download *record) {
+  if (record == nullptr) {
+    auto new_record = std::make_unique<Download>();
+    new_record->controller = this;
+    new_record->id = next_download_id_++;
+    new_record->url = webkit_uri_request_get_uri(
+        webkit_download_get_request(download));
+    record = new_record.get();
+    downloads_.insert({record->id, std::move(new_record)});
+  }
+  record->download = WEBKIT_DOWNLOAD(g_object_ref(download));
+  g_object_set_data(G_OBJECT(download), kRecordDataKey, record);
+  g_signal_connect(download, "decide-destination",
+                   G_CALLBACK(OnDecideDestination), record);
+  g_signal_connect(download, "received-data", G_CALLBACK(OnReceivedData),
+                   record);
+  g_signal_connect(download, "failed", G_CALLBACK(OnFailed), record);
+  g_signal_connect(download, "finished", G_CALLBACK(OnFinished), record);
+  SendUpdate(record);
+}
+
+void DownloadController::Release(Download *record) {
+  g_signal_handlers_disconnect_by_data(record->download, record);
+  g_object_set_data(G_OBJECT(record->download), kRecordDataKey, nullptr);
+  g_clear_object(&record->download);
+}
+
+std::string DownloadController::DefaultDestination(
+    const char *suggested_filename) const {
+  auto directory = config_.directory;
+  if (directory.empty()) {
+    auto *downloads = g_get_user_special_dir(G_USER_DIRECTORY_DOWNLOAD);
+    directory = downloads ? downloads : g_get_home_dir();
+  }
+  // Only the last component, the name comes from the server.
+  std::string filename = kFallbackFilename;
+  if (suggested_filename && *suggested_filename) {
+    g_autofree gchar *basename = g_path_get_basename(suggested_filename);
+    if (strcmp(basename, ".") != 0 && strcmp(basename, "..") != 0 &&
+        strcmp(basename, G_DIR_SEPARATOR_S) != 0) {
+      filename = basename;
+    }
+  }
+  g_autofree gchar *path =
+      g_build_filename(directory.c_str(), filename.c_str(), nullptr);
+  std::string result = path;
+  // Overwriting replaces files on disk, never a concurrent download.
+  for (int n = 1; (!config_.overwrite &&
+                   g_file_test(result.c_str(), G_FILE_TEST_EXISTS)) ||
+                  IsDestinationHeld(result);
+       ++n) {
+    g_autofree gchar *numbered = g_build_filename(
+        directory.c_str(), numbered_filename(filename, n).c_str(), nullptr);
+    result = numbered;
+  }
+  return result;
+}
+
+bool DownloadController::IsDestinationHeld(const std::string &path) const {
+  for (const auto &item : downloads_) {
+    const auto &record = *item.second;
+    if (record.state == State::kInProgress &&
+        (record.destination == path || record.offered_destination == path)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DownloadController::SetDestination(Download *record,
+                                        const std::string &path,
+                                        bool overwrite) {
+  g_autofree gchar *directory = g_path_get_dirname(path.c_str());
+  g_mkdir_with_parents(directory, 0755);
+  g_autoptr(GError) error = nullptr;
+  g_autofree gchar *uri = g_filename_to_uri(path.c_str(), nullptr, &error);
+  if (uri == nullptr) {
+    g_warning("invalid download destination %s: %s", path.c_str(),
+              error->message);
+    webkit_download_cancel(record->download);
+    return;
+  }
+  record->destination = path;
+  record->offered_destination.clear();
+  webkit_download_set_allow_overwrite(record->download, overwrite);
+  webkit_download_set_destination(record->download, uri);
+}
+
+void DownloadController::OnProgress(Download *record) {
+  if (config_.progress_interval_ms <= 0 || record->progress_source) {
+    return;
+  }
+  auto interval_us = static_cast<gint64>(config_.progress_interval_ms) * 1000;
+  auto elapsed = g_get_monotonic_time() - record->last_progress_time;
+  if (elapsed >= interval_us) {
+    SendUpdate(record);
+    return;
+  }
+  record->progress_source = g_timeout_add(
+      static_cast<guint>((interval_us - elapsed + 999) / 1000),
+      [](gpointer user_data) -> gboolean {
+        auto *record = static_cast<Download *>(user_data);
+        record->progress_source = 0;
+        record->controller->SendUpdate(record);
+        return G_SOURCE_REMOVE;
+      },
+      record);
+}
+
+void DownloadController::SendUpdate(Download *record) {
+  // The update carries the latest progress.
+  if (record->progress_source) {
+    g_source_remove(record->progress_source);
+    record->progress_source = 0;
+  }
+  record->last_progress_time = g_get_monotonic_time();
+  auto *args = DownloadToFlValue(record);
+  fl_value_set_string_take(args, "id", fl_value_new_int(window_id_));
+  fl_method_channel_invoke_method(method_channel_, "onDownloadChanged", args,
+                                  nullptr, nullptr, nullptr);
+  fl_value_unref(args);
+}
+
+FlValue *DownloadController::DownloadToFlValue(const Download *record) const {
+  auto *value = fl_value_new_map();
+  fl_value_set_string_take(value, "downloadId", fl_value_new_int(record->id));
+  fl_value_set_string_take(value, "url",
+                           fl_value_new_string(record->url.c_str()));
+  fl_value_set_string_take(value, "path",
+                           record->destination.empty()
+                               ? fl_value_new_null()
+                               : fl_value_new_string(
+                                     record->destination.c_str()));
+  fl_value_set_string_take(
+      value, "receivedBytes",
+      fl_value_new_int(static_cast<int64_t>(record->received_bytes)));
+  fl_value_set_string_take(
+      value, "totalBytes",
+      record->total_bytes > 0
+          ? fl_value_new_int(static_cast<int64_t>(record->total_bytes))
+          : fl_value_new_null());
+  fl_value_set_string_take(value, "state",
+                           fl_value_new_int(static_cast<int>(record->state)));
+  if (!record->error.empty()) {
+    fl_value_set_string_take(value, "error",
+                             fl_value_new_string(record->error.c_str()));
+  }
+  return value;
+}
+
+void DownloadController::OnStarted(WebKitWebContext *context,
+                                   WebKitDownload *download,
+                                   gpointer user_data) {
+  auto *self = static_cast<DownloadController *>(user_data);
+  if (webkit_download_get_web_view(download) !=
+          WEBKIT_WEB_VIEW(self->view_) ||
+      g_object_get_data(G_OBJECT(download), kRecordDataKey)) {
+    return;
+  }
+  self->Track(download, self->adopting_);
+}
+
+gboolean DownloadController::OnDecideDestination(WebKitDownload *download,
+                                                 gchar *suggested_filename,
+                                                 gpointer user_data) {
+  auto *record = static_cast<Download *>(user_data);
+  auto *self = record->controller;
+  // A resumed download goes where it went before.
+  if (!record->destination.empty()) {
+    self->SetDestination(record, record->destination, true);
+    return TRUE;
+  }
+  auto path = self->DefaultDestination(suggested_filename);
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+  if (self->config_.ask_destination) {
+    // The download waits until a destination is set or it is cancelled.
+    auto *args = self->DownloadToFlValue(record);
+    fl_value_set_string_take(args, "id", fl_value_new_int(self->window_id_));
+    fl_value_set_string_take(
+        args, "suggestedFilename",
+        fl_value_new_string(suggested_filename ? suggested_filename : ""));
+    auto *response = webkit_download_get_response(download);
+    auto *mime_type =
+        response ? webkit_uri_response_get_mime_type(response) : nullptr;
+    if (mime_type) {
+      fl_value_set_string_take(args, "mimeType",
+                               fl_value_new_string(mime_type));
+    }
+    fl_value_set_string_take(args, "defaultPath",
+                             fl_value_new_string(path.c_str()));
+    record->offered_destination = path;
+    struct DestinationRequest {
+      Download *record;
+      std::string default_path;
+    };
+    fl_method_channel_invoke_method(
+        self->method_channel_, "onDownloadDestination", args,
+        self->cancellable_,
+        [](GObject *object, GAsyncResult *result, gpointer user_data) {
+          std::unique_ptr<DestinationRequest> request(
+              static_cast<DestinationRequest *>(user_data));
+          g_autoptr(GError) error = nullptr;
+          g_autoptr(FlMethodResponse) response =
+              fl_method_channel_invoke_method_finish(
+                  FL_METHOD_CHANNEL(object), result, &error);
+          // Cancelled when the controller has been deleted.
+          if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            return;
+          }
+          auto *record = request->record;
+          if (record->download == nullptr ||
+              record->state != State::kInProgress) {
+            return;
+          }
+          auto *value =
+              response ? fl_method_response_get_result(response, nullptr)
+                       : nullptr;
+          if (value == nullptr) {
+            // Dart failed to answer, fall back to the native destination.
+            record->controller->SetDestination(
+                record, request->default_path,
+                record->controller->config_.overwrite);
+          } else if (fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
+            // Dart picked the path, so an existing file is replaced.
+            record->controller->SetDestination(
+                record, fl_value_get_string(value), true);
+          } else {
+            webkit_download_cancel(record->download);
+          }
+        },
+        new DestinationRequest{record, path});
+    fl_value_unref(args);
+    return TRUE;
+  }
+#endif
+  self->SetDestination(record, path, self->config_.overwrite);
+  return TRUE;
+}
+
+void DownloadController::OnReceivedData(WebKitDownload *download,
+                                        guint64 length, gpointer user_data) {
+  auto *record = static_cast<Download *>(user_data);
+  record->received_bytes += length;
+  auto *response = webkit_download_get_response(download);
+  if (response) {
+    record->total_bytes = webkit_uri_response_get_content_length(response);
+  }
+  record->controller->OnProgress(record);
+}
+
+void DownloadController::OnFailed(WebKitDownload *download, GError *error,
+                                  gpointer user_data) {
+  auto *record = static_cast<Download *>(user_data);
+  if (g_error_matches(error, WEBKIT_DOWNLOAD_ERROR,
+                      WEBKIT_DOWNLOAD_ERROR_CANCELLED_BY_USER)) {
+    record->state = State::kCancelled;
+  } else {
+    record->state = State::kFailed;
+    record->error = error->message;
+  }
+  record->controller->SendUpdate(record);
+}
+
+void DownloadController::OnFinished(WebKitDownload *download,
+                                    gpointer user_data) {
+  auto *record = static_cast<Download *>(user_data);
+  auto *self = record->controller;
+  // Failed downloads finish as well, after OnFailed().
+  if (record->state == State::kInProgress) {
+    record->state = State::kFinished;
+    self->SendUpdate(record);
+  }
+  self->Release(record);
+}
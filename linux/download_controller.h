@@ -0,0 +1,138 @@
+#ifndef WEBVIEW_WINDOW_LINUX_DOWNLOAD_CONTROLLER_H_
+#define WEBVIEW_WINDOW_LINUX_DOWNLOAD_CONTROLLER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+#include <webkit2/webkit2.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+struct DownloadConfig {
+  // Directory downloads are saved in, the XDG download directory if empty.
+  std::string directory;
+  // Replace existing files instead of picking a free name.
+  bool overwrite = false;
+  // Let Dart pick each destination with onDownloadDestination. Needs
+  // WebKitGTK 2.40, older releases always use |directory|.
+  bool ask_destination = false;
+  // Minimum interval between progress events of one download, 0 sends
+  // only the state changes.
+  int progress_interval_ms = 100;
+};
+
+// Saves the downloads of a web view straight to their destination and
+// reports them to Dart with onDownloadChanged.
+//
+// Downloads are numbered per controller. Deleting the controller cancels
+// the downloads still running, without events.
+class DownloadController {
+ public:
+  DownloadController(FlMethodChannel *method_channel, int64_t window_id,
+                     GtkWidget *view);
+
+  ~DownloadController();
+
+  DownloadController(const DownloadController &) = delete;
+  DownloadController &operator=(const DownloadController &) = delete;
+
+  void SetConfig(const DownloadConfig &config);
+
+  // Downloads |url| in the view. Returns the download id.
+  int64_t Start(const char *url);
+
+  // Returns false if |download_id| is unknown or not running.
+  bool Cancel(int64_t download_id);
+
+  // Starts a failed or cancelled download again, to the same destination.
+  // WebKit can not continue a partial file, so the download starts over.
+  // Returns false if |download_id| is unknown or still running.
+  bool Resume(int64_t download_id);
+
+  // Returns the state of every download, see DownloadToFlValue().
+  FlValue *GetDownloads() const;
+
+ private:
+  enum class State {
+    kInProgress = 0,
+    kFinished = 1,
+    kFailed = 2,
+    kCancelled = 3,
+  };
+
+  struct Download {
+    DownloadController *controller;
+    int64_t id;
+    // Null once the download ended.
+    WebKitDownload *download = nullptr;
+    std::string url;
+    // Empty until the destination is decided.
+    std::string destination;
+    // The default destination offered to Dart, held while it answers.
+    std::string offered_destination;
+    guint64 received_bytes = 0;
+    // 0 if the response has no Content-Length.
+    guint64 total_bytes = 0;
+    State state = State::kInProgress;
+    std::string error;
+    gint64 last_progress_time = 0;
+    guint progress_source = 0;
+  };
+
+  FlMethodChannel *method_channel_;
+  int64_t window_id_;
+  GtkWidget *view_;
+  WebKitWebContext *context_;
+  gulong started_handler_ = 0;
+  DownloadConfig config_;
+  // Cancelled on destruction, while Dart may still pick a destination.
+  GCancellable *cancellable_;
+
+  std::map<int64_t, std::unique_ptr<Download>> downloads_;
+  int64_t next_download_id_ = 1;
+  // Takes the download that Start() or Resume() is starting.
+  Download *adopting_ = nullptr;
+
+  // Starts tracking |download| as |record|, or as a new record if null.
+  void Track(WebKitDownload *download, Download *record);
+
+  // Disconnects from the WebKit download of |record| and drops it.
+  void Release(Download *record);
+
+  // Starts |record| over with a new WebKit download.
+  void Restart(Download *record);
+
+  // Returns a path in the download directory that neither a file nor
+  // another download in progress holds, numbered with " (n)" if needed.
+  std::string DefaultDestination(const char *suggested_filename) const;
+
+  // Whether a download in progress writes to, or was offered, |path|.
+  bool IsDestinationHeld(const std::string &path) const;
+
+  void SetDestination(Download *record, const std::string &path,
+                      bool overwrite);
+
+  void OnProgress(Download *record);
+
+  void SendUpdate(Download *record);
+
+  FlValue *DownloadToFlValue(const Download *record) const;
+
+  static void OnStarted(WebKitWebContext *context, WebKitDownload *download,
+                        gpointer user_data);
+
+  static gboolean OnDecideDestination(WebKitDownload *download,
+                                      gchar *suggested_filename,
+                                      gpointer user_data);
+
+  static void OnReceivedData(WebKitDownload *download, guint64 length,
+                             gpointer user_data);
+
+  static void OnFailed(WebKitDownload *download, GError *error,
+                       gpointer user_data);
+
+  static void OnFinished(WebKitDownload *download, gpointer user_data);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_DOWNLOAD_CONTROLLER_H_
@@ -0,0 +1,180 @@
+#include "js_value_converter.h"
+
+#include <webkit2/webkit2.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if WEBKIT_MAJOR_VERSION > 2 || \
+    (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 38)
+#define JSC_TYPED_ARRAY_SUPPORTED
+#endif
+
+namespace {
+
+constexpr int kMaxDepth = 32;
+
+// Values converted per call, so shared subtrees and sparse arrays with a
+// huge length can not stall the UI thread.
+constexpr size_t kMaxNodes = 1 << 20;
+
+// Largest integer a double represents exactly.
+constexpr double kMaxSafeInteger = 9007199254740991.0;
+
+FlValue *number_to_fl_value(double number) {
+  double integral;
+  if (std::modf(number, &integral) == 0.0 &&
+      std::fabs(number) <= kMaxSafeInteger) {
+    return fl_value_new_int(static_cast<int64_t>(number));
+  }
+  return fl_value_new_float(number);
+}
+
+#ifdef JSC_TYPED_ARRAY_SUPPORTED
+FlValue *typed_array_to_fl_value(JSCValue *value) {
+  gsize length = 0;
+  auto *data = jsc_value_typed_array_get_data(value, &length);
+  switch (jsc_value_typed_array_get_type(value)) {
+    case JSC_TYPED_ARRAY_INT32:
+      return fl_value_new_int32_list(static_cast<const int32_t *>(data),
+                                     length);
+    case JSC_TYPED_ARRAY_INT64:
+      return fl_value_new_int64_list(static_cast<const int64_t *>(data),
+                                     length);
+    case JSC_TYPED_ARRAY_FLOAT64:
+      return fl_value_new_float_list(static_cast<const double *>(data),
+                                     length);
+    default:
+      return fl_value_new_uint8_list(static_cast<const uint8_t *>(data),
+                                     jsc_value_typed_array_get_size(value));
+  }
+}
+#endif
+
+class Converter {
+ public:
+  // Returns the converted |value|, or null and |error| if it holds more
+  // than kMaxNodes values.
+  FlValue *Convert(JSCValue *value, GError **error) {
+    auto *result = ConvertValue(value);
+    if (too_large_) {
+      fl_value_unref(result);
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE,
+                  "value holds more than %zu items", kMaxNodes);
+      return nullptr;
+    }
+    return result;
+  }
+
+ private:
+  // Reserves |count| more values of the budget.
+  bool Reserve(size_t count) {
+    if (too_large_ || count > kMaxNodes - nodes_) {
+      too_large_ = true;
+      return false;
+    }
+    nodes_ += count;
+    return true;
+  }
+
+  // JSC hands out one JSCValue per JavaScript object while it is alive,
+  // so the objects held on |path_| compare by pointer.
+  bool OnPath(JSCValue *value) const {
+    for (auto *ancestor : path_) {
+      if (ancestor == value) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  FlValue *ConvertArray(JSCValue *value) {
+    auto *list = fl_value_new_list();
+    g_autoptr(JSCValue) length_value =
+        jsc_value_object_get_property(value, "length");
+    auto length = jsc_value_to_double(length_value);
+    if (!(length > 0)) {
+      return list;
+    }
+    if (length > kMaxNodes || !Reserve(static_cast<size_t>(length))) {
+      too_large_ = true;
+      return list;
+    }
+    auto count = static_cast<guint>(length);
+    for (guint i = 0; i < count && !too_large_; ++i) {
+      g_autoptr(JSCValue) item =
+          jsc_value_object_get_property_at_index(value, i);
+      fl_value_append_take(list, ConvertValue(item));
+    }
+    return list;
+  }
+
+  FlValue *ConvertObject(JSCValue *value) {
+    auto *map = fl_value_new_map();
+    gchar **properties = jsc_value_object_enumerate_properties(value);
+    if (properties == nullptr) {
+      return map;
+    }
+    if (Reserve(g_strv_length(properties))) {
+      for (gchar **name = properties; *name != nullptr && !too_large_;
+           ++name) {
+        g_autoptr(JSCValue) property =
+            jsc_value_object_get_property(value, *name);
+        if (jsc_value_is_function(property)) {
+          continue;
+        }
+        fl_value_set_string_take(map, *name, ConvertValue(property));
+      }
+    }
+    g_strfreev(properties);
+    return map;
+  }
+
+  FlValue *ConvertValue(JSCValue *value) {
+    if (value == nullptr || too_large_ ||
+        static_cast<int>(path_.size()) > kMaxDepth ||
+        jsc_value_is_null(value) || jsc_value_is_undefined(value)) {
+      return fl_value_new_null();
+    }
+    if (jsc_value_is_string(value)) {
+      g_autofree gchar *string = jsc_value_to_string(value);
+      return fl_value_new_string(string);
+    }
+    if (jsc_value_is_boolean(value)) {
+      return fl_value_new_bool(jsc_value_to_boolean(value));
+    }
+    if (jsc_value_is_number(value)) {
+      return number_to_fl_value(jsc_value_to_double(value));
+    }
+#ifdef JSC_TYPED_ARRAY_SUPPORTED
+    if (jsc_value_is_typed_array(value)) {
+      return typed_array_to_fl_value(value);
+    }
+    if (jsc_value_is_array_buffer(value)) {
+      gsize size = 0;
+      auto *data = jsc_value_array_buffer_get_data(value, &size);
+      return fl_value_new_uint8_list(static_cast<const uint8_t *>(data), size);
+    }
+#endif
+    if (jsc_value_is_function(value) || !jsc_value_is_object(value) ||
+        OnPath(value)) {
+      return fl_value_new_null();
+    }
+    path_.push_back(value);
+    auto *result = jsc_value_is_array(value) ? ConvertArray(value)
+                                             : ConvertObject(value);
+    path_.pop_back();
+    return result;
+  }
+
+  std::vector<JSCValue *> path_;
+  size_t nodes_ = 0;
+  bool too_large_ = false;
+};
+
+}  // namespace
+
+FlValue *js_value_to_fl_value(JSCValue *value, GError **error) {
+  return Converter().Convert(value, error);
+}
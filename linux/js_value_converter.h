@@ -0,0 +1,20 @@
+#ifndef WEBVIEW_WINDOW_LINUX_JS_VALUE_CONVERTER_H_
+#define WEBVIEW_WINDOW_LINUX_JS_VALUE_CONVERTER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <jsc/jsc.h>
+
+// Converts a JavaScript value to the FlValue the standard codec sends to
+// Dart, without a JSON round trip.
+//
+// Strings, booleans and numbers map to their FlValue counterparts (integral
+// numbers become ints), null and undefined become null, arrays become lists
+// and plain objects become string-keyed maps. ArrayBuffers and typed arrays
+// are copied once into a typed list: Int32Array, BigInt64Array and
+// Float64Array keep their element type, every other view is forwarded as
+// raw bytes. Functions, objects that contain themselves and nesting deeper
+// than a fixed limit become null. Values holding more than a fixed number of
+// items, counting shared objects once per reference, fail with |error|.
+FlValue *js_value_to_fl_value(JSCValue *value, GError **error);
+
+#endif  // WEBVIEW_WINDOW_LINUX_JS_VALUE_CONVERTER_H_
@@ -0,0 +1,398 @@
+#include "network_recorder.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr char kHarCreatorName[] = "desktop_webview_window";
+constexpr char kHarCreatorVersion[] = "0.2.4";
+
+void read_headers(SoupMessageHeaders *headers,
+                  std::vector<std::pair<std::string, std::string>> *out) {
+  out->clear();
+  if (headers == nullptr) {
+    return;
+  }
+  SoupMessageHeadersIter iter;
+  soup_message_headers_iter_init(&iter, headers);
+  const char *name;
+  const char *value;
+  while (soup_message_headers_iter_next(&iter, &name, &value)) {
+    out->push_back({name, value});
+  }
+}
+
+FlValue *headers_to_har(
+    const std::vector<std::pair<std::string, std::string>> &headers) {
+  auto *list = fl_value_new_list();
+  for (const auto &header : headers) {
+    auto *item = fl_value_new_map();
+    fl_value_set_string_take(item, "name",
+                             fl_value_new_string(header.first.c_str()));
+    fl_value_set_string_take(item, "value",
+                             fl_value_new_string(header.second.c_str()));
+    fl_value_append_take(list, item);
+  }
+  return list;
+}
+
+const char *find_header(
+    const std::vector<std::pair<std::string, std::string>> &headers,
+    const char *name) {
+  for (const auto &header : headers) {
+    if (g_ascii_strcasecmp(header.first.c_str(), name) == 0) {
+      return header.second.c_str();
+    }
+  }
+  return nullptr;
+}
+
+double elapsed_ms(gint64 from, gint64 to) {
+  return from && to ? static_cast<double>(to - from) / 1000 : -1;
+}
+
+// Formats a g_get_real_time() value as ISO 8601 with milliseconds.
+std::string iso_time(gint64 wall_time_us) {
+  g_autoptr(GDateTime) time =
+      g_date_time_new_from_unix_utc(wall_time_us / G_USEC_PER_SEC);
+  g_autofree gchar *seconds = g_date_time_format(time, "%Y-%m-%dT%H:%M:%S");
+  g_autofree gchar *result = g_strdup_printf(
+      "%s.%03dZ", seconds,
+      static_cast<int>(wall_time_us % G_USEC_PER_SEC / 1000));
+  return result;
+}
+
+struct ExportRequest {
+  FlMethodCall *call;
+  int64_t entries;
+  int64_t bytes;
+};
+
+}  // namespace
+
+NetworkRecorder::Entry::~Entry() {
+  if (body) {
+    g_bytes_unref(body);
+  }
+}
+
+NetworkRecorder::NetworkRecorder(const NetworkRecorderConfig &config)
+    : config_(config), cancellable_(g_cancellable_new()) {}
+
+NetworkRecorder::~NetworkRecorder() {
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  for (auto &item : pending_) {
+    g_signal_handlers_disconnect_by_data(item.first, this);
+    g_object_unref(item.first);
+  }
+}
+
+void NetworkRecorder::SetRecording(bool recording) { recording_ = recording; }
+
+void NetworkRecorder::OnResourceLoadStarted(WebKitWebResource *resource,
+                                            WebKitURIRequest *request) {
+  if (!recording_) {
+    return;
+  }
+  auto entry = std::make_unique<Entry>();
+  entry->started_wall_time = g_get_real_time();
+  entry->started = g_get_monotonic_time();
+  auto *method = webkit_uri_request_get_http_method(request);
+  entry->method = method ? method : "GET";
+  entry->url = webkit_uri_request_get_uri(request);
+  read_headers(webkit_uri_request_get_http_headers(request),
+               &entry->request_headers);
+  pending_.insert(
+      {WEBKIT_WEB_RESOURCE(g_object_ref(resource)), std::move(entry)});
+  g_signal_connect(resource, "notify::response", G_CALLBACK(OnResponse),
+                   this);
+  g_signal_connect(resource, "failed", G_CALLBACK(OnFailed), this);
+  g_signal_connect(resource, "finished", G_CALLBACK(OnFinished), this);
+}
+
+void NetworkRecorder::ReadResponse(WebKitWebResource *resource,
+                                   Entry *entry) {
+  auto *response = webkit_web_resource_get_response(resource);
+  if (response == nullptr) {
+    return;
+  }
+  entry->status = webkit_uri_response_get_status_code(response);
+  auto *mime_type = webkit_uri_response_get_mime_type(response);
+  entry->mime_type = mime_type ? mime_type : "";
+  read_headers(webkit_uri_response_get_http_headers(response),
+               &entry->response_headers);
+  // 0 is also what WebKit reports without a Content-Length.
+  auto content_length = webkit_uri_response_get_content_length(response);
+  entry->content_length =
+      content_length > 0 ? static_cast<int64_t>(content_length) : -1;
+}
+
+void NetworkRecorder::OnResponse(GObject *object, GParamSpec *pspec,
+                                 gpointer user_data) {
+  auto *self = static_cast<NetworkRecorder *>(user_data);
+  auto *resource = WEBKIT_WEB_RESOURCE(object);
+  auto it = self->pending_.find(resource);
+  if (it == self->pending_.end()) {
+    return;
+  }
+  // Redirects bring a new response, the last one counts.
+  it->second->responded = g_get_monotonic_time();
+  ReadResponse(resource, it->second.get());
+}
+
+void NetworkRecorder::OnFailed(WebKitWebResource *resource, GError *error,
+                               gpointer user_data) {
+  auto *self = static_cast<NetworkRecorder *>(user_data);
+  auto it = self->pending_.find(resource);
+  if (it != self->pending_.end()) {
+    it->second->error = error->message;
+  }
+}
+
+void NetworkRecorder::OnFinished(WebKitWebResource *resource,
+                                 gpointer user_data) {
+  auto *self = static_cast<NetworkRecorder *>(user_data);
+  auto it = self->pending_.find(resource);
+  if (it == self->pending_.end()) {
+    return;
+  }
+  auto *entry = it->second.get();
+  entry->finished = g_get_monotonic_time();
+  ReadResponse(resource, entry);
+  if (!self->config_.fetch_bodies || !entry->error.empty()) {
+    self->Complete(resource);
+    return;
+  }
+  // The entry stays pending until its body arrived.
+  g_signal_handlers_disconnect_by_data(resource, self);
+  webkit_web_resource_get_data(resource, self->cancellable_, OnData, self);
+}
+
+void NetworkRecorder::OnData(GObject *object, GAsyncResult *result,
+                             gpointer user_data) {
+  auto *resource = WEBKIT_WEB_RESOURCE(object);
+  gsize length = 0;
+  g_autoptr(GError) error = nullptr;
+  auto *data =
+      webkit_web_resource_get_data_finish(resource, result, &length, &error);
+  // Cancelled when the recorder has been deleted.
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    g_free(data);
+    return;
+  }
+  auto *self = static_cast<NetworkRecorder *>(user_data);
+  auto it = self->pending_.find(resource);
+  if (it != self->pending_.end() && data) {
+    auto *entry = it->second.get();
+    entry->body_size = static_cast<int64_t>(length);
+    if (length <= self->config_.max_body_bytes) {
+      entry->body = g_bytes_new_take(data, length);
+      data = nullptr;
+    }
+  }
+  g_free(data);
+  self->Complete(resource);
+}
+
+void NetworkRecorder::Complete(WebKitWebResource *resource) {
+  auto it = pending_.find(resource);
+  if (it == pending_.end()) {
+    return;
+  }
+  g_signal_handlers_disconnect_by_data(resource, this);
+  auto entry = std::move(it->second);
+  pending_.erase(it);
+  g_object_unref(resource);
+
+  if (entry->body) {
+    body_bytes_ += g_bytes_get_size(entry->body);
+  }
+  entries_.push_back(std::move(entry));
+  while (entries_.size() > config_.max_entries) {
+    if (entries_.front()->body) {
+      body_bytes_ -= g_bytes_get_size(entries_.front()->body);
+    }
+    entries_.pop_front();
+    dropped_++;
+    if (trimmed_entries_ > 0) {
+      trimmed_entries_--;
+    }
+  }
+  // Bodies go oldest first, so the trimmed entries stay at the front.
+  while (body_bytes_ > config_.max_total_body_bytes &&
+         trimmed_entries_ < entries_.size()) {
+    auto &trimmed = entries_[trimmed_entries_++];
+    if (trimmed->body) {
+      body_bytes_ -= g_bytes_get_size(trimmed->body);
+      g_clear_pointer(&trimmed->body, g_bytes_unref);
+      dropped_bodies_++;
+    }
+  }
+}
+
+void NetworkRecorder::Clear() {
+  entries_.clear();
+  body_bytes_ = 0;
+  dropped_ = 0;
+  dropped_bodies_ = 0;
+  trimmed_entries_ = 0;
+}
+
+FlValue *NetworkRecorder::GetStats() const {
+  auto *stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "recording", fl_value_new_bool(recording_));
+  fl_value_set_string_take(
+      stats, "entries",
+      fl_value_new_int(static_cast<int64_t>(entries_.size())));
+  fl_value_set_string_take(
+      stats, "pending",
+      fl_value_new_int(static_cast<int64_t>(pending_.size())));
+  fl_value_set_string_take(stats, "dropped", fl_value_new_int(dropped_));
+  fl_value_set_string_take(
+      stats, "bodyBytes", fl_value_new_int(static_cast<int64_t>(body_bytes_)));
+  fl_value_set_string_take(stats, "droppedBodies",
+                           fl_value_new_int(dropped_bodies_));
+  return stats;
+}
+
+FlValue *NetworkRecorder::EntryToHar(const Entry &entry) {
+  auto *request = fl_value_new_map();
+  fl_value_set_string_take(request, "method",
+                           fl_value_new_string(entry.method.c_str()));
+  fl_value_set_string_take(request, "url",
+                           fl_value_new_string(entry.url.c_str()));
+  fl_value_set_string_take(request, "httpVersion", fl_value_new_string(""));
+  fl_value_set_string_take(request, "cookies", fl_value_new_list());
+  fl_value_set_string_take(request, "headers",
+                           headers_to_har(entry.request_headers));
+  fl_value_set_string_take(request, "queryString", fl_value_new_list());
+  fl_value_set_string_take(request, "headersSize", fl_value_new_int(-1));
+  fl_value_set_string_take(request, "bodySize", fl_value_new_int(-1));
+
+  auto *content = fl_value_new_map();
+  auto size = entry.body_size >= 0 ? entry.body_size : entry.content_length;
+  fl_value_set_string_take(content, "size", fl_value_new_int(size));
+  fl_value_set_string_take(content, "mimeType",
+                           fl_value_new_string(entry.mime_type.c_str()));
+  if (entry.body) {
+    gsize length;
+    auto *data =
+        static_cast<const gchar *>(g_bytes_get_data(entry.body, &length));
+    if (g_utf8_validate(data, static_cast<gssize>(length), nullptr)) {
+      fl_value_set_string_take(content, "text",
+                               fl_value_new_string_sized(data, length));
+    } else {
+      g_autofree gchar *encoded = g_base64_encode(
+          reinterpret_cast<const guchar *>(data), length);
+      fl_value_set_string_take(content, "text",
+                               fl_value_new_string(encoded));
+      fl_value_set_string_take(content, "encoding",
+                               fl_value_new_string("base64"));
+    }
+  }
+
+  auto *response = fl_value_new_map();
+  fl_value_set_string_take(response, "status",
+                           fl_value_new_int(entry.status));
+  fl_value_set_string_take(
+      response, "statusText",
+      fl_value_new_string(entry.status ? soup_status_get_phrase(entry.status)
+                                       : ""));
+  fl_value_set_string_take(response, "httpVersion", fl_value_new_string(""));
+  fl_value_set_string_take(response, "cookies", fl_value_new_list());
+  fl_value_set_string_take(response, "headers",
+                           headers_to_har(entry.response_headers));
+  fl_value_set_string_take(response, "content", content);
+  auto *location = find_header(entry.response_headers, "Location");
+  fl_value_set_string_take(response, "redirectURL",
+                           fl_value_new_string(location ? location : ""));
+  fl_value_set_string_take(response, "headersSize", fl_value_new_int(-1));
+  fl_value_set_string_take(response, "bodySize", fl_value_new_int(size));
+
+  // Without a response, the whole load counts as waiting.
+  auto responded = entry.responded ? entry.responded : entry.finished;
+  auto *timings = fl_value_new_map();
+  fl_value_set_string_take(timings, "blocked", fl_value_new_int(-1));
+  fl_value_set_string_take(timings, "dns", fl_value_new_int(-1));
+  fl_value_set_string_take(timings, "connect", fl_value_new_int(-1));
+  fl_value_set_string_take(timings, "send", fl_value_new_int(0));
+  fl_value_set_string_take(
+      timings, "wait",
+      fl_value_new_float(elapsed_ms(entry.started, responded)));
+  fl_value_set_string_take(
+      timings, "receive",
+      fl_value_new_float(elapsed_ms(responded, entry.finished)));
+  fl_value_set_string_take(timings, "ssl", fl_value_new_int(-1));
+
+  auto *har = fl_value_new_map();
+  fl_value_set_string_take(
+      har, "startedDateTime",
+      fl_value_new_string(iso_time(entry.started_wall_time).c_str()));
+  fl_value_set_string_take(
+      har, "time",
+      fl_value_new_float(elapsed_ms(entry.started, entry.finished)));
+  fl_value_set_string_take(har, "request", request);
+  fl_value_set_string_take(har, "response", response);
+  fl_value_set_string_take(har, "cache", fl_value_new_map());
+  fl_value_set_string_take(har, "timings", timings);
+  if (!entry.error.empty()) {
+    fl_value_set_string_take(har, "_error",
+                             fl_value_new_string(entry.error.c_str()));
+  }
+  return har;
+}
+
+void NetworkRecorder::ExportHar(const char *path, FlMethodCall *call) {
+  auto *entries = fl_value_new_list();
+  for (const auto &entry : entries_) {
+    fl_value_append_take(entries, EntryToHar(*entry));
+  }
+  auto *creator = fl_value_new_map();
+  fl_value_set_string_take(creator, "name",
+                           fl_value_new_string(kHarCreatorName));
+  fl_value_set_string_take(creator, "version",
+                           fl_value_new_string(kHarCreatorVersion));
+  auto *log = fl_value_new_map();
+  fl_value_set_string_take(log, "version", fl_value_new_string("1.2"));
+  fl_value_set_string_take(log, "creator", creator);
+  fl_value_set_string_take(log, "pages", fl_value_new_list());
+  fl_value_set_string_take(log, "entries", entries);
+  g_autoptr(FlValue) har = fl_value_new_map();
+  fl_value_set_string_take(har, "log", log);
+
+  g_autoptr(FlJsonMessageCodec) codec = fl_json_message_codec_new();
+  g_autoptr(GError) error = nullptr;
+  g_autofree gchar *json = fl_json_message_codec_encode(codec, har, &error);
+  if (json == nullptr) {
+    fl_method_call_respond_error(call, "0", error->message, nullptr,
+                                 nullptr);
+    return;
+  }
+  auto length = strlen(json);
+  g_autoptr(GBytes) bytes = g_bytes_new_take(g_steal_pointer(&json), length);
+  g_autoptr(GFile) file = g_file_new_for_path(path);
+  g_file_replace_contents_bytes_async(
+      file, bytes, nullptr, FALSE, G_FILE_CREATE_REPLACE_DESTINATION, nullptr,
+      [](GObject *object, GAsyncResult *result, gpointer user_data) {
+        std::unique_ptr<ExportRequest> request(
+            static_cast<ExportRequest *>(user_data));
+        g_autoptr(GError) error = nullptr;
+        if (!g_file_replace_contents_finish(G_FILE(object), result, nullptr,
+                                            &error)) {
+          fl_method_call_respond_error(request->call, "0", error->message,
+                                       nullptr, nullptr);
+        } else {
+          g_autoptr(FlValue) value = fl_value_new_map();
+          fl_value_set_string_take(value, "entries",
+                                   fl_value_new_int(request->entries));
+          fl_value_set_string_take(value, "bytes",
+                                   fl_value_new_int(request->bytes));
+          fl_method_call_respond_success(request->call, value, nullptr);
+        }
+        g_object_unref(request->call);
+      },
+      new ExportRequest{FL_METHOD_CALL(g_object_ref(call)),
+                        static_cast<int64_t>(entries_.size()),
+                        static_cast<int64_t>(length)});
+}
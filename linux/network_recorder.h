@@ -0,0 +1,117 @@
+#ifndef WEBVIEW_WINDOW_LINUX_NETWORK_RECORDER_H_
+#define WEBVIEW_WINDOW_LINUX_NETWORK_RECORDER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <libsoup/soup.h>
+#include <webkit2/webkit2.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct NetworkRecorderConfig {
+  // The oldest entries are dropped beyond this many.
+  size_t max_entries = 1000;
+  // Reads every response body, for its exact size and to export it.
+  bool fetch_bodies = false;
+  // Larger bodies are measured but not kept.
+  size_t max_body_bytes = 1 << 20;
+  // The bodies of the oldest entries are dropped beyond this many bytes in
+  // total, their entries are kept.
+  size_t max_total_body_bytes = 64 << 20;
+};
+
+// Records the resources a web view loads into a bounded ring of entries,
+// which ExportHar() writes as a HAR 1.2 file.
+//
+// WebKitGTK only reports when a request starts, when its response arrives
+// and when it ends, so the timings hold "wait" and "receive" only, with
+// connection setup counted in "wait".
+class NetworkRecorder {
+ public:
+  explicit NetworkRecorder(const NetworkRecorderConfig &config);
+
+  ~NetworkRecorder();
+
+  NetworkRecorder(const NetworkRecorder &) = delete;
+  NetworkRecorder &operator=(const NetworkRecorder &) = delete;
+
+  // Resources started while not recording are ignored. Loads in flight
+  // are still completed.
+  void SetRecording(bool recording);
+
+  void OnResourceLoadStarted(WebKitWebResource *resource,
+                             WebKitURIRequest *request);
+
+  // Writes the completed entries to |path| and responds to |call| with
+  // {"entries", "bytes"} once the file is written. The file is encoded
+  // here and written in the background; the entries stay recorded.
+  void ExportHar(const char *path, FlMethodCall *call);
+
+  void Clear();
+
+  // Returns {"recording", "entries", "pending", "dropped", "bodyBytes",
+  // "droppedBodies"}.
+  FlValue *GetStats() const;
+
+ private:
+  typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+  // Timestamps are g_get_monotonic_time() values, 0 if not reached.
+  struct Entry {
+    gint64 started_wall_time = 0;
+    gint64 started = 0;
+    gint64 responded = 0;
+    gint64 finished = 0;
+    std::string method;
+    std::string url;
+    Headers request_headers;
+    guint status = 0;
+    std::string mime_type;
+    Headers response_headers;
+    // -1 if unknown.
+    int64_t content_length = -1;
+    int64_t body_size = -1;
+    GBytes *body = nullptr;
+    std::string error;
+
+    ~Entry();
+  };
+
+  NetworkRecorderConfig config_;
+  bool recording_ = true;
+  std::deque<std::unique_ptr<Entry>> entries_;
+  // Loads in flight, holding a reference on their resource.
+  std::map<WebKitWebResource *, std::unique_ptr<Entry>> pending_;
+  int64_t dropped_ = 0;
+  size_t body_bytes_ = 0;
+  int64_t dropped_bodies_ = 0;
+  // Leading entries whose bodies are dropped, or were never kept.
+  size_t trimmed_entries_ = 0;
+  // Cancels body reads when the recorder goes away.
+  GCancellable *cancellable_;
+
+  static void OnResponse(GObject *object, GParamSpec *pspec,
+                         gpointer user_data);
+
+  static void OnFinished(WebKitWebResource *resource, gpointer user_data);
+
+  static void OnFailed(WebKitWebResource *resource, GError *error,
+                       gpointer user_data);
+
+  static void OnData(GObject *object, GAsyncResult *result,
+                     gpointer user_data);
+
+  // Copies the current response of |resource| into |entry|.
+  static void ReadResponse(WebKitWebResource *resource, Entry *entry);
+
+  // Moves the entry of |resource| into the ring.
+  void Complete(WebKitWebResource *resource);
+
+  static FlValue *EntryToHar(const Entry &entry);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_NETWORK_RECORDER_H_
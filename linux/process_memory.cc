@@ -0,0 +1,115 @@
+#include "process_memory.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// The web process can sit below two bubblewrap processes.
+constexpr int kMaxAncestorDepth = 4;
+
+// Parses "<key>   <value> kB" lines of smaps_rollup and status.
+bool parse_kb_line(const char *line, const char *key, int64_t *bytes) {
+  auto key_length = strlen(key);
+  if (strncmp(line, key, key_length) != 0 || line[key_length] != ':') {
+    return false;
+  }
+  *bytes = strtoll(line + key_length + 1, nullptr, 10) * 1024;
+  return true;
+}
+
+// Reads the command name and parent of |pid| from /proc/<pid>/stat.
+bool read_stat(pid_t pid, std::string *comm, pid_t *parent) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  auto *file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  char buffer[512];
+  auto length = fread(buffer, 1, sizeof(buffer) - 1, file);
+  fclose(file);
+  buffer[length] = '\0';
+  // The command name is in parentheses and may itself contain them.
+  auto *open = strchr(buffer, '(');
+  auto *close = strrchr(buffer, ')');
+  if (!open || !close || close < open) {
+    return false;
+  }
+  comm->assign(open + 1, close - open - 1);
+  char state;
+  int ppid;
+  if (sscanf(close + 1, " %c %d", &state, &ppid) != 2) {
+    return false;
+  }
+  *parent = ppid;
+  return true;
+}
+
+}  // namespace
+
+bool read_process_memory(pid_t pid, ProcessMemory *memory) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+  auto *file = fopen(path, "r");
+  bool has_pss = file != nullptr;
+  if (!file) {
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    file = fopen(path, "r");
+    if (!file) {
+      return false;
+    }
+  }
+  *memory = ProcessMemory();
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    if (has_pss) {
+      parse_kb_line(line, "Rss", &memory->rss);
+      parse_kb_line(line, "Pss", &memory->pss);
+    } else {
+      parse_kb_line(line, "VmRSS", &memory->rss);
+    }
+  }
+  fclose(file);
+  if (!has_pss) {
+    memory->pss = memory->rss;
+  }
+  return true;
+}
+
+std::vector<pid_t> find_web_processes() {
+  std::vector<pid_t> pids;
+  auto *proc = opendir("/proc");
+  if (!proc) {
+    return pids;
+  }
+  auto self = getpid();
+  std::string comm;
+  while (auto *entry = readdir(proc)) {
+    auto pid = static_cast<pid_t>(atoi(entry->d_name));
+    pid_t parent;
+    if (pid <= 0 || !read_stat(pid, &comm, &parent)) {
+      continue;
+    }
+    // The kernel truncates names to 15 characters.
+    if (comm.compare(0, 15, "WebKitWebProces") != 0) {
+      continue;
+    }
+    for (int depth = 0; depth < kMaxAncestorDepth && parent > 1; ++depth) {
+      if (parent == self) {
+        pids.push_back(pid);
+        break;
+      }
+      if (!read_stat(parent, &comm, &parent)) {
+        break;
+      }
+    }
+  }
+  closedir(proc);
+  return pids;
+}
@@ -0,0 +1,26 @@
+#ifndef WEBVIEW_WINDOW_LINUX_PROCESS_MEMORY_H_
+#define WEBVIEW_WINDOW_LINUX_PROCESS_MEMORY_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <vector>
+
+// Resident memory of a process in bytes. PSS splits pages shared between
+// processes, e.g. the JavaScriptCore and WebKit libraries, across them, so
+// it can be summed over web processes without double counting.
+struct ProcessMemory {
+  int64_t rss = 0;
+  int64_t pss = 0;
+};
+
+// Reads the memory of |pid| from /proc/<pid>/smaps_rollup, falling back to
+// the RSS of /proc/<pid>/status on kernels without it (PSS then equals RSS).
+// Returns false if the process is gone.
+bool read_process_memory(pid_t pid, ProcessMemory *memory);
+
+// Returns the WebKit web processes spawned by this process, including
+// those started through the bubblewrap sandbox.
+std::vector<pid_t> find_web_processes();
+
+#endif  // WEBVIEW_WINDOW_LINUX_PROCESS_MEMORY_H_
@@ -0,0 +1,176 @@
+#include "session_registry.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "disk_cache_limiter.h"
+
+namespace {
+
+struct MemoryProfileSettings {
+  WebKitCacheModel cache_model;
+  bool page_cache;
+  // Web process memory settings, 0 leaves the WebKit default: a limit
+  // derived from the system memory and thresholds of 0.33 and 0.5.
+  int memory_limit_mb;
+  double conservative_threshold;
+  double strict_threshold;
+};
+
+// Indexed by MemoryProfile.
+const MemoryProfileSettings kMemoryProfiles[] = {
+    // kDefault
+    {WEBKIT_CACHE_MODEL_WEB_BROWSER, true, 0, 0, 0},
+    // kDocumentViewer: no resource or page caches, default memory limit.
+    {WEBKIT_CACHE_MODEL_DOCUMENT_VIEWER, false, 0, 0, 0},
+    // kLowMemory: no caches and a web process that starts releasing memory
+    // early under a tight limit.
+    {WEBKIT_CACHE_MODEL_DOCUMENT_VIEWER, false, 256, 0.25, 0.4},
+    // kBrowser: the web process keeps its memory and page caches until it
+    // gets much closer to its limit, so back/forward navigation and
+    // revisited pages stay instant for longer.
+    {WEBKIT_CACHE_MODEL_WEB_BROWSER, true, 0, 0.6, 0.8},
+};
+
+const MemoryProfileSettings &memory_profile_settings(MemoryProfile profile) {
+  return kMemoryProfiles[static_cast<int>(profile)];
+}
+
+}  // namespace
+
+bool memory_profile_uses_page_cache(MemoryProfile profile) {
+  return memory_profile_settings(profile).page_cache;
+}
+
+SessionRegistry::SessionRegistry() = default;
+
+SessionRegistry::~SessionRegistry() {
+  for (auto &item : named_contexts_) {
+    g_object_unref(item.second);
+  }
+  for (auto *context : private_contexts_) {
+    g_object_weak_unref(G_OBJECT(context), OnPrivateContextFinalized, this);
+  }
+}
+
+WebKitWebContext *SessionRegistry::Acquire(const SessionConfig &config) {
+  if (!config.name.empty()) {
+    auto it = named_contexts_.find(config.name);
+    if (it != named_contexts_.end()) {
+      return WEBKIT_WEB_CONTEXT(g_object_ref(it->second));
+    }
+  }
+
+  auto *context = CreateContext(config);
+  if (config.name.empty()) {
+    g_object_weak_ref(G_OBJECT(context), OnPrivateContextFinalized, this);
+    private_contexts_.push_back(context);
+  } else {
+    named_contexts_[config.name] = WEBKIT_WEB_CONTEXT(g_object_ref(context));
+  }
+  for (const auto &initializer : initializers_) {
+    initializer(context);
+  }
+  return context;
+}
+
+void SessionRegistry::AddContextInitializer(ContextCallback callback) {
+  ForEachContext(callback);
+  initializers_.push_back(std::move(callback));
+}
+
+void SessionRegistry::ForEachContext(const ContextCallback &callback) const {
+  callback(webkit_web_context_get_default());
+  for (const auto &item : named_contexts_) {
+    callback(item.second);
+  }
+  for (auto *context : private_contexts_) {
+    callback(context);
+  }
+}
+
+WebKitWebContext *SessionRegistry::CreateContext(const SessionConfig &config) {
+  WebKitWebsiteDataManager *data_manager;
+  if (config.use_default_data) {
+    data_manager = WEBKIT_WEBSITE_DATA_MANAGER(
+        g_object_ref(webkit_web_context_get_website_data_manager(
+            webkit_web_context_get_default())));
+  } else if (config.ephemeral) {
+    data_manager = webkit_website_data_manager_new_ephemeral();
+  } else {
+    data_manager = webkit_website_data_manager_new(
+        "base-data-directory",
+        config.data_directory.empty() ? nullptr
+                                      : config.data_directory.c_str(),
+        "base-cache-directory",
+        config.cache_directory.empty() ? nullptr
+                                       : config.cache_directory.c_str(),
+        nullptr);
+    if (config.disk_cache_limit_mb > 0) {
+      DiskCacheLimiter::Attach(
+          data_manager,
+          static_cast<guint64>(config.disk_cache_limit_mb) * 1024 * 1024);
+    }
+  }
+  const auto &profile = memory_profile_settings(config.memory_profile);
+  auto memory_limit_mb =
+      config.memory_limit_mb > 0 ? config.memory_limit_mb
+                                 : profile.memory_limit_mb;
+  WebKitWebContext *context;
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+  if (memory_limit_mb > 0 || profile.conservative_threshold > 0 ||
+      profile.strict_threshold > 0) {
+    // Memory pressure settings can only be given at construction.
+    auto *pressure_settings = webkit_memory_pressure_settings_new();
+    if (memory_limit_mb > 0) {
+      webkit_memory_pressure_settings_set_memory_limit(
+          pressure_settings, static_cast<guint>(memory_limit_mb));
+    }
+    if (profile.conservative_threshold > 0) {
+      webkit_memory_pressure_settings_set_conservative_threshold(
+          pressure_settings, profile.conservative_threshold);
+    }
+    if (profile.strict_threshold > 0) {
+      webkit_memory_pressure_settings_set_strict_threshold(
+          pressure_settings, profile.strict_threshold);
+    }
+    context = WEBKIT_WEB_CONTEXT(g_object_new(
+        WEBKIT_TYPE_WEB_CONTEXT, "website-data-manager", data_manager,
+        "memory-pressure-settings", pressure_settings, nullptr));
+    webkit_memory_pressure_settings_free(pressure_settings);
+  } else {
+    context = webkit_web_context_new_with_website_data_manager(data_manager);
+  }
+#else
+  context = webkit_web_context_new_with_website_data_manager(data_manager);
+#endif
+  g_object_unref(data_manager);
+  webkit_web_context_set_cache_model(context, profile.cache_model);
+  if (!config.use_default_data && !config.ephemeral &&
+      !config.cookie_storage_path.empty()) {
+    webkit_cookie_manager_set_persistent_storage(
+        webkit_web_context_get_cookie_manager(context),
+        config.cookie_storage_path.c_str(),
+        WEBKIT_COOKIE_PERSISTENT_STORAGE_SQLITE);
+  }
+
+#if !WEBKIT_CHECK_VERSION(2, 26, 0)
+  webkit_web_context_set_process_model(
+      context, WEBKIT_PROCESS_MODEL_MULTIPLE_SECONDARY_PROCESSES);
+  if (config.web_process_count_limit > 0) {
+    webkit_web_context_set_web_process_count_limit(
+        context, static_cast<guint>(config.web_process_count_limit));
+  }
+#endif
+  return context;
+}
+
+void SessionRegistry::OnPrivateContextFinalized(gpointer user_data,
+                                                GObject *where_the_object_was) {
+  auto *registry = static_cast<SessionRegistry *>(user_data);
+  auto &contexts = registry->private_contexts_;
+  contexts.erase(std::remove(contexts.begin(), contexts.end(),
+                             reinterpret_cast<WebKitWebContext *>(
+                                 where_the_object_was)),
+                 contexts.end());
+}
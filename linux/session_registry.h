@@ -0,0 +1,86 @@
+#ifndef WEBVIEW_WINDOW_LINUX_SESSION_REGISTRY_H_
+#define WEBVIEW_WINDOW_LINUX_SESSION_REGISTRY_H_
+
+#include <webkit2/webkit2.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Memory settings of a context, see kMemoryProfiles in session_registry.cc.
+enum class MemoryProfile {
+  kDefault = 0,
+  kDocumentViewer = 1,
+  kLowMemory = 2,
+  kBrowser = 3,
+};
+
+// Whether views of a context with |profile| keep pages in the page cache.
+bool memory_profile_uses_page_cache(MemoryProfile profile);
+
+// Describes the WebKitWebContext a window runs in. Each session has its own
+// website data manager, so cookies, storage, cache, proxy settings and the
+// network process are not shared with other sessions.
+struct SessionConfig {
+  // Windows created with the same name share one session. An empty name
+  // gives the window a session of its own.
+  std::string name;
+  // Keep all website data in memory only.
+  bool ephemeral = false;
+  // Base directories of a persistent session, WebKit defaults when empty.
+  std::string data_directory;
+  std::string cache_directory;
+  // Size limit of the HTTP disk cache of a persistent session, 0 leaves the
+  // size to WebKit. See DiskCacheLimiter.
+  int disk_cache_limit_mb = 0;
+  // SQLite file the cookies of a persistent session are kept in. Cookies
+  // are only kept in memory when empty.
+  std::string cookie_storage_path;
+  // Upper bound on the web processes of the session, 0 for no limit. Only
+  // honored by WebKitGTK releases before 2.26, newer ones always run one
+  // web process per view.
+  int web_process_count_limit = 0;
+  // Share the website data of the default context. Used for windows that
+  // need their own context for memory settings but no separate session.
+  bool use_default_data = false;
+  // Memory settings are fixed when the context is created, so windows
+  // joining an existing named session get the settings of its first window.
+  MemoryProfile memory_profile = MemoryProfile::kDefault;
+  // Overrides the memory limit of the profile, 0 keeps it.
+  int memory_limit_mb = 0;
+};
+
+// Owns every non-default WebKitWebContext used by the plugin.
+class SessionRegistry {
+ public:
+  typedef std::function<void(WebKitWebContext *context)> ContextCallback;
+
+  SessionRegistry();
+
+  ~SessionRegistry();
+
+  // Returns a new reference to the context of |config|. Named sessions are
+  // created on first use and kept until the registry is destroyed; unnamed
+  // ones live as long as their window holds them.
+  WebKitWebContext *Acquire(const SessionConfig &config);
+
+  // Runs |callback| on the default context and every session context, now
+  // and for every context created later.
+  void AddContextInitializer(ContextCallback callback);
+
+  // Runs |callback| on the default context and every live session context.
+  void ForEachContext(const ContextCallback &callback) const;
+
+ private:
+  WebKitWebContext *CreateContext(const SessionConfig &config);
+
+  static void OnPrivateContextFinalized(gpointer user_data,
+                                        GObject *where_the_object_was);
+
+  std::unordered_map<std::string, WebKitWebContext *> named_contexts_;
+  std::vector<WebKitWebContext *> private_contexts_;
+  std::vector<ContextCallback> initializers_;
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_SESSION_REGISTRY_H_
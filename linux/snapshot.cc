@@ -0,0 +1,294 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+gboolean write_png_chunk(void *closure, const unsigned char *data,
+                         unsigned int length) {
+  auto *png = static_cast<std::vector<uint8_t> *>(closure);
+  png->insert(png->end(), data, data + length);
+  return TRUE;
+}
+
+double elapsed_ms(gint64 since) {
+  return (g_get_monotonic_time() - since) / 1000.0;
+}
+
+}  // namespace
+
+FlValue *snapshot_to_fl_value(cairo_surface_t *surface, SnapshotFormat format,
+                              GError **error) {
+  if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE ||
+      cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                "unsupported snapshot surface");
+    return nullptr;
+  }
+  cairo_surface_flush(surface);
+  auto width = cairo_image_surface_get_width(surface);
+  auto height = cairo_image_surface_get_height(surface);
+
+  FlValue *bytes;
+  if (format == SnapshotFormat::kPng) {
+    std::vector<uint8_t> png;
+    png.reserve(static_cast<size_t>(width) * height);
+    if (cairo_surface_write_to_png_stream(surface, write_png_chunk, &png) !=
+        CAIRO_STATUS_SUCCESS) {
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                  "failed to encode snapshot");
+      return nullptr;
+    }
+    bytes = fl_value_new_uint8_list(png.data(), png.size());
+  } else {
+    // ARGB32 is stored as B G R A on little-endian machines; drop the row
+    // padding so Dart gets width * 4 bytes per row.
+    auto *data = cairo_image_surface_get_data(surface);
+    auto stride = cairo_image_surface_get_stride(surface);
+    auto row_size = static_cast<size_t>(width) * 4;
+    if (static_cast<size_t>(stride) == row_size) {
+      bytes = fl_value_new_uint8_list(data, row_size * height);
+    } else {
+      std::vector<uint8_t> pixels(row_size * height);
+      for (int y = 0; y < height; ++y) {
+        memcpy(pixels.data() + y * row_size, data + y * stride, row_size);
+      }
+      bytes = fl_value_new_uint8_list(pixels.data(), pixels.size());
+    }
+  }
+
+  auto *snapshot = fl_value_new_map();
+  fl_value_set_string_take(snapshot, "width", fl_value_new_int(width));
+  fl_value_set_string_take(snapshot, "height", fl_value_new_int(height));
+  fl_value_set_string_take(
+      snapshot, "format",
+      fl_value_new_string(format == SnapshotFormat::kPng ? "png" : "bgra"));
+  fl_value_set_string_take(snapshot, "bytes", bytes);
+  return snapshot;
+}
+
+struct SnapshotQueue::Worker {
+  SnapshotQueue *queue;
+  GtkWidget *window;
+  WebKitWebView *web_view;
+  size_t job;
+  gint64 job_start_time;
+  gint64 snapshot_start_time;
+  guint timeout_source;
+  // Set when the job's load started. Loading the next URL cancels a timed
+  // out load, whose late signals arrive before this is set again.
+  bool started;
+  // Set once the job's page finished, failed or timed out.
+  bool loaded;
+  // Cancelled when the job times out, snapshots still in flight for it are
+  // dropped.
+  GCancellable *cancellable;
+};
+
+namespace {
+
+struct SnapshotRequest {
+  void *worker;
+  GCancellable *cancellable;
+};
+
+}  // namespace
+
+void SnapshotQueue::Run(WebKitWebContext *context,
+                        std::vector<std::string> urls, int parallelism,
+                        const SnapshotJobOptions &options,
+                        DoneCallback callback) {
+  auto *queue = new SnapshotQueue(std::move(urls), options, std::move(callback));
+  if (queue->urls_.empty()) {
+    delete queue;
+    return;
+  }
+  auto workers = static_cast<size_t>(MAX(parallelism, 1));
+  workers = MIN(workers, queue->urls_.size());
+  for (size_t i = 0; i < workers; ++i) {
+    auto *worker = new Worker();
+    worker->queue = queue;
+    // An offscreen window renders like a mapped one without being shown.
+    worker->window = gtk_offscreen_window_new();
+    worker->web_view = WEBKIT_WEB_VIEW(
+        g_object_new(WEBKIT_TYPE_WEB_VIEW, "web-context",
+                     context ? context : webkit_web_context_get_default(),
+                     nullptr));
+    gtk_widget_set_size_request(GTK_WIDGET(worker->web_view), options.width,
+                                options.height);
+    gtk_container_add(GTK_CONTAINER(worker->window),
+                      GTK_WIDGET(worker->web_view));
+    gtk_widget_show_all(worker->window);
+    g_signal_connect(worker->web_view, "load-changed",
+                     G_CALLBACK(OnLoadChanged), worker);
+    g_signal_connect(worker->web_view, "load-failed",
+                     G_CALLBACK(OnLoadFailed), worker);
+    worker->cancellable = g_cancellable_new();
+    queue->workers_.push_back(worker);
+  }
+  // Copy the list, a worker may finish the queue synchronously.
+  auto started = queue->workers_;
+  for (auto *worker : started) {
+    queue->StartNextJob(worker);
+  }
+}
+
+SnapshotQueue::SnapshotQueue(std::vector<std::string> urls,
+                             const SnapshotJobOptions &options,
+                             DoneCallback callback)
+    : urls_(std::move(urls)),
+      options_(options),
+      callback_(std::move(callback)),
+      start_time_(g_get_monotonic_time()),
+      results_(urls_.size(), nullptr) {}
+
+SnapshotQueue::~SnapshotQueue() {
+  auto *results = fl_value_new_list();
+  for (auto *result : results_) {
+    fl_value_append_take(results, result ? result : fl_value_new_null());
+  }
+  callback_(results);
+  fl_value_unref(results);
+}
+
+void SnapshotQueue::StartNextJob(Worker *worker) {
+  if (next_job_ == urls_.size()) {
+    g_signal_handlers_disconnect_by_data(worker->web_view, worker);
+    g_object_unref(worker->cancellable);
+    gtk_widget_destroy(worker->window);
+    workers_.erase(std::find(workers_.begin(), workers_.end(), worker));
+    delete worker;
+    if (workers_.empty()) {
+      delete this;
+    }
+    return;
+  }
+  worker->job = next_job_++;
+  worker->job_start_time = g_get_monotonic_time();
+  worker->started = false;
+  worker->loaded = false;
+  if (options_.timeout_ms > 0) {
+    worker->timeout_source =
+        g_timeout_add(options_.timeout_ms, OnTimeout, worker);
+  }
+  webkit_web_view_load_uri(worker->web_view, urls_[worker->job].c_str());
+}
+
+void SnapshotQueue::FinishJob(Worker *worker, FlValue *result) {
+  if (worker->timeout_source) {
+    g_source_remove(worker->timeout_source);
+    worker->timeout_source = 0;
+  }
+  fl_value_set_string_take(result, "url",
+                           fl_value_new_string(urls_[worker->job].c_str()));
+  fl_value_set_string_take(
+      result, "totalMs", fl_value_new_float(elapsed_ms(worker->job_start_time)));
+  results_[worker->job] = result;
+  StartNextJob(worker);
+}
+
+void SnapshotQueue::OnLoadChanged(WebKitWebView *web_view,
+                                  WebKitLoadEvent event, gpointer user_data) {
+  auto *worker = static_cast<Worker *>(user_data);
+  if (event == WEBKIT_LOAD_STARTED) {
+    worker->started = true;
+    return;
+  }
+  if (event != WEBKIT_LOAD_FINISHED || !worker->started || worker->loaded) {
+    return;
+  }
+  worker->loaded = true;
+  if (!worker->queue->options_.snapshot) {
+    auto *result = fl_value_new_map();
+    fl_value_set_string_take(
+        result, "loadMs",
+        fl_value_new_float(elapsed_ms(worker->job_start_time)));
+    worker->queue->FinishJob(worker, result);
+    return;
+  }
+  worker->snapshot_start_time = g_get_monotonic_time();
+  webkit_web_view_get_snapshot(
+      web_view, worker->queue->options_.region, WEBKIT_SNAPSHOT_OPTIONS_NONE,
+      worker->cancellable, OnSnapshotReady,
+      new SnapshotRequest{worker,
+                          G_CANCELLABLE(g_object_ref(worker->cancellable))});
+}
+
+gboolean SnapshotQueue::OnLoadFailed(WebKitWebView *web_view,
+                                     WebKitLoadEvent event,
+                                     gchar *failing_uri, GError *error,
+                                     gpointer user_data) {
+  auto *worker = static_cast<Worker *>(user_data);
+  if (!worker->started || worker->loaded ||
+      g_error_matches(error, WEBKIT_NETWORK_ERROR,
+                      WEBKIT_NETWORK_ERROR_CANCELLED)) {
+    return FALSE;
+  }
+  // load-changed still reports WEBKIT_LOAD_FINISHED after a failure.
+  worker->loaded = true;
+  auto *result = fl_value_new_map();
+  fl_value_set_string_take(result, "error",
+                           fl_value_new_string(error->message));
+  fl_value_set_string_take(
+      result, "loadMs", fl_value_new_float(elapsed_ms(worker->job_start_time)));
+  worker->queue->FinishJob(worker, result);
+  return FALSE;
+}
+
+gboolean SnapshotQueue::OnTimeout(gpointer user_data) {
+  auto *worker = static_cast<Worker *>(user_data);
+  worker->timeout_source = 0;
+  worker->loaded = true;
+  g_cancellable_cancel(worker->cancellable);
+  g_object_unref(worker->cancellable);
+  worker->cancellable = g_cancellable_new();
+  auto *result = fl_value_new_map();
+  fl_value_set_string_take(result, "error", fl_value_new_string("timeout"));
+  fl_value_set_string_take(
+      result, "loadMs", fl_value_new_float(elapsed_ms(worker->job_start_time)));
+  // Loading the next URL cancels the slow load, destroying the view after
+  // the last job stops it.
+  worker->queue->FinishJob(worker, result);
+  return G_SOURCE_REMOVE;
+}
+
+void SnapshotQueue::OnSnapshotReady(GObject *object, GAsyncResult *result,
+                                    gpointer user_data) {
+  auto *request = static_cast<SnapshotRequest *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  auto *surface = webkit_web_view_get_snapshot_finish(WEBKIT_WEB_VIEW(object),
+                                                      result, &error);
+  auto cancelled = g_cancellable_is_cancelled(request->cancellable);
+  auto *worker = static_cast<Worker *>(request->worker);
+  g_object_unref(request->cancellable);
+  delete request;
+  if (cancelled) {
+    // The job timed out, |worker| may run another job or be gone.
+    if (surface) {
+      cairo_surface_destroy(surface);
+    }
+    return;
+  }
+  FlValue *job_result = nullptr;
+  if (surface) {
+    job_result = snapshot_to_fl_value(surface, worker->queue->options_.format,
+                                      &error);
+    cairo_surface_destroy(surface);
+  }
+  if (!job_result) {
+    job_result = fl_value_new_map();
+    fl_value_set_string_take(
+        job_result, "error",
+        fl_value_new_string(error ? error->message : "snapshot failed"));
+  }
+  fl_value_set_string_take(
+      job_result, "loadMs",
+      fl_value_new_float((worker->snapshot_start_time -
+                          worker->job_start_time) / 1000.0));
+  fl_value_set_string_take(
+      job_result, "snapshotMs",
+      fl_value_new_float(elapsed_ms(worker->snapshot_start_time)));
+  worker->queue->FinishJob(worker, job_result);
+}
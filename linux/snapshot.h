@@ -0,0 +1,84 @@
+#ifndef WEBVIEW_WINDOW_LINUX_SNAPSHOT_H_
+#define WEBVIEW_WINDOW_LINUX_SNAPSHOT_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+#include <webkit2/webkit2.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class SnapshotFormat {
+  // Premultiplied 32-bit pixels, B G R A in memory, rows packed tightly.
+  kBgra = 0,
+  kPng = 1,
+};
+
+// Returns {"width", "height", "format", "bytes"} for |surface|, or null and
+// |error| if it can not be encoded.
+FlValue *snapshot_to_fl_value(cairo_surface_t *surface, SnapshotFormat format,
+                              GError **error);
+
+struct SnapshotJobOptions {
+  int width = 1280;
+  int height = 720;
+  WebKitSnapshotRegion region = WEBKIT_SNAPSHOT_REGION_VISIBLE;
+  SnapshotFormat format = SnapshotFormat::kPng;
+  // Jobs whose page does not finish loading in time fail, 0 waits forever.
+  int timeout_ms = 30000;
+  // Only load the pages, e.g. to warm the cache, without snapshots.
+  bool snapshot = true;
+};
+
+// Loads a list of URLs in hidden offscreen web views, |parallelism| at a
+// time, and snapshots each page once it finished loading.
+//
+// The web views are internal to the queue and send no events to Dart. The
+// queue deletes itself after running |callback| with one map per URL, in
+// list order: the snapshot fields of snapshot_to_fl_value() or "error",
+// plus "url", "loadMs", "snapshotMs" and "totalMs". Without snapshots,
+// "snapshotMs" and the snapshot fields are left out.
+class SnapshotQueue {
+ public:
+  typedef std::function<void(FlValue *results)> DoneCallback;
+
+  static void Run(WebKitWebContext *context, std::vector<std::string> urls,
+                  int parallelism, const SnapshotJobOptions &options,
+                  DoneCallback callback);
+
+ private:
+  struct Worker;
+
+  SnapshotQueue(std::vector<std::string> urls,
+                const SnapshotJobOptions &options, DoneCallback callback);
+
+  ~SnapshotQueue();
+
+  std::vector<std::string> urls_;
+  SnapshotJobOptions options_;
+  DoneCallback callback_;
+  gint64 start_time_;
+  std::vector<FlValue *> results_;
+  size_t next_job_ = 0;
+  std::vector<Worker *> workers_;
+
+  // Starts the next job on |worker|, or parks it when none is left.
+  void StartNextJob(Worker *worker);
+
+  void FinishJob(Worker *worker, FlValue *result);
+
+  static void OnLoadChanged(WebKitWebView *web_view, WebKitLoadEvent event,
+                            gpointer user_data);
+
+  static gboolean OnLoadFailed(WebKitWebView *web_view,
+                               WebKitLoadEvent event, gchar *failing_uri,
+                               GError *error, gpointer user_data);
+
+  static gboolean OnTimeout(gpointer user_data);
+
+  static void OnSnapshotReady(GObject *object, GAsyncResult *result,
+                              gpointer user_data);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_SNAPSHOT_H_
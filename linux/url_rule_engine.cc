@@ -0,0 +1,197 @@
+#include "url_rule_engine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+std::string to_lower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(), [](char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  });
+  return text;
+}
+
+// Splits |host| into labels, last label first.
+std::vector<std::string> reversed_labels(const std::string &host) {
+  std::vector<std::string> labels;
+  size_t end = host.size();
+  while (end > 0) {
+    auto dot = host.rfind('.', end - 1);
+    auto begin = dot == std::string::npos ? 0 : dot + 1;
+    if (end > begin) {
+      labels.push_back(host.substr(begin, end - begin));
+    }
+    if (dot == std::string::npos) {
+      break;
+    }
+    end = dot;
+  }
+  return labels;
+}
+
+}  // namespace
+
+UrlRuleEngine::UrlRuleEngine(const std::vector<UrlRule> &rules,
+                             UrlRuleAction default_action)
+    : default_action_(default_action), host_nodes_(1) {
+  actions_.reserve(rules.size());
+  for (const auto &rule : rules) {
+    auto index = actions_.size();
+    actions_.push_back(rule.action);
+    switch (rule.type) {
+      case UrlRuleType::kHost: {
+        if (rule.pattern.empty()) {
+          break;
+        }
+        // "*.example.com" and ".example.com" mean the same as
+        // "example.com", and "*" lands on the root.
+        auto host = to_lower(rule.pattern);
+        auto start = host.find_first_not_of("*.");
+        AddHost(start == std::string::npos ? std::string() : host.substr(start),
+                index);
+        has_host_rules_ = true;
+        break;
+      }
+      case UrlRuleType::kPrefix:
+        // Earlier rules win.
+        if (prefixes_.insert({rule.pattern, index}).second) {
+          prefix_lengths_.push_back(rule.pattern.size());
+        }
+        break;
+      case UrlRuleType::kGlob:
+        globs_.push_back({rule.pattern, index});
+        break;
+    }
+  }
+  std::sort(prefix_lengths_.begin(), prefix_lengths_.end());
+  prefix_lengths_.erase(
+      std::unique(prefix_lengths_.begin(), prefix_lengths_.end()),
+      prefix_lengths_.end());
+}
+
+UrlRuleAction UrlRuleEngine::Evaluate(const char *url) const {
+  if (!url) {
+    return default_action_;
+  }
+  auto best = kNoRule;
+  if (has_host_rules_) {
+    best = std::min(best, MatchHost(HostOf(url)));
+  }
+  if (!prefixes_.empty()) {
+    auto length = strlen(url);
+    std::string candidate;
+    for (auto prefix_length : prefix_lengths_) {
+      if (prefix_length > length) {
+        break;
+      }
+      candidate.assign(url, prefix_length);
+      auto it = prefixes_.find(candidate);
+      if (it != prefixes_.end()) {
+        best = std::min(best, it->second);
+      }
+    }
+  }
+  for (const auto &glob : globs_) {
+    // Globs are in rule order, later ones can not beat an earlier match.
+    if (glob.rule > best) {
+      break;
+    }
+    if (GlobMatches(glob.pattern.c_str(), url)) {
+      best = glob.rule;
+      break;
+    }
+  }
+  return best == kNoRule ? default_action_ : actions_[best];
+}
+
+std::string UrlRuleEngine::HostOf(const char *url) {
+  auto *scheme_end = strstr(url, "://");
+  if (!scheme_end) {
+    return std::string();
+  }
+  auto *begin = scheme_end + 3;
+  auto *end = begin + strcspn(begin, "/?#");
+  // Drop user info.
+  for (auto *at = end; at > begin; --at) {
+    if (at[-1] == '@') {
+      begin = at;
+      break;
+    }
+  }
+  if (begin < end && *begin == '[') {
+    // IPv6 literal.
+    auto *close = static_cast<const char *>(memchr(begin, ']', end - begin));
+    return close ? to_lower(std::string(begin + 1, close)) : std::string();
+  }
+  auto *colon = static_cast<const char *>(memchr(begin, ':', end - begin));
+  if (colon) {
+    end = colon;
+  }
+  // A trailing dot names the same host.
+  if (end > begin && end[-1] == '.') {
+    end--;
+  }
+  return to_lower(std::string(begin, end));
+}
+
+void UrlRuleEngine::AddHost(const std::string &host, size_t rule) {
+  size_t node = 0;
+  for (const auto &label : reversed_labels(host)) {
+    auto it = host_nodes_[node].children.find(label);
+    if (it != host_nodes_[node].children.end()) {
+      node = it->second;
+      continue;
+    }
+    auto child = host_nodes_.size();
+    // Insert before push_back, which may move the nodes.
+    host_nodes_[node].children[label] = child;
+    host_nodes_.emplace_back();
+    node = child;
+  }
+  host_nodes_[node].rule = std::min(host_nodes_[node].rule, rule);
+}
+
+size_t UrlRuleEngine::MatchHost(const std::string &host) const {
+  if (host.empty()) {
+    return kNoRule;
+  }
+  // Every node on the path is a suffix of the host on a label boundary.
+  auto best = host_nodes_[0].rule;
+  size_t node = 0;
+  for (const auto &label : reversed_labels(host)) {
+    auto it = host_nodes_[node].children.find(label);
+    if (it == host_nodes_[node].children.end()) {
+      break;
+    }
+    node = it->second;
+    best = std::min(best, host_nodes_[node].rule);
+  }
+  return best;
+}
+
+bool UrlRuleEngine::GlobMatches(const char *pattern, const char *text) {
+  // Iterative matching with backtracking to the last '*', linear for
+  // patterns with a single star.
+  const char *star = nullptr;
+  const char *resume = nullptr;
+  while (*text) {
+    if (*pattern == '*') {
+      star = pattern++;
+      resume = text;
+    } else if (*pattern == '?' || *pattern == *text) {
+      pattern++;
+      text++;
+    } else if (star) {
+      pattern = star + 1;
+      text = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*') {
+    pattern++;
+  }
+  return *pattern == '\0';
+}
@@ -0,0 +1,84 @@
+#ifndef WEBVIEW_WINDOW_LINUX_URL_RULE_ENGINE_H_
+#define WEBVIEW_WINDOW_LINUX_URL_RULE_ENGINE_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class UrlRuleAction {
+  kAllow = 0,
+  kBlock = 1,
+  // Let the onUrlRequested callback in Dart decide.
+  kAsk = 2,
+};
+
+enum class UrlRuleType {
+  // Matches the host and all its subdomains, "example.com" matches
+  // example.com and www.example.com but not badexample.com. "*" matches
+  // every host, an empty pattern none.
+  kHost = 0,
+  // Matches URLs starting with the pattern.
+  kPrefix = 1,
+  // Matches the whole URL, '*' matches any run of characters and '?' a
+  // single one.
+  kGlob = 2,
+};
+
+struct UrlRule {
+  UrlRuleType type;
+  std::string pattern;
+  UrlRuleAction action;
+};
+
+// Decides navigations against a list of rules. The first rule in list order
+// that matches a URL wins, URLs no rule matches get the default action.
+//
+// Host rules are kept in a trie of reversed host labels and prefix rules in
+// a hash map per prefix length, so a lookup costs one walk of the host and
+// one hash per distinct prefix length. Only glob rules are tried one by one.
+class UrlRuleEngine {
+ public:
+  UrlRuleEngine(const std::vector<UrlRule> &rules,
+                UrlRuleAction default_action);
+
+  UrlRuleAction Evaluate(const char *url) const;
+
+  UrlRuleAction default_action() const { return default_action_; }
+
+  // Returns the lowercase host of |url|, or an empty string if it has none.
+  static std::string HostOf(const char *url);
+
+ private:
+  static constexpr size_t kNoRule = static_cast<size_t>(-1);
+
+  struct HostNode {
+    std::unordered_map<std::string, size_t> children;
+    size_t rule = kNoRule;
+  };
+
+  struct Glob {
+    std::string pattern;
+    size_t rule;
+  };
+
+  std::vector<UrlRuleAction> actions_;
+  UrlRuleAction default_action_;
+
+  // Node 0 is the root, its children are top level domains. A rule on the
+  // root matches every host.
+  std::vector<HostNode> host_nodes_;
+  bool has_host_rules_ = false;
+  std::unordered_map<std::string, size_t> prefixes_;
+  // Distinct prefix lengths, ascending.
+  std::vector<size_t> prefix_lengths_;
+  std::vector<Glob> globs_;
+
+  void AddHost(const std::string &host, size_t rule);
+
+  size_t MatchHost(const std::string &host) const;
+
+  static bool GlobMatches(const char *pattern, const char *text);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_URL_RULE_ENGINE_H_
@@ -0,0 +1,82 @@
+#include "user_script_registry.h"
+
+UserScriptRegistry::~UserScriptRegistry() {
+  for (auto &item : entries_) {
+    webkit_user_script_unref(item.second.script);
+  }
+}
+
+WebKitUserScript *UserScriptRegistry::Acquire(const UserScript &script) {
+  auto start_time = g_get_monotonic_time();
+  g_autofree gchar *checksum = g_compute_checksum_for_data(
+      G_CHECKSUM_SHA256,
+      reinterpret_cast<const guchar *>(script.source.data()),
+      script.source.size());
+  std::string key(checksum);
+  key += script.injection_time == 0 ? ":start" : ":end";
+  key += script.for_all_frames ? ":all" : ":top";
+
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    it->second.references++;
+    hits_++;
+    hit_time_us_ += g_get_monotonic_time() - start_time;
+    return it->second.script;
+  }
+
+  auto *user_script = webkit_user_script_new(
+      script.source.c_str(),
+      script.for_all_frames ? WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES
+                            : WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+      script.injection_time == 0 ? WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START
+                                 : WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END,
+      nullptr, nullptr);
+  entries_[key] = {user_script, script.source.size(), 1};
+  keys_[user_script] = key;
+  misses_++;
+  miss_time_us_ += g_get_monotonic_time() - start_time;
+  return user_script;
+}
+
+void UserScriptRegistry::Release(WebKitUserScript *script) {
+  auto key = keys_.find(script);
+  if (key == keys_.end()) {
+    return;
+  }
+  auto entry = entries_.find(key->second);
+  if (--entry->second.references > 0) {
+    return;
+  }
+  webkit_user_script_unref(entry->second.script);
+  entries_.erase(entry);
+  keys_.erase(key);
+}
+
+FlValue *UserScriptRegistry::GetStats() const {
+  int64_t references = 0;
+  int64_t source_bytes = 0;
+  int64_t saved_bytes = 0;
+  for (const auto &item : entries_) {
+    const auto &entry = item.second;
+    references += entry.references;
+    source_bytes += entry.source_size;
+    saved_bytes += (entry.references - 1) * entry.source_size;
+  }
+  // Creating a script costs what a miss costs on average, a hit only the
+  // hash and lookup.
+  auto saved_time_us =
+      misses_ > 0 ? hits_ * miss_time_us_ / misses_ - hit_time_us_ : 0;
+
+  auto *stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "scripts",
+                           fl_value_new_int(entries_.size()));
+  fl_value_set_string_take(stats, "references", fl_value_new_int(references));
+  fl_value_set_string_take(stats, "sourceBytes",
+                           fl_value_new_int(source_bytes));
+  fl_value_set_string_take(stats, "savedBytes", fl_value_new_int(saved_bytes));
+  fl_value_set_string_take(stats, "hits", fl_value_new_int(hits_));
+  fl_value_set_string_take(stats, "misses", fl_value_new_int(misses_));
+  fl_value_set_string_take(stats, "savedTimeUs",
+                           fl_value_new_int(MAX(saved_time_us, 0)));
+  return stats;
+}
@@ -0,0 +1,54 @@
+#ifndef WEBVIEW_WINDOW_LINUX_USER_SCRIPT_REGISTRY_H_
+#define WEBVIEW_WINDOW_LINUX_USER_SCRIPT_REGISTRY_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+struct UserScript {
+  std::string source;
+  int injection_time;
+  bool for_all_frames;
+};
+
+// Shares one WebKitUserScript between all windows that inject the same
+// source with the same options, keyed by a SHA-256 of the source.
+class UserScriptRegistry {
+ public:
+  UserScriptRegistry() = default;
+
+  ~UserScriptRegistry();
+
+  UserScriptRegistry(const UserScriptRegistry &) = delete;
+  UserScriptRegistry &operator=(const UserScriptRegistry &) = delete;
+
+  // Returns the shared script for |script|. The caller must Release() it.
+  WebKitUserScript *Acquire(const UserScript &script);
+
+  void Release(WebKitUserScript *script);
+
+  // Returns the number of scripts and the memory and creation time sharing
+  // saved.
+  FlValue *GetStats() const;
+
+ private:
+  struct Entry {
+    WebKitUserScript *script;
+    size_t source_size;
+    int64_t references;
+  };
+
+  std::unordered_map<std::string, Entry> entries_;
+  std::unordered_map<WebKitUserScript *, std::string> keys_;
+
+  int64_t hits_ = 0;
+  int64_t misses_ = 0;
+  // Time spent in Acquire(), split by whether a script was created.
+  int64_t hit_time_us_ = 0;
+  int64_t miss_time_us_ = 0;
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_USER_SCRIPT_REGISTRY_H_
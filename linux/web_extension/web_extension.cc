@@ -0,0 +1,177 @@
+// Web extension loaded into every web process of the plugin's contexts.
+// Answers DOM queries of the plugin straight from the web process and
+// tells the plugin which process renders a view.
+
+#include <unistd.h>
+#include <webkit2/webkit-web-extension.h>
+
+#include "web_extension_protocol.h"
+
+namespace {
+
+// Queries run in a world of their own, so page scripts that replace DOM
+// methods can not change the results.
+WebKitScriptWorld *query_world = nullptr;
+
+// Returns the string |property| of |object|, or an empty string.
+gchar *get_string_property(JSCValue *object, const char *property) {
+  g_autoptr(JSCValue) value = jsc_value_object_get_property(object, property);
+  if (jsc_value_is_null(value) || jsc_value_is_undefined(value)) {
+    return g_strdup("");
+  }
+  return jsc_value_to_string(value);
+}
+
+void add_attribute(GVariantBuilder *attributes, JSCValue *element,
+                   const char *name) {
+  g_autoptr(JSCValue) value = jsc_value_object_invoke_method(
+      element, "getAttribute", G_TYPE_STRING, name, G_TYPE_NONE);
+  if (!jsc_value_is_string(value)) {
+    return;
+  }
+  g_autofree gchar *text = jsc_value_to_string(value);
+  g_variant_builder_add(attributes, "{ss}", name, text);
+}
+
+GVariant *element_to_variant(JSCValue *element, guint32 fields,
+                             const gchar *const *attribute_names) {
+  g_autofree gchar *tag = get_string_property(element, "tagName");
+  g_autofree gchar *text = fields & kDomQueryText
+                               ? get_string_property(element, "textContent")
+                               : g_strdup("");
+  g_autofree gchar *html = fields & kDomQueryHtml
+                               ? get_string_property(element, "outerHTML")
+                               : g_strdup("");
+
+  GVariantBuilder attributes;
+  g_variant_builder_init(&attributes, G_VARIANT_TYPE("a{ss}"));
+  if (fields & kDomQueryAttributes) {
+    if (attribute_names && attribute_names[0]) {
+      for (auto *name = attribute_names; *name; ++name) {
+        add_attribute(&attributes, element, *name);
+      }
+    } else {
+      g_autoptr(JSCValue) names = jsc_value_object_invoke_method(
+          element, "getAttributeNames", G_TYPE_NONE);
+      g_autoptr(JSCValue) length =
+          jsc_value_object_get_property(names, "length");
+      auto count = jsc_value_to_int32(length);
+      for (gint32 i = 0; i < count; ++i) {
+        g_autoptr(JSCValue) name =
+            jsc_value_object_get_property_at_index(names, i);
+        g_autofree gchar *name_text = jsc_value_to_string(name);
+        add_attribute(&attributes, element, name_text);
+      }
+    }
+  }
+
+  double bounds[4] = {0, 0, 0, 0};
+  if (fields & kDomQueryBounds) {
+    g_autoptr(JSCValue) rect = jsc_value_object_invoke_method(
+        element, "getBoundingClientRect", G_TYPE_NONE);
+    const char *properties[] = {"x", "y", "width", "height"};
+    for (int i = 0; i < 4; ++i) {
+      g_autoptr(JSCValue) value =
+          jsc_value_object_get_property(rect, properties[i]);
+      bounds[i] = jsc_value_to_double(value);
+    }
+  }
+  return g_variant_new("(ssa{ss}(dddd)s)", tag, text, &attributes, bounds[0],
+                       bounds[1], bounds[2], bounds[3], html);
+}
+
+// Returns the elements of the main frame matching |selector|, or null and
+// |error| if the selector is invalid.
+GVariant *query_dom(WebKitWebPage *page, const char *selector, guint32 fields,
+                    guint32 limit, const gchar *const *attribute_names,
+                    GError **error) {
+  auto *frame = webkit_web_page_get_main_frame(page);
+  g_autoptr(JSCContext) context =
+      webkit_frame_get_js_context_for_script_world(frame, query_world);
+  g_autoptr(JSCValue) document = jsc_context_get_value(context, "document");
+  g_autoptr(JSCValue) elements = jsc_value_object_invoke_method(
+      document, "querySelectorAll", G_TYPE_STRING, selector, G_TYPE_NONE);
+  if (auto *exception = jsc_context_get_exception(context)) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                        jsc_exception_get_message(exception));
+    jsc_context_clear_exception(context);
+    return nullptr;
+  }
+
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE(DOM_QUERY_REPLY_TYPE));
+  g_autoptr(JSCValue) length =
+      jsc_value_object_get_property(elements, "length");
+  auto count = static_cast<guint32>(jsc_value_to_int32(length));
+  if (limit > 0 && limit < count) {
+    count = limit;
+  }
+  for (guint32 i = 0; i < count; ++i) {
+    g_autoptr(JSCValue) element =
+        jsc_value_object_get_property_at_index(elements, i);
+    g_variant_builder_add_value(
+        &builder, element_to_variant(element, fields, attribute_names));
+  }
+  return g_variant_builder_end(&builder);
+}
+
+void reply_error(WebKitUserMessage *message, const char *error) {
+  webkit_user_message_send_reply(
+      message,
+      webkit_user_message_new(ERROR_MESSAGE, g_variant_new(ERROR_TYPE, error)));
+}
+
+gboolean on_user_message_received(WebKitWebPage *page,
+                                  WebKitUserMessage *message,
+                                  gpointer user_data) {
+  if (g_strcmp0(webkit_user_message_get_name(message), DOM_QUERY_MESSAGE) !=
+      0) {
+    return FALSE;
+  }
+  auto *parameters = webkit_user_message_get_parameters(message);
+  if (parameters == nullptr ||
+      !g_variant_is_of_type(parameters, G_VARIANT_TYPE(DOM_QUERY_TYPE))) {
+    reply_error(message, "malformed DOM query");
+    return TRUE;
+  }
+  const gchar *selector;
+  guint32 fields;
+  guint32 limit;
+  g_autofree const gchar **attribute_names = nullptr;
+  g_variant_get(parameters, "(&suu^a&s)", &selector, &fields, &limit,
+                &attribute_names);
+
+  g_autoptr(GError) error = nullptr;
+  auto *elements =
+      query_dom(page, selector, fields, limit, attribute_names, &error);
+  if (elements == nullptr) {
+    reply_error(message, error->message);
+    return TRUE;
+  }
+  webkit_user_message_send_reply(
+      message, webkit_user_message_new(DOM_QUERY_MESSAGE, elements));
+  return TRUE;
+}
+
+void on_page_created(WebKitWebExtension *extension, WebKitWebPage *page,
+                     gpointer user_data) {
+  g_signal_connect(page, "user-message-received",
+                   G_CALLBACK(on_user_message_received), nullptr);
+  // Process swaps on navigation create a new page, so the plugin learns
+  // about every process that renders the view.
+  webkit_web_page_send_message_to_view(
+      page,
+      webkit_user_message_new(
+          PAGE_CREATED_MESSAGE,
+          g_variant_new(PAGE_CREATED_TYPE, static_cast<guint32>(getpid()))),
+      nullptr, nullptr, nullptr);
+}
+
+}  // namespace
+
+extern "C" G_MODULE_EXPORT void webkit_web_extension_initialize(
+    WebKitWebExtension *extension) {
+  query_world = webkit_script_world_new();
+  g_signal_connect(extension, "page-created", G_CALLBACK(on_page_created),
+                   nullptr);
+}
@@ -0,0 +1,37 @@
+#ifndef WEBVIEW_WINDOW_LINUX_WEB_EXTENSION_WEB_EXTENSION_PROTOCOL_H_
+#define WEBVIEW_WINDOW_LINUX_WEB_EXTENSION_WEB_EXTENSION_PROTOCOL_H_
+
+// Messages exchanged between the plugin and the web extension loaded into
+// every web process, see web_extension.cc.
+
+// Directory next to the plugin library the extension is installed in.
+// Must match the install rule in CMakeLists.txt.
+#define WEB_EXTENSIONS_DIRECTORY_NAME "desktop_webview_window_web_extensions"
+
+// Sent by the extension to the view when a page is created, with the pid
+// of the web process.
+#define PAGE_CREATED_MESSAGE "desktopWebviewWindow.pageCreated"
+#define PAGE_CREATED_TYPE "(u)"
+
+// Query of the plugin: CSS selector, DomQueryField bits and the maximum
+// number of elements (0 for all). A non-empty attribute list limits the
+// attributes read.
+#define DOM_QUERY_MESSAGE "desktopWebviewWindow.domQuery"
+#define DOM_QUERY_TYPE "(suuas)"
+// Reply: per element its tag name, text content, attributes, bounding
+// client rect (x, y, width, height) and outer HTML. Fields not asked for
+// are empty.
+#define DOM_QUERY_REPLY_TYPE "a(ssa{ss}(dddd)s)"
+
+// Reply to a query that failed, with the error message.
+#define ERROR_MESSAGE "desktopWebviewWindow.error"
+#define ERROR_TYPE "(s)"
+
+enum DomQueryField {
+  kDomQueryText = 1 << 0,
+  kDomQueryAttributes = 1 << 1,
+  kDomQueryBounds = 1 << 2,
+  kDomQueryHtml = 1 << 3,
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_WEB_EXTENSION_WEB_EXTENSION_PROTOCOL_H_
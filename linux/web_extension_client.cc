@@ -0,0 +1,154 @@
+#include "web_extension_client.h"
+
+#include <dlfcn.h>
+
+#include "web_extension/web_extension_protocol.h"
+
+namespace {
+
+// The extension is installed next to the plugin library, wherever the
+// application bundle is.
+const std::string &web_extensions_directory() {
+  static const std::string directory = [] {
+    Dl_info info;
+    if (!dladdr(reinterpret_cast<void *>(&web_extension_client_attach),
+                &info) ||
+        info.dli_fname == nullptr) {
+      return std::string();
+    }
+    g_autofree gchar *library_directory = g_path_get_dirname(info.dli_fname);
+    g_autofree gchar *path = g_build_filename(
+        library_directory, WEB_EXTENSIONS_DIRECTORY_NAME, nullptr);
+    return std::string(path);
+  }();
+  return directory;
+}
+
+void on_initialize_web_extensions(WebKitWebContext *context,
+                                  gpointer user_data) {
+  const auto &directory = web_extensions_directory();
+  if (!directory.empty()) {
+    webkit_web_context_set_web_extensions_directory(context,
+                                                    directory.c_str());
+  }
+}
+
+#if WEBKIT_CHECK_VERSION(2, 28, 0)
+struct DomQueryRequest {
+  FlMethodCall *call;
+  guint32 fields;
+};
+
+FlValue *element_to_fl_value(GVariant *element, guint32 fields) {
+  const gchar *tag;
+  const gchar *text;
+  GVariantIter *attributes;
+  double x, y, width, height;
+  const gchar *html;
+  g_variant_get(element, "(&s&sa{ss}(dddd)&s)", &tag, &text, &attributes, &x,
+                &y, &width, &height, &html);
+
+  auto *value = fl_value_new_map();
+  fl_value_set_string_take(value, "tag", fl_value_new_string(tag));
+  if (fields & kDomQueryText) {
+    fl_value_set_string_take(value, "text", fl_value_new_string(text));
+  }
+  if (fields & kDomQueryAttributes) {
+    auto *attribute_map = fl_value_new_map();
+    const gchar *name;
+    const gchar *attribute_value;
+    while (g_variant_iter_next(attributes, "{&s&s}", &name,
+                               &attribute_value)) {
+      fl_value_set_string_take(attribute_map, name,
+                               fl_value_new_string(attribute_value));
+    }
+    fl_value_set_string_take(value, "attributes", attribute_map);
+  }
+  g_variant_iter_free(attributes);
+  if (fields & kDomQueryBounds) {
+    auto *bounds = fl_value_new_map();
+    fl_value_set_string_take(bounds, "x", fl_value_new_float(x));
+    fl_value_set_string_take(bounds, "y", fl_value_new_float(y));
+    fl_value_set_string_take(bounds, "width", fl_value_new_float(width));
+    fl_value_set_string_take(bounds, "height", fl_value_new_float(height));
+    fl_value_set_string_take(value, "bounds", bounds);
+  }
+  if (fields & kDomQueryHtml) {
+    fl_value_set_string_take(value, "html", fl_value_new_string(html));
+  }
+  return value;
+}
+
+void on_dom_query_reply(GObject *object, GAsyncResult *result,
+                        gpointer user_data) {
+  auto *request = static_cast<DomQueryRequest *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  auto *reply = webkit_web_view_send_message_to_page_finish(
+      WEBKIT_WEB_VIEW(object), result, &error);
+  if (reply == nullptr) {
+    fl_method_call_respond_error(
+        request->call, "0",
+        g_error_matches(error, WEBKIT_USER_MESSAGE_ERROR,
+                        WEBKIT_USER_MESSAGE_UNHANDLED_MESSAGE)
+            ? "the web extension is not loaded"
+            : error->message,
+        nullptr, nullptr);
+  } else {
+    auto *parameters = webkit_user_message_get_parameters(reply);
+    if (g_strcmp0(webkit_user_message_get_name(reply), ERROR_MESSAGE) == 0 &&
+        g_variant_is_of_type(parameters, G_VARIANT_TYPE(ERROR_TYPE))) {
+      const gchar *message;
+      g_variant_get(parameters, "(&s)", &message);
+      fl_method_call_respond_error(request->call, "0", message, nullptr,
+                                   nullptr);
+    } else if (parameters == nullptr ||
+               !g_variant_is_of_type(parameters,
+                                     G_VARIANT_TYPE(DOM_QUERY_REPLY_TYPE))) {
+      fl_method_call_respond_error(request->call, "0",
+                                   "malformed DOM query reply", nullptr,
+                                   nullptr);
+    } else {
+      g_autoptr(FlValue) elements = fl_value_new_list();
+      auto count = g_variant_n_children(parameters);
+      for (gsize i = 0; i < count; ++i) {
+        g_autoptr(GVariant) element =
+            g_variant_get_child_value(parameters, i);
+        fl_value_append_take(elements,
+                             element_to_fl_value(element, request->fields));
+      }
+      fl_method_call_respond_success(request->call, elements, nullptr);
+    }
+    g_object_unref(reply);
+  }
+  g_object_unref(request->call);
+  delete request;
+}
+#endif
+
+}  // namespace
+
+void web_extension_client_attach(WebKitWebContext *context) {
+  g_signal_connect(context, "initialize-web-extensions",
+                   G_CALLBACK(on_initialize_web_extensions), nullptr);
+}
+
+void query_dom(WebKitWebView *web_view, const DomQuery &query,
+               FlMethodCall *call) {
+#if WEBKIT_CHECK_VERSION(2, 28, 0)
+  GVariantBuilder attributes;
+  g_variant_builder_init(&attributes, G_VARIANT_TYPE("as"));
+  for (const auto &attribute : query.attributes) {
+    g_variant_builder_add(&attributes, "s", attribute.c_str());
+  }
+  auto *message = webkit_user_message_new(
+      DOM_QUERY_MESSAGE,
+      g_variant_new(DOM_QUERY_TYPE, query.selector.c_str(), query.fields,
+                    query.limit, &attributes));
+  webkit_web_view_send_message_to_page(
+      web_view, message, nullptr, on_dom_query_reply,
+      new DomQueryRequest{FL_METHOD_CALL(g_object_ref(call)), query.fields});
+#else
+  fl_method_call_respond_error(call, "0", "DOM queries need WebKitGTK 2.28",
+                               nullptr, nullptr);
+#endif
+}
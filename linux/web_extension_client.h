@@ -0,0 +1,30 @@
+#ifndef WEBVIEW_WINDOW_LINUX_WEB_EXTENSION_CLIENT_H_
+#define WEBVIEW_WINDOW_LINUX_WEB_EXTENSION_CLIENT_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <string>
+#include <vector>
+
+// Loads the web extension of web_extension/ into the web processes of
+// |context|. Must be called before the context starts a web process.
+void web_extension_client_attach(WebKitWebContext *context);
+
+struct DomQuery {
+  std::string selector;
+  // DomQueryField bits of web_extension_protocol.h.
+  guint32 fields = 0;
+  // Maximum number of elements, 0 for all.
+  guint32 limit = 0;
+  // Attributes to read, all when empty.
+  std::vector<std::string> attributes;
+};
+
+// Runs |query| in the web process of |web_view| and responds to |call|
+// with a list of {"tag", "text", "attributes", "bounds", "html"} maps,
+// holding only the fields asked for. Needs WebKitGTK 2.28.
+void query_dom(WebKitWebView *web_view, const DomQuery &query,
+               FlMethodCall *call);
+
+#endif  // WEBVIEW_WINDOW_LINUX_WEB_EXTENSION_CLIENT_H_
@@ -0,0 +1,424 @@
+#include "webview_texture.h"
+
+namespace {
+
+// WebKit scrolls this many pixels per unit of a smooth scroll delta.
+constexpr double kPixelsPerScrollStep = 40;
+
+struct PixelFrame {
+  uint8_t *pixels;
+  uint32_t width;
+  uint32_t height;
+};
+
+void free_frame(PixelFrame *frame) {
+  if (frame) {
+    g_free(frame->pixels);
+    delete frame;
+  }
+}
+
+guint button_mask(guint button) {
+  return button >= 1 && button <= 5 ? GDK_BUTTON1_MASK << (button - 1) : 0;
+}
+
+guint32 event_time() {
+  return static_cast<guint32>(g_get_monotonic_time() / 1000);
+}
+
+}  // namespace
+
+struct _WebviewPixelTexture {
+  FlPixelBufferTexture parent_instance;
+
+  GMutex mutex;
+  // Copied by the platform thread, not picked up by the raster thread yet.
+  PixelFrame *pending;
+  // Read by the raster thread until its next copy_pixels call.
+  PixelFrame *current;
+  // Released by the raster thread, reused by the platform thread.
+  PixelFrame *spare;
+  // Pending frames replaced before the raster thread picked them up.
+  int64_t frames_dropped;
+  int64_t frames_presented;
+};
+
+G_DEFINE_TYPE(WebviewPixelTexture, webview_pixel_texture,
+              fl_pixel_buffer_texture_get_type())
+
+static gboolean webview_pixel_texture_copy_pixels(FlPixelBufferTexture *texture,
+                                                  const uint8_t **out_buffer,
+                                                  uint32_t *width,
+                                                  uint32_t *height,
+                                                  GError **error) {
+  auto *self = WEBVIEW_PIXEL_TEXTURE(texture);
+  g_mutex_lock(&self->mutex);
+  if (self->pending) {
+    free_frame(self->spare);
+    self->spare = self->current;
+    self->current = self->pending;
+    self->pending = nullptr;
+    self->frames_presented++;
+  }
+  auto *frame = self->current;
+  g_mutex_unlock(&self->mutex);
+
+  if (frame == nullptr) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED,
+                "no frame copied yet");
+    return FALSE;
+  }
+  *out_buffer = frame->pixels;
+  *width = frame->width;
+  *height = frame->height;
+  return TRUE;
+}
+
+static void webview_pixel_texture_finalize(GObject *object) {
+  auto *self = WEBVIEW_PIXEL_TEXTURE(object);
+  free_frame(self->pending);
+  free_frame(self->current);
+  free_frame(self->spare);
+  g_mutex_clear(&self->mutex);
+  G_OBJECT_CLASS(webview_pixel_texture_parent_class)->finalize(object);
+}
+
+static void webview_pixel_texture_class_init(WebviewPixelTextureClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = webview_pixel_texture_finalize;
+  FL_PIXEL_BUFFER_TEXTURE_CLASS(klass)->copy_pixels =
+      webview_pixel_texture_copy_pixels;
+}
+
+static void webview_pixel_texture_init(WebviewPixelTexture *self) {
+  g_mutex_init(&self->mutex);
+}
+
+// Returns a frame of |width| x |height| for the platform thread to fill.
+static PixelFrame *webview_pixel_texture_obtain_frame(WebviewPixelTexture *self,
+                                                      uint32_t width,
+                                                      uint32_t height) {
+  g_mutex_lock(&self->mutex);
+  auto *frame = self->spare;
+  self->spare = nullptr;
+  g_mutex_unlock(&self->mutex);
+
+  if (frame && (frame->width != width || frame->height != height)) {
+    free_frame(frame);
+    frame = nullptr;
+  }
+  if (frame == nullptr) {
+    frame = new PixelFrame{
+        static_cast<uint8_t *>(g_malloc(static_cast<gsize>(width) * height * 4)),
+        width, height};
+  }
+  return frame;
+}
+
+static void webview_pixel_texture_publish_frame(WebviewPixelTexture *self,
+                                                PixelFrame *frame) {
+  g_mutex_lock(&self->mutex);
+  if (self->pending) {
+    self->frames_dropped++;
+    free_frame(self->spare);
+    self->spare = self->pending;
+  }
+  self->pending = frame;
+  g_mutex_unlock(&self->mutex);
+}
+
+WebviewTexture::WebviewTexture(FlTextureRegistrar *registrar,
+                               GtkWidget *offscreen_window, GtkWidget *view,
+                               const TextureConfig &config)
+    : registrar_(FL_TEXTURE_REGISTRAR(g_object_ref(registrar))),
+      offscreen_window_(offscreen_window),
+      view_(view),
+      texture_(WEBVIEW_PIXEL_TEXTURE(
+          g_object_new(webview_pixel_texture_get_type(), nullptr))),
+      min_frame_interval_us_(G_USEC_PER_SEC /
+                             MAX(1, config.max_frame_rate)) {
+  fl_texture_registrar_register_texture(registrar_, FL_TEXTURE(texture_));
+  damage_handler_ = g_signal_connect(offscreen_window_, "damage-event",
+                                     G_CALLBACK(OnDamage), this);
+  // The view may have painted before the handler was connected.
+  ScheduleCopy();
+}
+
+WebviewTexture::~WebviewTexture() {
+  g_signal_handler_disconnect(offscreen_window_, damage_handler_);
+  if (copy_source_) {
+    g_source_remove(copy_source_);
+  }
+  if (staging_surface_) {
+    cairo_surface_destroy(staging_surface_);
+  }
+  // The engine keeps its own reference until the raster thread lets go.
+  fl_texture_registrar_unregister_texture(registrar_, FL_TEXTURE(texture_));
+  g_object_unref(texture_);
+  g_object_unref(registrar_);
+}
+
+int64_t WebviewTexture::texture_id() const {
+  return fl_texture_get_id(FL_TEXTURE(texture_));
+}
+
+void WebviewTexture::Resize(int width, int height) {
+  gtk_widget_set_size_request(view_, width, height);
+  gtk_window_resize(GTK_WINDOW(offscreen_window_), width, height);
+}
+
+gboolean WebviewTexture::OnDamage(GtkWidget *widget, GdkEvent *event,
+                                  gpointer user_data) {
+  auto *texture = static_cast<WebviewTexture *>(user_data);
+  texture->damage_events_++;
+  texture->ScheduleCopy();
+  return FALSE;
+}
+
+void WebviewTexture::ScheduleCopy() {
+  // Damage arriving before the copy runs is covered by it.
+  if (copy_source_) {
+    return;
+  }
+  auto elapsed = g_get_monotonic_time() - last_copy_time_;
+  guint delay_ms = 0;
+  if (elapsed < min_frame_interval_us_) {
+    delay_ms = static_cast<guint>((min_frame_interval_us_ - elapsed + 999) /
+                                  1000);
+  }
+  copy_source_ = g_timeout_add(
+      delay_ms,
+      [](gpointer user_data) -> gboolean {
+        auto *texture = static_cast<WebviewTexture *>(user_data);
+        texture->copy_source_ = 0;
+        texture->CopyFrame();
+        return G_SOURCE_REMOVE;
+      },
+      this);
+}
+
+void WebviewTexture::CopyFrame() {
+  auto *surface =
+      gtk_offscreen_window_get_surface(GTK_OFFSCREEN_WINDOW(offscreen_window_));
+  if (surface == nullptr) {
+    return;
+  }
+  auto start = g_get_monotonic_time();
+  last_copy_time_ = start;
+
+  auto *image = surface;
+  if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE) {
+    auto scale = gtk_widget_get_scale_factor(offscreen_window_);
+    auto width = gtk_widget_get_allocated_width(offscreen_window_) * scale;
+    auto height = gtk_widget_get_allocated_height(offscreen_window_) * scale;
+    if (width <= 0 || height <= 0) {
+      return;
+    }
+    if (staging_surface_ == nullptr ||
+        cairo_image_surface_get_width(staging_surface_) != width ||
+        cairo_image_surface_get_height(staging_surface_) != height) {
+      if (staging_surface_) {
+        cairo_surface_destroy(staging_surface_);
+      }
+      staging_surface_ =
+          cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+      cairo_surface_set_device_scale(staging_surface_, scale, scale);
+    }
+    auto *cr = cairo_create(staging_surface_);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr, surface, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    image = staging_surface_;
+  }
+  if (cairo_image_surface_get_format(image) != CAIRO_FORMAT_ARGB32) {
+    return;
+  }
+
+  cairo_surface_flush(image);
+  auto width = cairo_image_surface_get_width(image);
+  auto height = cairo_image_surface_get_height(image);
+  auto stride = cairo_image_surface_get_stride(image);
+  const auto *data = cairo_image_surface_get_data(image);
+  if (data == nullptr || width <= 0 || height <= 0) {
+    return;
+  }
+
+  // Cairo stores native-endian ARGB words, Flutter wants R G B A bytes.
+  auto *frame = webview_pixel_texture_obtain_frame(
+      texture_, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+  auto *out = frame->pixels;
+  for (int y = 0; y < height; ++y) {
+    const auto *row = reinterpret_cast<const uint32_t *>(data + y * stride);
+    for (int x = 0; x < width; ++x) {
+      auto pixel = row[x];
+      out[0] = static_cast<uint8_t>(pixel >> 16);
+      out[1] = static_cast<uint8_t>(pixel >> 8);
+      out[2] = static_cast<uint8_t>(pixel);
+      out[3] = static_cast<uint8_t>(pixel >> 24);
+      out += 4;
+    }
+  }
+  webview_pixel_texture_publish_frame(texture_, frame);
+  fl_texture_registrar_mark_texture_frame_available(registrar_,
+                                                    FL_TEXTURE(texture_));
+
+  auto now = g_get_monotonic_time();
+  frames_copied_++;
+  bytes_copied_ += static_cast<int64_t>(width) * height * 4;
+  copy_time_us_ += now - start;
+  frame_width_ = width;
+  frame_height_ = height;
+  if (now - rate_window_start_ >= G_USEC_PER_SEC) {
+    frame_rate_ = rate_window_start_ == 0
+                      ? 0
+                      : rate_window_frames_ * static_cast<double>(G_USEC_PER_SEC) /
+                            (now - rate_window_start_);
+    rate_window_start_ = now;
+    rate_window_frames_ = 0;
+  }
+  rate_window_frames_++;
+}
+
+void WebviewTexture::DispatchEvent(GdkEvent *event, GdkDevice *device) {
+  gdk_event_set_device(event, device);
+  gtk_widget_event(view_, event);
+  gdk_event_free(event);
+}
+
+void WebviewTexture::SendPointerEvent(const TexturePointerEvent &event) {
+  auto *window = gtk_widget_get_window(view_);
+  if (window == nullptr) {
+    return;
+  }
+  auto *device = gdk_seat_get_pointer(
+      gdk_display_get_default_seat(gtk_widget_get_display(view_)));
+  // Like real events, the state holds the buttons down before this one.
+  auto state = event.modifiers | button_mask_;
+
+  GdkEvent *gdk_event = nullptr;
+  switch (event.type) {
+    case TexturePointerEventType::kDown:
+    case TexturePointerEventType::kUp: {
+      auto down = event.type == TexturePointerEventType::kDown;
+      if (down) {
+        SetFocused(true);
+        button_mask_ |= button_mask(event.button);
+      } else {
+        button_mask_ &= ~button_mask(event.button);
+      }
+      gdk_event = gdk_event_new(down ? GDK_BUTTON_PRESS : GDK_BUTTON_RELEASE);
+      gdk_event->button.x = event.x;
+      gdk_event->button.y = event.y;
+      gdk_event->button.x_root = event.x;
+      gdk_event->button.y_root = event.y;
+      gdk_event->button.button = event.button;
+      gdk_event->button.state = state;
+      gdk_event->button.time = event_time();
+      break;
+    }
+    case TexturePointerEventType::kMove:
+      gdk_event = gdk_event_new(GDK_MOTION_NOTIFY);
+      gdk_event->motion.x = event.x;
+      gdk_event->motion.y = event.y;
+      gdk_event->motion.x_root = event.x;
+      gdk_event->motion.y_root = event.y;
+      gdk_event->motion.state = state;
+      gdk_event->motion.time = event_time();
+      break;
+    case TexturePointerEventType::kScroll:
+      gdk_event = gdk_event_new(GDK_SCROLL);
+      gdk_event->scroll.x = event.x;
+      gdk_event->scroll.y = event.y;
+      gdk_event->scroll.x_root = event.x;
+      gdk_event->scroll.y_root = event.y;
+      gdk_event->scroll.direction = GDK_SCROLL_SMOOTH;
+      gdk_event->scroll.delta_x = event.scroll_dx / kPixelsPerScrollStep;
+      gdk_event->scroll.delta_y = event.scroll_dy / kPixelsPerScrollStep;
+      gdk_event->scroll.state = state;
+      gdk_event->scroll.time = event_time();
+      break;
+    case TexturePointerEventType::kLeave:
+      button_mask_ = 0;
+      gdk_event = gdk_event_new(GDK_LEAVE_NOTIFY);
+      gdk_event->crossing.x = event.x;
+      gdk_event->crossing.y = event.y;
+      gdk_event->crossing.x_root = event.x;
+      gdk_event->crossing.y_root = event.y;
+      gdk_event->crossing.mode = GDK_CROSSING_NORMAL;
+      gdk_event->crossing.detail = GDK_NOTIFY_ANCESTOR;
+      gdk_event->crossing.state = state;
+      gdk_event->crossing.time = event_time();
+      break;
+  }
+  gdk_event->any.window = GDK_WINDOW(g_object_ref(window));
+  gdk_event->any.send_event = TRUE;
+  DispatchEvent(gdk_event, device);
+}
+
+void WebviewTexture::SendKeyEvent(const TextureKeyEvent &event) {
+  auto *window = gtk_widget_get_window(view_);
+  if (window == nullptr) {
+    return;
+  }
+  auto *device = gdk_seat_get_keyboard(
+      gdk_display_get_default_seat(gtk_widget_get_display(view_)));
+  auto *gdk_event = gdk_event_new(event.down ? GDK_KEY_PRESS : GDK_KEY_RELEASE);
+  gdk_event->key.window = GDK_WINDOW(g_object_ref(window));
+  gdk_event->key.send_event = TRUE;
+  gdk_event->key.time = event_time();
+  gdk_event->key.state = event.modifiers;
+  gdk_event->key.keyval = event.keyval;
+  gdk_event->key.hardware_keycode = event.keycode;
+  DispatchEvent(gdk_event, device);
+}
+
+void WebviewTexture::SetFocused(bool focused) {
+  if (focused_ == focused) {
+    return;
+  }
+  focused_ = focused;
+  auto *window = gtk_widget_get_window(offscreen_window_);
+  if (window == nullptr) {
+    return;
+  }
+  if (focused) {
+    gtk_widget_grab_focus(view_);
+  }
+  // The offscreen window never gets the focus from the window manager, so
+  // tell it it has it, which makes it the active window WebKit checks for.
+  auto *gdk_event = gdk_event_new(GDK_FOCUS_CHANGE);
+  gdk_event->focus_change.window = GDK_WINDOW(g_object_ref(window));
+  gdk_event->focus_change.send_event = TRUE;
+  gdk_event->focus_change.in = focused;
+  gtk_widget_send_focus_change(offscreen_window_, gdk_event);
+  gdk_event_free(gdk_event);
+}
+
+FlValue *WebviewTexture::GetStats() const {
+  g_mutex_lock(&texture_->mutex);
+  auto frames_presented = texture_->frames_presented;
+  auto frames_dropped = texture_->frames_dropped;
+  g_mutex_unlock(&texture_->mutex);
+
+  auto *stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "textureId", fl_value_new_int(texture_id()));
+  fl_value_set_string_take(stats, "width", fl_value_new_int(frame_width_));
+  fl_value_set_string_take(stats, "height", fl_value_new_int(frame_height_));
+  fl_value_set_string_take(stats, "damageEvents",
+                           fl_value_new_int(damage_events_));
+  fl_value_set_string_take(stats, "framesCopied",
+                           fl_value_new_int(frames_copied_));
+  fl_value_set_string_take(stats, "framesPresented",
+                           fl_value_new_int(frames_presented));
+  fl_value_set_string_take(stats, "framesDropped",
+                           fl_value_new_int(frames_dropped));
+  fl_value_set_string_take(stats, "bytesCopied",
+                           fl_value_new_int(bytes_copied_));
+  fl_value_set_string_take(
+      stats, "averageCopyUs",
+      fl_value_new_float(frames_copied_ ? static_cast<double>(copy_time_us_) /
+                                              frames_copied_
+                                        : 0));
+  fl_value_set_string_take(stats, "frameRate", fl_value_new_float(frame_rate_));
+  return stats;
+}
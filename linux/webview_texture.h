@@ -0,0 +1,119 @@
+#ifndef WEBVIEW_WINDOW_LINUX_WEBVIEW_TEXTURE_H_
+#define WEBVIEW_WINDOW_LINUX_WEBVIEW_TEXTURE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include <cstdint>
+
+G_DECLARE_FINAL_TYPE(WebviewPixelTexture, webview_pixel_texture, WEBVIEW,
+                     PIXEL_TEXTURE, FlPixelBufferTexture)
+
+struct TextureConfig {
+  // Frames are copied at most this often, however often the page repaints.
+  int max_frame_rate = 60;
+  // Renders the page without the GPU, so it also works on machines without
+  // one. Offscreen views only paint reliably this way.
+  bool software_rendering = true;
+};
+
+enum class TexturePointerEventType {
+  kDown = 0,
+  kUp = 1,
+  kMove = 2,
+  kScroll = 3,
+  kLeave = 4,
+};
+
+struct TexturePointerEvent {
+  TexturePointerEventType type = TexturePointerEventType::kMove;
+  // Position in the view, in logical pixels.
+  double x = 0;
+  double y = 0;
+  // GDK button number: 1 primary, 2 middle, 3 secondary.
+  guint button = 0;
+  // Scroll distance in logical pixels.
+  double scroll_dx = 0;
+  double scroll_dy = 0;
+  // GdkModifierType mask of the keyboard modifiers.
+  guint modifiers = 0;
+};
+
+struct TextureKeyEvent {
+  bool down = true;
+  guint keyval = 0;
+  guint16 keycode = 0;
+  // GdkModifierType mask.
+  guint modifiers = 0;
+};
+
+// Shows a web view rendering in an offscreen window as a Flutter texture.
+//
+// The window is copied into the texture only after it reports damage, and
+// at most max_frame_rate times a second. Frames go through three buffers,
+// so the raster thread never waits for a copy and the platform thread never
+// waits for an upload. Input arrives from Flutter and is handed to the view
+// as synthesized GDK events.
+class WebviewTexture {
+ public:
+  WebviewTexture(FlTextureRegistrar *registrar, GtkWidget *offscreen_window,
+                 GtkWidget *view, const TextureConfig &config);
+
+  ~WebviewTexture();
+
+  WebviewTexture(const WebviewTexture &) = delete;
+  WebviewTexture &operator=(const WebviewTexture &) = delete;
+
+  int64_t texture_id() const;
+
+  // Resizes the view, in logical pixels.
+  void Resize(int width, int height);
+
+  void SendPointerEvent(const TexturePointerEvent &event);
+
+  void SendKeyEvent(const TextureKeyEvent &event);
+
+  // Gives the view the keyboard focus, or takes it away.
+  void SetFocused(bool focused);
+
+  FlValue *GetStats() const;
+
+ private:
+  FlTextureRegistrar *registrar_;
+  GtkWidget *offscreen_window_;
+  GtkWidget *view_;
+  WebviewPixelTexture *texture_;
+
+  gint64 min_frame_interval_us_;
+  gulong damage_handler_ = 0;
+  guint copy_source_ = 0;
+  gint64 last_copy_time_ = 0;
+  // Window contents of non-image surfaces are drawn into this one first.
+  cairo_surface_t *staging_surface_ = nullptr;
+
+  // Buttons held down, as GdkModifierType button masks.
+  guint button_mask_ = 0;
+  bool focused_ = false;
+
+  int64_t damage_events_ = 0;
+  int64_t frames_copied_ = 0;
+  int64_t bytes_copied_ = 0;
+  int64_t copy_time_us_ = 0;
+  int frame_width_ = 0;
+  int frame_height_ = 0;
+  gint64 rate_window_start_ = 0;
+  int64_t rate_window_frames_ = 0;
+  double frame_rate_ = 0;
+
+  static gboolean OnDamage(GtkWidget *widget, GdkEvent *event,
+                           gpointer user_data);
+
+  void ScheduleCopy();
+
+  void CopyFrame();
+
+  // Dispatches |event| to the view and frees it.
+  void DispatchEvent(GdkEvent *event, GdkDevice *device);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_WEBVIEW_TEXTURE_H_
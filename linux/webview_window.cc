@@ -4,79 +4,23 @@
 
 #include "webview_window.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <utility>
 
+#include "js_value_converter.h"
+#include "process_memory.h"
+#include "web_extension/web_extension_protocol.h"
+
 #if WEBKIT_MAJOR_VERSION < 2 || \
     (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION < 40)
 #define WEBKIT_OLD_USED
 #endif
 
-struct UserData {
-    int64_t window_id;
-    FlMethodChannel* method_channel_;
-};
-
 void handle_script_message(WebKitUserContentManager *manager, WebKitJavascriptResult *js_result, gpointer user_data) {
-  JSCValue *value = webkit_javascript_result_get_js_value(js_result);
-  if (jsc_value_is_string(value)) {
-      char *message = jsc_value_to_string(value);
-      auto *args = fl_value_new_map();
-      UserData* r_user_data = static_cast<UserData*>(user_data);
-      int64_t window_id = r_user_data->window_id;
-      FlMethodChannel* method_channel_ = r_user_data->method_channel_;
-      fl_value_set(args, fl_value_new_string("id"), fl_value_new_int(window_id));
-      fl_value_set(args, fl_value_new_string("message"), fl_value_new_string(message));
-      fl_method_channel_invoke_method(FL_METHOD_CHANNEL(method_channel_),
-                                      "onJavascriptWebMessageReceived", args, nullptr,
-                                      nullptr, nullptr);
-      fl_value_unref(args);
-      g_free(message);
-  } else {
-      g_print("Received non-string message\n");
-  }
-}
-
-void get_cookies_callback(WebKitCookieManager *manager, GAsyncResult *res,
-                          gpointer user_data) {
-  CookieData *data = (CookieData *)user_data;
-  GError *error = NULL;
-
-  GList *cookies =
-      webkit_cookie_manager_get_cookies_finish(manager, res, &error);
-  if (error != NULL) {
-    g_print("Error getting cookies: %s\n", error->message);
-    g_error_free(error);
-    data->cookies = NULL;
-  } else {
-    data->cookies = cookies;
-  }
-
-  g_main_loop_quit(data->loop);
-}
-
-GList *get_cookies_sync(WebKitWebView *web_view) {
-  WebKitCookieManager *cookie_manager;
-  GMainLoop *loop;
-  CookieData data = {0};
-
-  cookie_manager = webkit_web_context_get_cookie_manager(
-      webkit_web_view_get_context(web_view));
-  loop = g_main_loop_new(NULL, FALSE);
-  data.loop = loop;
-
-  const gchar *uri = webkit_web_view_get_uri(web_view);
-
-  // Start the asynchronous operation
-  webkit_cookie_manager_get_cookies(cookie_manager, uri, NULL,
-                                    (GAsyncReadyCallback)get_cookies_callback,
-                                    &data);
-
-  // Run the main loop until the callback is called
-  g_main_loop_run(loop);
-
-  g_main_loop_unref(loop);
-
-  return data.cookies;
+  auto *window = static_cast<WebviewWindow *>(user_data);
+  window->OnScriptMessage(webkit_javascript_result_get_js_value(js_result));
 }
 
 namespace {
@@ -102,6 +46,85 @@ void on_load_changed(WebKitWebView *web_view, WebKitLoadEvent load_event,
   window->OnLoadChanged(load_event);
 }
 
+// Lets signals of objects owned by the web view find the window, which may
+// be gone before them.
+constexpr char kWindowDataKey[] = "webview-window";
+
+// WebKit fails loads blocked by a content filter with this policy error
+// code, which has no name in the GTK API.
+constexpr int kPolicyErrorBlockedByContentBlocker = 104;
+
+void on_resource_load_started(WebKitWebView *web_view,
+                              WebKitWebResource *resource,
+                              WebKitURIRequest *request, gpointer user_data) {
+  auto *window = static_cast<WebviewWindow *>(user_data);
+  window->OnResourceLoadStarted(resource, request);
+}
+
+void on_resource_failed(WebKitWebResource *resource, GError *error,
+                        gpointer user_data) {
+  auto *window = static_cast<WebviewWindow *>(
+      g_object_get_data(G_OBJECT(user_data), kWindowDataKey));
+  if (window) {
+    window->OnResourceFailed(resource, error);
+  }
+}
+
+void on_resource_finished(WebKitWebResource *resource, gpointer user_data) {
+  auto *window = static_cast<WebviewWindow *>(
+      g_object_get_data(G_OBJECT(user_data), kWindowDataKey));
+  if (window) {
+    window->OnResourceFinished(resource);
+  }
+}
+
+// The serial of the navigation a resource was loaded for.
+constexpr char kNavigationSerialKey[] = "webview-navigation-serial";
+
+gboolean on_load_failed(WebKitWebView *web_view, WebKitLoadEvent load_event,
+                        gchar *failing_uri, GError *error,
+                        gpointer user_data) {
+  auto *window = static_cast<WebviewWindow *>(user_data);
+  window->OnLoadFailed(error);
+  return FALSE;
+}
+
+void on_estimated_load_progress(GObject *object, GParamSpec *pspec,
+                                gpointer user_data) {
+  auto *window = static_cast<WebviewWindow *>(user_data);
+  window->OnLoadProgressChanged();
+}
+
+void on_window_map(GtkWidget *widget, gpointer user_data) {
+  auto *window = static_cast<WebviewWindow *>(user_data);
+  window->MarkActive();
+  window->Restore();
+}
+
+#if WEBKIT_CHECK_VERSION(2, 28, 0)
+gboolean on_user_message_received(WebKitWebView *web_view,
+                                  WebKitUserMessage *message,
+                                  gpointer user_data) {
+  if (g_strcmp0(webkit_user_message_get_name(message),
+                PAGE_CREATED_MESSAGE) != 0) {
+    return FALSE;
+  }
+  auto *parameters = webkit_user_message_get_parameters(message);
+  if (parameters &&
+      g_variant_is_of_type(parameters, G_VARIANT_TYPE(PAGE_CREATED_TYPE))) {
+    guint32 pid;
+    g_variant_get(parameters, PAGE_CREATED_TYPE, &pid);
+    static_cast<WebviewWindow *>(user_data)->OnPageCreated(
+        static_cast<pid_t>(pid));
+  }
+  return TRUE;
+}
+#endif
+
+double elapsed_ms(gint64 from, gint64 to) {
+  return from && to ? (to - from) / 1000.0 : -1;
+}
+
 gboolean decide_policy_cb(WebKitWebView *web_view,
                           WebKitPolicyDecision *decision,
                           WebKitPolicyDecisionType type, gpointer user_data) {
@@ -109,78 +132,176 @@ gboolean decide_policy_cb(WebKitWebView *web_view,
   return window->DecidePolicy(decision, type);
 }
 
+void evaluate_script(WebKitWebView *web_view, const char *java_script,
+                     GCancellable *cancellable, GAsyncReadyCallback callback,
+                     gpointer user_data) {
+#ifdef WEBKIT_OLD_USED
+  webkit_web_view_run_javascript(web_view, java_script, cancellable,
+                                 callback, user_data);
+#else
+  webkit_web_view_evaluate_javascript(web_view, java_script, -1, nullptr,
+                                      nullptr, cancellable, callback,
+                                      user_data);
+#endif
+}
+
+// Appends |text| to |script| as a JavaScript string literal.
+void append_js_string(std::string *script, const char *text) {
+  script->push_back('"');
+  for (auto *p = reinterpret_cast<const unsigned char *>(text); *p; ++p) {
+    switch (*p) {
+      case '"':
+        script->append("\\\"");
+        break;
+      case '\\':
+        script->append("\\\\");
+        break;
+      case '\n':
+        script->append("\\n");
+        break;
+      case '\r':
+        script->append("\\r");
+        break;
+      default:
+        if (*p < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", *p);
+          script->append(escaped);
+        } else if (*p == 0xe2 && p[1] == 0x80 &&
+                   (p[2] == 0xa8 || p[2] == 0xa9)) {
+          // U+2028 and U+2029 end a line in older JavaScript engines.
+          script->append(p[2] == 0xa8 ? "\\u2028" : "\\u2029");
+          p += 2;
+        } else {
+          script->push_back(static_cast<char>(*p));
+        }
+    }
+  }
+  script->push_back('"');
+}
+
+// Dispatches a "message" event on the window for each [isJson, text] pair
+// of the array it is called with.
+const char kDispatchPageMessages[] =
+    "(function(m){for(var i=0;i<m.length;i+=2){var d=m[i+1];"
+    "if(m[i]){try{d=JSON.parse(d);}catch(e){console.error(e);continue;}}"
+    "window.dispatchEvent(new MessageEvent('message',{data:d}));}})";
+
+// Returns a new reference to the value of a script started with
+// evaluate_script(), or null and |error|.
+JSCValue *finish_script(WebKitWebView *web_view, GAsyncResult *result,
+                        GError **error) {
+#ifdef WEBKIT_OLD_USED
+  auto *js_result =
+      webkit_web_view_run_javascript_finish(web_view, result, error);
+  if (!js_result) {
+    return nullptr;
+  }
+  auto *value = JSC_VALUE(
+      g_object_ref(webkit_javascript_result_get_js_value(js_result)));
+  webkit_javascript_result_unref(js_result);
+  return value;
+#else
+  return webkit_web_view_evaluate_javascript_finish(web_view, result, error);
+#endif
+}
+
+// Returns the result of a script, or null and |error| if the native
+// conversion fails.
+FlValue *script_result_to_fl_value(JSCValue *value, bool native_result,
+                                   GError **error) {
+  if (native_result) {
+    return js_value_to_fl_value(value, error);
+  }
+  g_autofree gchar *json = jsc_value_to_json(value, 0);
+  return json ? fl_value_new_string(json) : fl_value_new_null();
+}
+
+struct CookieRequest {
+  FlMethodCall *call;
+  CookieFilter filter;
+};
+
+void on_cookies_ready(GObject *object, GAsyncResult *result,
+                      gpointer user_data) {
+  auto *request = static_cast<CookieRequest *>(user_data);
+  GError *error = nullptr;
+  GList *cookies = webkit_cookie_manager_get_cookies_finish(
+      WEBKIT_COOKIE_MANAGER(object), result, &error);
+  if (error != nullptr) {
+    g_autoptr(FlValue) details = fl_value_new_string(error->message);
+    fl_method_call_respond_error(request->call, "0", "get all cookies failed",
+                                 details, nullptr);
+    g_error_free(error);
+  } else {
+    g_autoptr(FlValue) cookie_list = fl_value_new_list();
+    for (GList *l = cookies; l; l = l->next) {
+      auto *cookie = static_cast<SoupCookie *>(l->data);
+      if (cookie_matches(cookie, request->filter)) {
+        fl_value_append_take(cookie_list,
+                             cookie_to_fl_value(cookie, request->filter.fields));
+      }
+    }
+    g_list_free_full(cookies, reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+    fl_method_call_respond_success(request->call, cookie_list, nullptr);
+  }
+  g_object_unref(request->call);
+  delete request;
+}
+
 }  // namespace
 
-WebviewWindow::WebviewWindow(FlMethodChannel *method_channel, int64_t window_id,
+WebviewWindow::WebviewWindow(FlMethodChannel *method_channel,
                              std::function<void()> on_close_callback,
-                             const std::string &title, int width, int height,
-                             bool headless,
-                             const std::vector<UserScript> &user_scripts,
-                             const char* proxy_url)
+                             WebKitWebContext *context,
+                             UserScriptRegistry *user_script_registry)
     : method_channel_(method_channel),
-      window_id_(window_id),
+      window_id_(kUnclaimedWindowId),
       on_close_callback_(std::move(on_close_callback)),
-      default_user_agent_() {
+      default_user_agent_(),
+      user_script_registry_(user_script_registry),
+      message_cancellable_(g_cancellable_new()) {
   g_object_ref(method_channel_);
 
   window_ = gtk_window_new(GTK_WINDOW_TOPLEVEL);
   g_signal_connect(G_OBJECT(window_), "destroy",
                    G_CALLBACK(+[](GtkWidget *, gpointer arg) {
                      auto *window = static_cast<WebviewWindow *>(arg);
+                     if (window->IsClaimed()) {
+                       auto *args = fl_value_new_map();
+                       fl_value_set(args, fl_value_new_string("id"),
+                                    fl_value_new_int(window->window_id_));
+                       fl_method_channel_invoke_method(
+                           FL_METHOD_CHANNEL(window->method_channel_),
+                           "onWindowClose", args, nullptr, nullptr, nullptr);
+                       fl_value_unref(args);
+                     }
+                     // The callback may delete |window|, so it runs last.
                      if (window->on_close_callback_) {
                        window->on_close_callback_();
                      }
-                     auto *args = fl_value_new_map();
-                     fl_value_set(args, fl_value_new_string("id"),
-                                  fl_value_new_int(window->window_id_));
-                     fl_method_channel_invoke_method(
-                         FL_METHOD_CHANNEL(window->method_channel_),
-                         "onWindowClose", args, nullptr, nullptr, nullptr);
                    }),
                    this);
-  gtk_window_set_title(GTK_WINDOW(window_), title.c_str());
-  gtk_window_set_default_size(GTK_WINDOW(window_), width, height);
+  g_signal_connect(G_OBJECT(window_), "map", G_CALLBACK(on_window_map), this);
   gtk_window_set_position(GTK_WINDOW(window_), GTK_WIN_POS_CENTER);
 
   // initial web_view
   auto *manager = webkit_user_content_manager_new();
-  for (const auto &script : user_scripts) {
-    // g_print("checkpoint: inject time: %d\n", script.injection_time);
-    // g_print("checkPoint: inject all iframe: %d\n", script.for_all_frames);
-    webkit_user_content_manager_add_script(
-        manager, webkit_user_script_new(
-                     script.source.c_str(),
-                     script.for_all_frames
-                         ? WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES
-                         : WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
-                     script.injection_time == 0
-                         ? WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START
-                         : WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END,
-                     nullptr, nullptr));
-  }
 
   // Register callback for window.webkit.messageHandlers.msgToNative.postMessage(value)
-  UserData* user_data = new UserData{window_id, method_channel_};
   g_signal_connect (manager, "script-message-received::msgToNative",
-                  G_CALLBACK (handle_script_message), user_data);
+                  G_CALLBACK (handle_script_message), this);
   webkit_user_content_manager_register_script_message_handler (manager, "msgToNative");
 
-  // Configure proxy settings
-  auto *context = webkit_web_context_get_default();
-  auto *data_manager = webkit_web_context_get_website_data_manager(context);
-  if (proxy_url != nullptr) {
-    auto *proxy_settings = webkit_network_proxy_settings_new(proxy_url, nullptr);
-    webkit_website_data_manager_set_network_proxy_settings(
-        data_manager, WEBKIT_NETWORK_PROXY_MODE_CUSTOM, proxy_settings);
-  } else {
-    webkit_website_data_manager_set_network_proxy_settings(
-        data_manager, WEBKIT_NETWORK_PROXY_MODE_DEFAULT, nullptr);
+  if (context == nullptr) {
+    context = webkit_web_context_get_default();
   }
 
   webview_ = GTK_WIDGET(g_object_new(WEBKIT_TYPE_WEB_VIEW,
       "web-context", context,
       "user-content-manager", manager,
       nullptr));
+  g_object_unref(manager);
   g_signal_connect(G_OBJECT(webview_), "load-failed-with-tls-errors",
                    G_CALLBACK(on_load_failed_with_tls_errors), this);
   g_signal_connect(G_OBJECT(webview_), "create", G_CALLBACK(on_create), this);
@@ -188,35 +309,177 @@ WebviewWindow::WebviewWindow(FlMethodChannel *method_channel, int64_t window_id,
                    G_CALLBACK(on_load_changed), this);
   g_signal_connect(G_OBJECT(webview_), "decide-policy",
                    G_CALLBACK(decide_policy_cb), this);
+  g_signal_connect(G_OBJECT(webview_), "resource-load-started",
+                   G_CALLBACK(on_resource_load_started), this);
+  g_signal_connect(G_OBJECT(webview_), "load-failed",
+                   G_CALLBACK(on_load_failed), this);
+  g_signal_connect(G_OBJECT(webview_), "notify::estimated-load-progress",
+                   G_CALLBACK(on_estimated_load_progress), this);
+#if WEBKIT_CHECK_VERSION(2, 28, 0)
+  g_signal_connect(G_OBJECT(webview_), "user-message-received",
+                   G_CALLBACK(on_user_message_received), this);
+#endif
+  g_object_set_data(G_OBJECT(webview_), kWindowDataKey, this);
 
   auto settings = webkit_web_view_get_settings(WEBKIT_WEB_VIEW(webview_));
   webkit_settings_set_javascript_can_open_windows_automatically(settings, true);
   default_user_agent_ = webkit_settings_get_user_agent(settings);
   gtk_container_add(GTK_CONTAINER(window_), webview_);
+}
 
-  if (!headless) {
+WebviewWindow::WebviewWindow(FlMethodChannel *method_channel, int64_t window_id,
+                             std::function<void()> on_close_callback,
+                             const std::string &title, int width, int height,
+                             bool headless,
+                             const std::vector<UserScript> &user_scripts,
+                             WebKitWebContext *context, const char* proxy_url,
+                             UserScriptRegistry *user_script_registry)
+    : WebviewWindow(method_channel, nullptr, context, user_script_registry) {
+  ApplyProxy(proxy_url);
+  Claim(window_id, std::move(on_close_callback), title, width, height,
+        headless, user_scripts);
+}
+
+void WebviewWindow::Prewarm() {
+  warming_up_ = true;
+  webkit_web_view_load_uri(WEBKIT_WEB_VIEW(webview_), "about:blank");
+}
+
+void WebviewWindow::Claim(int64_t window_id,
+                          std::function<void()> on_close_callback,
+                          const std::string &title, int width, int height,
+                          bool headless,
+                          const std::vector<UserScript> &user_scripts) {
+  window_id_ = window_id;
+  on_close_callback_ = std::move(on_close_callback);
+  gtk_window_set_title(GTK_WINDOW(window_), title.c_str());
+  gtk_window_set_default_size(GTK_WINDOW(window_), width, height);
+
+  for (const auto &script : user_scripts) {
+    AddUserScript(script);
+  }
+
+  if (headless) {
+    // Move the view to an offscreen window, which renders without being
+    // shown, so snapshots of headless windows have pixels.
+    offscreen_window_ = gtk_offscreen_window_new();
+    g_object_ref(webview_);
+    gtk_container_remove(GTK_CONTAINER(window_), webview_);
+    gtk_container_add(GTK_CONTAINER(offscreen_window_), webview_);
+    g_object_unref(webview_);
+    gtk_widget_set_size_request(webview_, width, height);
+    gtk_widget_show_all(offscreen_window_);
+  } else {
     gtk_widget_show_all(GTK_WIDGET(window_));
     gtk_widget_grab_focus(GTK_WIDGET(webview_));
   }
 }
 
+void WebviewWindow::ApplyProxy(const char *proxy_url) {
+  // On the default context the proxy applies to every window without a
+  // session.
+  auto *context = webkit_web_view_get_context(WEBKIT_WEB_VIEW(webview_));
+  auto *data_manager = webkit_web_context_get_website_data_manager(context);
+  if (proxy_url != nullptr) {
+    auto *proxy_settings = webkit_network_proxy_settings_new(proxy_url, nullptr);
+    webkit_website_data_manager_set_network_proxy_settings(
+        data_manager, WEBKIT_NETWORK_PROXY_MODE_CUSTOM, proxy_settings);
+    webkit_network_proxy_settings_free(proxy_settings);
+  } else if (context == webkit_web_context_get_default()) {
+    webkit_website_data_manager_set_network_proxy_settings(
+        data_manager, WEBKIT_NETWORK_PROXY_MODE_DEFAULT, nullptr);
+  }
+}
+
 WebviewWindow::~WebviewWindow() {
+  auto *manager =
+      webkit_web_view_get_user_content_manager(WEBKIT_WEB_VIEW(webview_));
+  g_signal_handlers_disconnect_by_data(manager, this);
+  g_object_set_data(G_OBJECT(webview_), kWindowDataKey, nullptr);
+  if (message_flush_source_) {
+    g_source_remove(message_flush_source_);
+  }
+  if (progress_source_) {
+    g_source_remove(progress_source_);
+  }
+  if (page_message_source_) {
+    g_source_remove(page_message_source_);
+  }
+  g_cancellable_cancel(message_cancellable_);
+  g_object_unref(message_cancellable_);
+  downloads_.reset();
+  cookie_watcher_.reset();
+  for (auto *message : pending_messages_) {
+    fl_value_unref(message);
+  }
+  g_clear_object(&warm_up_item_);
+  if (discarded_state_) {
+    webkit_web_view_session_state_unref(discarded_state_);
+  }
+  for (auto &item : user_scripts_) {
+    user_script_registry_->Release(item.second);
+  }
   g_object_unref(method_channel_);
+  texture_.reset();
+  if (offscreen_window_) {
+    gtk_widget_destroy(offscreen_window_);
+  }
   printf("~WebviewWindow\n");
 }
 
 void WebviewWindow::Navigate(const char *url) {
+  warming_up_ = false;
   webkit_web_view_load_uri(WEBKIT_WEB_VIEW(webview_), url);
 }
 
 void WebviewWindow::RunJavaScriptWhenContentReady(const char *java_script) {
+  AddUserScript({java_script, 0, false});
+}
+
+int64_t WebviewWindow::AddUserScript(const UserScript &script) {
+  auto *user_script = user_script_registry_->Acquire(script);
+  webkit_user_content_manager_add_script(
+      webkit_web_view_get_user_content_manager(WEBKIT_WEB_VIEW(webview_)),
+      user_script);
+  auto script_id = next_user_script_id_++;
+  user_scripts_[script_id] = user_script;
+  return script_id;
+}
+
+bool WebviewWindow::RemoveUserScript(int64_t script_id) {
+  auto it = user_scripts_.find(script_id);
+  if (it == user_scripts_.end()) {
+    return false;
+  }
+  auto *user_script = it->second;
+  user_scripts_.erase(it);
+  // The same shared script may be added more than once, so rebuild the
+  // list rather than removing every copy of it.
+  ReinstallUserScripts();
+  user_script_registry_->Release(user_script);
+  return true;
+}
+
+bool WebviewWindow::ReplaceUserScript(int64_t script_id,
+                                      const UserScript &script) {
+  auto it = user_scripts_.find(script_id);
+  if (it == user_scripts_.end()) {
+    return false;
+  }
+  auto *old_script = it->second;
+  it->second = user_script_registry_->Acquire(script);
+  ReinstallUserScripts();
+  user_script_registry_->Release(old_script);
+  return true;
+}
+
+void WebviewWindow::ReinstallUserScripts() {
   auto *manager =
       webkit_web_view_get_user_content_manager(WEBKIT_WEB_VIEW(webview_));
-  webkit_user_content_manager_add_script(
-      manager,
-      webkit_user_script_new(java_script, WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
-                             WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
-                             nullptr, nullptr));
+  webkit_user_content_manager_remove_all_scripts(manager);
+  for (const auto &item : user_scripts_) {
+    webkit_user_content_manager_add_script(manager, item.second);
+  }
 }
 
 void WebviewWindow::SetApplicationNameForUserAgent(
@@ -226,12 +489,635 @@ void WebviewWindow::SetApplicationNameForUserAgent(
                                  (default_user_agent_ + app_name).c_str());
 }
 
+void WebviewWindow::QueryDom(const DomQuery &query, FlMethodCall *call) {
+  query_dom(WEBKIT_WEB_VIEW(webview_), query, call);
+}
+
+void WebviewWindow::OnScriptMessage(JSCValue *value) {
+  if (!IsClaimed()) {
+    return;
+  }
+  message_stats_.received++;
+  g_autoptr(GError) error = nullptr;
+  auto *message = js_value_to_fl_value(value, &error);
+  if (!message) {
+    g_warning("dropped script message: %s", error->message);
+    message_stats_.dropped++;
+    return;
+  }
+  if (!message_batching_.enabled) {
+    auto *args = fl_value_new_map();
+    fl_value_set(args, fl_value_new_string("id"), fl_value_new_int(window_id_));
+    fl_value_set_take(args, fl_value_new_string("message"), message);
+    fl_method_channel_invoke_method(FL_METHOD_CHANNEL(method_channel_),
+                                    "onJavascriptWebMessageReceived", args,
+                                    nullptr, nullptr, nullptr);
+    fl_value_unref(args);
+    message_stats_.delivered++;
+    return;
+  }
+
+  if (pending_messages_.size() >= message_batching_.max_queue_size) {
+    switch (message_batching_.overflow_policy) {
+      case MessageOverflowPolicy::kDropOldest:
+        fl_value_unref(pending_messages_.front());
+        pending_messages_.pop_front();
+        message_stats_.dropped++;
+        break;
+      case MessageOverflowPolicy::kDropNewest:
+        fl_value_unref(message);
+        message_stats_.dropped++;
+        return;
+      case MessageOverflowPolicy::kBlock:
+        FlushMessages(true);
+        break;
+    }
+  }
+  pending_messages_.push_back(message);
+  if (pending_messages_.size() >= message_batching_.max_batch_size) {
+    FlushMessages(false);
+  } else {
+    ScheduleMessageFlush();
+  }
+}
+
+void WebviewWindow::SetMessageBatching(const MessageBatchingConfig &config) {
+  message_batching_ = config;
+  if (message_batching_.max_batch_size == 0) {
+    message_batching_.max_batch_size = 1;
+  }
+  if (message_batching_.max_queue_size < message_batching_.max_batch_size) {
+    message_batching_.max_queue_size = message_batching_.max_batch_size;
+  }
+  if (!message_batching_.enabled) {
+    // Deliver whatever is still queued before going back to one call per
+    // message.
+    while (!pending_messages_.empty()) {
+      FlushMessages(true);
+    }
+  }
+}
+
+FlValue *WebviewWindow::GetMessageStats() const {
+  auto *stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "received",
+                           fl_value_new_int(message_stats_.received));
+  fl_value_set_string_take(stats, "delivered",
+                           fl_value_new_int(message_stats_.delivered));
+  fl_value_set_string_take(stats, "dropped",
+                           fl_value_new_int(message_stats_.dropped));
+  fl_value_set_string_take(stats, "batches",
+                           fl_value_new_int(message_stats_.batches));
+  // Channel calls saved by sending several messages in one batch.
+  fl_value_set_string_take(
+      stats, "coalesced",
+      fl_value_new_int(message_stats_.batched - message_stats_.batches));
+  fl_value_set_string_take(stats, "queued",
+                           fl_value_new_int(pending_messages_.size()));
+
+  auto *to_page = fl_value_new_map();
+  fl_value_set_string_take(to_page, "posted",
+                           fl_value_new_int(page_message_stats_.posted));
+  fl_value_set_string_take(to_page, "delivered",
+                           fl_value_new_int(page_message_stats_.delivered));
+  fl_value_set_string_take(to_page, "failed",
+                           fl_value_new_int(page_message_stats_.failed));
+  fl_value_set_string_take(to_page, "batches",
+                           fl_value_new_int(page_message_stats_.batches));
+  fl_value_set_string_take(to_page, "queued",
+                           fl_value_new_int(page_messages_queued_));
+  fl_value_set_string_take(to_page, "inFlight",
+                           fl_value_new_int(page_messages_in_flight_));
+  fl_value_set_string_take(stats, "toPage", to_page);
+  return stats;
+}
+
+void WebviewWindow::PostWebMessage(const char *message, bool is_json) {
+  page_message_stats_.posted++;
+  if (page_messages_queued_ > 0) {
+    page_messages_.push_back(',');
+  }
+  page_messages_.append(is_json ? "1," : "0,");
+  append_js_string(&page_messages_, message);
+  page_messages_queued_++;
+  if (page_message_source_ || page_messages_in_flight_ > 0) {
+    return;
+  }
+  // A default priority idle source runs in the next main loop iteration,
+  // after every method call already dispatched in this one.
+  page_message_source_ = g_idle_add_full(
+      G_PRIORITY_DEFAULT,
+      [](gpointer user_data) -> gboolean {
+        auto *window = static_cast<WebviewWindow *>(user_data);
+        window->page_message_source_ = 0;
+        window->FlushPageMessages();
+        return G_SOURCE_REMOVE;
+      },
+      this, nullptr);
+}
+
+void WebviewWindow::FlushPageMessages() {
+  if (page_messages_queued_ == 0 || page_messages_in_flight_ > 0) {
+    return;
+  }
+  std::string script(kDispatchPageMessages);
+  script.append("([");
+  script.append(page_messages_);
+  script.append("]);");
+  page_messages_.clear();
+  page_messages_in_flight_ = page_messages_queued_;
+  page_messages_queued_ = 0;
+  page_message_stats_.batches++;
+  // Later messages queue up while the page is busy and go out together.
+  evaluate_script(
+      WEBKIT_WEB_VIEW(webview_), script.c_str(), message_cancellable_,
+      [](GObject *object, GAsyncResult *result, gpointer user_data) {
+        g_autoptr(GError) error = nullptr;
+        auto *value = finish_script(WEBKIT_WEB_VIEW(object), result, &error);
+        // Cancelled when the window has been destroyed.
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+          return;
+        }
+        if (value) {
+          g_object_unref(value);
+        }
+        static_cast<WebviewWindow *>(user_data)->OnPageMessagesDelivered(
+            value != nullptr);
+      },
+      this);
+}
+
+void WebviewWindow::OnPageMessagesDelivered(bool delivered) {
+  if (delivered) {
+    page_message_stats_.delivered += page_messages_in_flight_;
+  } else {
+    page_message_stats_.failed += page_messages_in_flight_;
+  }
+  page_messages_in_flight_ = 0;
+  FlushPageMessages();
+}
+
+void WebviewWindow::SetPageCacheEnabled(bool enabled) {
+  webkit_settings_set_enable_page_cache(
+      webkit_web_view_get_settings(WEBKIT_WEB_VIEW(webview_)), enabled);
+}
+
+FlValue *WebviewWindow::GetMemoryUsage() const {
+  ProcessMemory total;
+  int64_t process_count = 0;
+  if (web_process_pid_ > 0 && read_process_memory(web_process_pid_, &total)) {
+    auto *usage = fl_value_new_map();
+    fl_value_set_string_take(usage, "rss", fl_value_new_int(total.rss));
+    fl_value_set_string_take(usage, "pss", fl_value_new_int(total.pss));
+    fl_value_set_string_take(usage, "processCount", fl_value_new_int(1));
+    fl_value_set_string_take(usage, "attributed", fl_value_new_bool(true));
+    return usage;
+  }
+  // Without the web extension WebKitGTK does not tell which web process
+  // renders a view, so report all web processes of the app and mark the
+  // numbers as not attributed.
+  for (auto pid : find_web_processes()) {
+    ProcessMemory memory;
+    if (read_process_memory(pid, &memory)) {
+      total.rss += memory.rss;
+      total.pss += memory.pss;
+      process_count++;
+    }
+  }
+  auto *usage = fl_value_new_map();
+  fl_value_set_string_take(usage, "rss", fl_value_new_int(total.rss));
+  fl_value_set_string_take(usage, "pss", fl_value_new_int(total.pss));
+  fl_value_set_string_take(usage, "processCount",
+                           fl_value_new_int(process_count));
+  fl_value_set_string_take(usage, "attributed", fl_value_new_bool(false));
+  return usage;
+}
+
+void WebviewWindow::OnPageCreated(pid_t pid) { web_process_pid_ = pid; }
+
+bool WebviewWindow::IsVisibleToUser() const {
+  if (texture_) {
+    return true;
+  }
+  return offscreen_window_ == nullptr && gtk_widget_get_mapped(window_);
+}
+
+bool WebviewWindow::Discard(int64_t *reclaimed_bytes) {
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+  auto *web_view = WEBKIT_WEB_VIEW(webview_);
+  if (!IsClaimed() || discarded_ ||
+      webkit_web_view_is_playing_audio(web_view)) {
+    return false;
+  }
+  ProcessMemory memory;
+  *reclaimed_bytes = web_process_pid_ > 0 &&
+                             read_process_memory(web_process_pid_, &memory)
+                         ? memory.pss
+                         : 0;
+  if (restore_started_) {
+    // The restore never finished, keep the state it started from.
+    restore_started_ = 0;
+  } else {
+    if (discarded_state_) {
+      webkit_web_view_session_state_unref(discarded_state_);
+    }
+    discarded_state_ = webkit_web_view_get_session_state(web_view);
+    const auto *uri = webkit_web_view_get_uri(web_view);
+    discarded_uri_ = uri ? uri : "";
+  }
+  discarded_ = true;
+  web_process_pid_ = 0;
+  webkit_web_view_terminate_web_process(web_view);
+
+  auto *args = fl_value_new_map();
+  fl_value_set_string_take(args, "discarded", fl_value_new_bool(true));
+  fl_value_set_string_take(args, "reclaimedBytes",
+                           fl_value_new_int(*reclaimed_bytes));
+  SendDiscardState(args);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void WebviewWindow::Restore() {
+  if (!discarded_) {
+    return;
+  }
+  discarded_ = false;
+  restore_started_ = g_get_monotonic_time();
+  auto *web_view = WEBKIT_WEB_VIEW(webview_);
+  WebKitBackForwardListItem *item = nullptr;
+  if (discarded_state_) {
+    webkit_web_view_restore_session_state(web_view, discarded_state_);
+    item = webkit_back_forward_list_get_current_item(
+        webkit_web_view_get_back_forward_list(web_view));
+  }
+  if (item) {
+    webkit_web_view_go_to_back_forward_list_item(web_view, item);
+  } else if (!discarded_uri_.empty()) {
+    webkit_web_view_load_uri(web_view, discarded_uri_.c_str());
+  } else {
+    restore_started_ = 0;
+  }
+
+  auto *args = fl_value_new_map();
+  fl_value_set_string_take(args, "discarded", fl_value_new_bool(false));
+  fl_value_set_string_take(args, "restoring",
+                           fl_value_new_bool(restore_started_ != 0));
+  SendDiscardState(args);
+}
+
+FlValue *WebviewWindow::SaveSessionState() const {
+  auto *state =
+      discarded_ && discarded_state_
+          ? webkit_web_view_session_state_ref(discarded_state_)
+          : webkit_web_view_get_session_state(WEBKIT_WEB_VIEW(webview_));
+  g_autoptr(GBytes) bytes = webkit_web_view_session_state_serialize(state);
+  webkit_web_view_session_state_unref(state);
+  gsize size;
+  auto *data = g_bytes_get_data(bytes, &size);
+  return fl_value_new_uint8_list(static_cast<const uint8_t *>(data), size);
+}
+
+void WebviewWindow::RestoreSessionState(WebKitWebViewSessionState *state) {
+  warming_up_ = false;
+  auto *web_view = WEBKIT_WEB_VIEW(webview_);
+  webkit_web_view_restore_session_state(web_view, state);
+  auto *item = webkit_back_forward_list_get_current_item(
+      webkit_web_view_get_back_forward_list(web_view));
+  if (item) {
+    webkit_web_view_go_to_back_forward_list_item(web_view, item);
+  }
+}
+
+void WebviewWindow::SendDiscardState(FlValue *args) {
+  fl_value_set_string_take(args, "id", fl_value_new_int(window_id_));
+  fl_method_channel_invoke_method(FL_METHOD_CHANNEL(method_channel_),
+                                  "onDiscardStateChanged", args, nullptr,
+                                  nullptr, nullptr);
+  fl_value_unref(args);
+}
+
+void WebviewWindow::AddContentFilter(WebKitUserContentFilter *filter) {
+  webkit_user_content_manager_add_filter(
+      webkit_web_view_get_user_content_manager(WEBKIT_WEB_VIEW(webview_)),
+      filter);
+  content_filters_.insert(webkit_user_content_filter_get_identifier(filter));
+}
+
+void WebviewWindow::RemoveContentFilter(const char *identifier) {
+  if (content_filters_.erase(identifier) == 0) {
+    return;
+  }
+  webkit_user_content_manager_remove_filter_by_id(
+      webkit_web_view_get_user_content_manager(WEBKIT_WEB_VIEW(webview_)),
+      identifier);
+}
+
+FlValue *WebviewWindow::GetContentFilterStats() const {
+  auto *stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "filters",
+                           fl_value_new_int(content_filters_.size()));
+  fl_value_set_string_take(stats, "blockedRequests",
+                           fl_value_new_int(blocked_requests_));
+  return stats;
+}
+
+int64_t WebviewWindow::AttachTexture(FlTextureRegistrar *registrar,
+                                     const TextureConfig &config) {
+  if (offscreen_window_ == nullptr) {
+    return -1;
+  }
+  if (config.software_rendering) {
+    auto *settings = webkit_web_view_get_settings(WEBKIT_WEB_VIEW(webview_));
+    webkit_settings_set_hardware_acceleration_policy(
+        settings, WEBKIT_HARDWARE_ACCELERATION_POLICY_NEVER);
+  }
+  texture_ = std::make_unique<WebviewTexture>(registrar, offscreen_window_,
+                                              webview_, config);
+  return texture_->texture_id();
+}
+
+void WebviewWindow::SetDownloadConfig(const DownloadConfig &config) {
+  if (!downloads_) {
+    downloads_ = std::make_unique<DownloadController>(
+        FL_METHOD_CHANNEL(method_channel_), window_id_, webview_);
+  }
+  downloads_->SetConfig(config);
+}
+
+void WebviewWindow::SetCookieWatch(const CookieWatchConfig *config) {
+  // Replaced rather than reconfigured, the index depends on the domain.
+  cookie_watcher_.reset();
+  if (config) {
+    cookie_watcher_ = std::make_unique<CookieWatcher>(
+        FL_METHOD_CHANNEL(method_channel_), window_id_, cookie_manager(),
+        *config);
+  }
+}
+
+void WebviewWindow::StartNetworkRecording(
+    const NetworkRecorderConfig &config) {
+  network_recorder_ = std::make_unique<NetworkRecorder>(config);
+}
+
+void WebviewWindow::OnResourceLoadStarted(WebKitWebResource *resource,
+                                          WebKitURIRequest *request) {
+  if (network_recorder_ && !warming_up_) {
+    network_recorder_->OnResourceLoadStarted(resource, request);
+  }
+  auto measured = navigation_.serial != 0;
+  if (measured) {
+    navigation_.resources++;
+    g_object_set_data(G_OBJECT(resource), kNavigationSerialKey,
+                      GUINT_TO_POINTER(navigation_.serial));
+    g_signal_connect_object(resource, "finished",
+                            G_CALLBACK(on_resource_finished), webview_,
+                            static_cast<GConnectFlags>(0));
+  }
+  if (measured || !content_filters_.empty()) {
+    g_signal_connect_object(resource, "failed",
+                            G_CALLBACK(on_resource_failed), webview_,
+                            static_cast<GConnectFlags>(0));
+  }
+}
+
+void WebviewWindow::OnResourceFailed(WebKitWebResource *resource,
+                                     const GError *error) {
+  if (g_error_matches(error, WEBKIT_POLICY_ERROR,
+                      kPolicyErrorBlockedByContentBlocker)) {
+    blocked_requests_++;
+  }
+  auto serial = GPOINTER_TO_UINT(
+      g_object_get_data(G_OBJECT(resource), kNavigationSerialKey));
+  if (serial != 0 && serial == navigation_.serial) {
+    navigation_.failed_resources++;
+  }
+}
+
+void WebviewWindow::OnResourceFinished(WebKitWebResource *resource) {
+  auto serial = GPOINTER_TO_UINT(
+      g_object_get_data(G_OBJECT(resource), kNavigationSerialKey));
+  if (serial == 0 || serial != navigation_.serial) {
+    return;
+  }
+  // Bytes as announced by the responses; chunked responses count as 0.
+  auto *response = webkit_web_resource_get_response(resource);
+  if (response) {
+    navigation_.resource_bytes += static_cast<int64_t>(
+        webkit_uri_response_get_content_length(response));
+  }
+}
+
+void WebviewWindow::OnLoadFailed(const GError *error) {
+  if (navigation_.serial != 0) {
+    navigation_.error = error->message;
+  }
+}
+
+void WebviewWindow::SetNavigationMetrics(
+    const NavigationMetricsConfig &config) {
+  navigation_metrics_ = config;
+  if (!config.metrics) {
+    navigation_ = NavigationTiming();
+  }
+  if (config.progress_interval_ms <= 0 && progress_source_) {
+    g_source_remove(progress_source_);
+    progress_source_ = 0;
+  }
+}
+
+void WebviewWindow::OnLoadProgressChanged() {
+  if (warming_up_ || !IsClaimed() ||
+      navigation_metrics_.progress_interval_ms <= 0 || progress_source_) {
+    return;
+  }
+  auto interval_us =
+      static_cast<gint64>(navigation_metrics_.progress_interval_ms) * 1000;
+  auto elapsed = g_get_monotonic_time() - last_progress_time_;
+  auto progress =
+      webkit_web_view_get_estimated_load_progress(WEBKIT_WEB_VIEW(webview_));
+  // The first update and the final one go out right away, the ones in
+  // between at most once per interval, carrying the latest value.
+  if (elapsed >= interval_us || progress >= 1.0) {
+    SendLoadProgress();
+    return;
+  }
+  progress_source_ = g_timeout_add(
+      static_cast<guint>((interval_us - elapsed + 999) / 1000),
+      [](gpointer user_data) -> gboolean {
+        auto *window = static_cast<WebviewWindow *>(user_data);
+        window->progress_source_ = 0;
+        window->SendLoadProgress();
+        return G_SOURCE_REMOVE;
+      },
+      this);
+}
+
+void WebviewWindow::SendLoadProgress() {
+  last_progress_time_ = g_get_monotonic_time();
+  auto *args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(window_id_));
+  fl_value_set_string_take(
+      args, "progress",
+      fl_value_new_float(webkit_web_view_get_estimated_load_progress(
+          WEBKIT_WEB_VIEW(webview_))));
+  fl_method_channel_invoke_method(FL_METHOD_CHANNEL(method_channel_),
+                                  "onLoadProgress", args, nullptr, nullptr,
+                                  nullptr);
+  fl_value_unref(args);
+}
+
+void WebviewWindow::SendNavigationMetrics(gint64 finished) {
+  const auto &timing = navigation_;
+  auto *args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(window_id_));
+  fl_value_set_string_take(args, "url",
+                           fl_value_new_string(timing.url.c_str()));
+  fl_value_set_string_take(args, "startTimeUs",
+                           fl_value_new_int(timing.started));
+  fl_value_set_string_take(
+      args, "redirectMs",
+      fl_value_new_float(elapsed_ms(timing.started, timing.redirected)));
+  fl_value_set_string_take(
+      args, "commitMs",
+      fl_value_new_float(elapsed_ms(timing.started, timing.committed)));
+  fl_value_set_string_take(
+      args, "finishMs", fl_value_new_float(elapsed_ms(timing.started, finished)));
+  fl_value_set_string_take(args, "redirects",
+                           fl_value_new_int(timing.redirects));
+  fl_value_set_string_take(args, "resources",
+                           fl_value_new_int(timing.resources));
+  fl_value_set_string_take(args, "resourceBytes",
+                           fl_value_new_int(timing.resource_bytes));
+  fl_value_set_string_take(args, "failedResources",
+                           fl_value_new_int(timing.failed_resources));
+  if (!timing.error.empty()) {
+    fl_value_set_string_take(args, "error",
+                             fl_value_new_string(timing.error.c_str()));
+  }
+  fl_method_channel_invoke_method(FL_METHOD_CHANNEL(method_channel_),
+                                  "onNavigationMetrics", args, nullptr,
+                                  nullptr, nullptr);
+  fl_value_unref(args);
+}
+
+void WebviewWindow::ScheduleMessageFlush() {
+  if (message_flush_source_ || batches_in_flight_ > 0) {
+    return;
+  }
+  message_flush_source_ = g_timeout_add(
+      message_batching_.flush_interval_ms,
+      [](gpointer user_data) -> gboolean {
+        auto *window = static_cast<WebviewWindow *>(user_data);
+        window->message_flush_source_ = 0;
+        window->FlushMessages(false);
+        return G_SOURCE_REMOVE;
+      },
+      this);
+}
+
+void WebviewWindow::FlushMessages(bool force) {
+  if (message_flush_source_) {
+    g_source_remove(message_flush_source_);
+    message_flush_source_ = 0;
+  }
+  // Only one batch is in flight at a time unless forced, so a slow Dart
+  // handler backs up the queue instead of the platform channel.
+  if (pending_messages_.empty() || (batches_in_flight_ > 0 && !force)) {
+    return;
+  }
+
+  auto *messages = fl_value_new_list();
+  auto count =
+      std::min(pending_messages_.size(), message_batching_.max_batch_size);
+  for (size_t i = 0; i < count; ++i) {
+    fl_value_append_take(messages, pending_messages_.front());
+    pending_messages_.pop_front();
+  }
+  message_stats_.delivered += count;
+  message_stats_.batched += count;
+  message_stats_.batches++;
+  batches_in_flight_++;
+
+  auto *args = fl_value_new_map();
+  fl_value_set(args, fl_value_new_string("id"), fl_value_new_int(window_id_));
+  fl_value_set_take(args, fl_value_new_string("messages"), messages);
+  fl_method_channel_invoke_method(
+      FL_METHOD_CHANNEL(method_channel_), "onJavascriptWebMessagesReceived",
+      args, message_cancellable_,
+      [](GObject *object, GAsyncResult *result, gpointer user_data) {
+        g_autoptr(GError) error = nullptr;
+        g_autoptr(FlMethodResponse) response =
+            fl_method_channel_invoke_method_finish(FL_METHOD_CHANNEL(object),
+                                                   result, &error);
+        // Cancelled when the window has been destroyed.
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+          return;
+        }
+        static_cast<WebviewWindow *>(user_data)->OnMessageBatchDelivered();
+      },
+      this);
+  fl_value_unref(args);
+}
+
+void WebviewWindow::OnMessageBatchDelivered() {
+  batches_in_flight_--;
+  if (pending_messages_.size() >= message_batching_.max_batch_size) {
+    FlushMessages(false);
+  } else if (!pending_messages_.empty()) {
+    ScheduleMessageFlush();
+  }
+}
+
 void WebviewWindow::Close() { gtk_widget_destroy(GTK_WIDGET(window_)); }
 
+bool WebviewWindow::CanGoBack() {
+  auto *web_view = WEBKIT_WEB_VIEW(webview_);
+  if (!webkit_web_view_can_go_back(web_view)) {
+    return false;
+  }
+  // The about:blank page a pooled window was warmed up with is not part of
+  // the history the app sees.
+  return warm_up_item_ == nullptr ||
+         webkit_back_forward_list_get_back_item(
+             webkit_web_view_get_back_forward_list(web_view)) != warm_up_item_;
+}
+
 void WebviewWindow::OnLoadChanged(WebKitLoadEvent load_event) {
+  if (warming_up_) {
+    if (load_event == WEBKIT_LOAD_COMMITTED && warm_up_item_ == nullptr) {
+      warm_up_item_ = WEBKIT_BACK_FORWARD_LIST_ITEM(
+          g_object_ref(webkit_back_forward_list_get_current_item(
+              webkit_web_view_get_back_forward_list(
+                  WEBKIT_WEB_VIEW(webview_)))));
+    } else if (load_event == WEBKIT_LOAD_FINISHED) {
+      warming_up_ = false;
+    }
+    return;
+  }
+  if (!IsClaimed()) {
+    return;
+  }
+  MarkActive();
+  if (load_event == WEBKIT_LOAD_FINISHED && restore_started_) {
+    auto restore_ms = elapsed_ms(restore_started_, g_get_monotonic_time());
+    restore_started_ = 0;
+    if (discarder_) {
+      discarder_->OnRestored(restore_ms);
+    }
+    auto *args = fl_value_new_map();
+    fl_value_set_string_take(args, "discarded", fl_value_new_bool(false));
+    fl_value_set_string_take(args, "restoring", fl_value_new_bool(false));
+    fl_value_set_string_take(args, "restoreMs",
+                             fl_value_new_float(restore_ms));
+    SendDiscardState(args);
+  }
+
   // notify history changed event.
   {
-    auto can_go_back = webkit_web_view_can_go_back(WEBKIT_WEB_VIEW(webview_));
+    auto can_go_back = CanGoBack();
     auto can_go_forward =
         webkit_web_view_can_go_forward(WEBKIT_WEB_VIEW(webview_));
     auto *args = fl_value_new_map();
@@ -245,6 +1131,36 @@ void WebviewWindow::OnLoadChanged(WebKitLoadEvent load_event) {
                                     nullptr);
   }
 
+  if (navigation_metrics_.metrics) {
+    auto now = g_get_monotonic_time();
+    const auto *uri = webkit_web_view_get_uri(WEBKIT_WEB_VIEW(webview_));
+    switch (load_event) {
+      case WEBKIT_LOAD_STARTED:
+        navigation_ = NavigationTiming();
+        navigation_.serial = next_navigation_serial_++;
+        if (next_navigation_serial_ == 0) {
+          next_navigation_serial_ = 1;
+        }
+        navigation_.url = uri ? uri : "";
+        navigation_.started = now;
+        break;
+      case WEBKIT_LOAD_REDIRECTED:
+        navigation_.redirected = now;
+        navigation_.redirects++;
+        break;
+      case WEBKIT_LOAD_COMMITTED:
+        navigation_.committed = now;
+        navigation_.url = uri ? uri : "";
+        break;
+      case WEBKIT_LOAD_FINISHED:
+        if (navigation_.serial != 0) {
+          SendNavigationMetrics(now);
+        }
+        navigation_ = NavigationTiming();
+        break;
+    }
+  }
+
   // notify load start/finished event.
   switch (load_event) {
     case WEBKIT_LOAD_STARTED: {
@@ -275,6 +1191,9 @@ void WebviewWindow::GoForward() {
 }
 
 void WebviewWindow::GoBack() {
+  if (!CanGoBack()) {
+    return;
+  }
   webkit_web_view_go_back(WEBKIT_WEB_VIEW(webview_));
 }
 
@@ -286,111 +1205,222 @@ void WebviewWindow::StopLoading() {
   webkit_web_view_stop_loading(WEBKIT_WEB_VIEW(webview_));
 }
 
-FlValue *WebviewWindow::GetAllCookies() {
-  GList *cookies = get_cookies_sync(WEBKIT_WEB_VIEW(webview_));
-
-  g_autoptr(FlValue) fl_cookie_list = fl_value_new_list();
-
-  FlValue* cookie_list = fl_value_ref(fl_cookie_list);
-
-  for (GList *l = cookies; l; l = l->next) {
-    SoupCookie *cookie = (SoupCookie *)l->data;
-    g_autoptr(FlValue) cookie_map = fl_value_new_map();
-
-    fl_value_set_string_take(cookie_map, "name",
-                             fl_value_new_string(soup_cookie_get_name(cookie)));
-    fl_value_set_string_take(
-        cookie_map, "value",
-        fl_value_new_string(soup_cookie_get_value(cookie)));
-    fl_value_set_string_take(
-        cookie_map, "domain",
-        fl_value_new_string(soup_cookie_get_domain(cookie)));
-    fl_value_set_string_take(cookie_map, "path",
-                             fl_value_new_string(soup_cookie_get_path(cookie)));
-
-    gdouble expires = g_date_time_get_seconds(soup_cookie_get_expires(cookie));
-
-    if (expires >= 0) {
-      fl_value_set_string_take(cookie_map, "expires",
-                               fl_value_new_float(expires));
-    } else {
-      fl_value_set_string_take(cookie_map, "expires", fl_value_new_null());
-    }
-
-    fl_value_set_string_take(
-        cookie_map, "httpOnly",
-        fl_value_new_bool(soup_cookie_get_http_only(cookie)));
-    fl_value_set_string_take(cookie_map, "secure",
-                             fl_value_new_bool(soup_cookie_get_secure(cookie)));
-    fl_value_set_string_take(cookie_map, "sessionOnly",
-                             fl_value_new_bool(false));
-
-    fl_value_append(cookie_list, cookie_map);
-    soup_cookie_free(cookie);
+void WebviewWindow::GetAllCookies(const CookieFilter &filter,
+                                  FlMethodCall *call) {
+  const gchar *uri = webkit_web_view_get_uri(WEBKIT_WEB_VIEW(webview_));
+  if (uri == nullptr) {
+    g_autoptr(FlValue) cookie_list = fl_value_new_list();
+    fl_method_call_respond_success(call, cookie_list, nullptr);
+    return;
   }
+  webkit_cookie_manager_get_cookies(
+      cookie_manager(), uri, nullptr, on_cookies_ready,
+      new CookieRequest{FL_METHOD_CALL(g_object_ref(call)), filter});
+}
 
-  g_free(cookies);
-
-  return cookie_list;
+WebKitCookieManager *WebviewWindow::cookie_manager() const {
+  return webkit_web_context_get_cookie_manager(
+      webkit_web_view_get_context(WEBKIT_WEB_VIEW(webview_)));
 }
 
 gboolean WebviewWindow::DecidePolicy(WebKitPolicyDecision *decision,
                                      WebKitPolicyDecisionType type) {
-  if (type == WEBKIT_POLICY_DECISION_TYPE_NAVIGATION_ACTION) {
-    auto *navigation_decision = WEBKIT_NAVIGATION_POLICY_DECISION(decision);
-    auto *navigation_action =
-        webkit_navigation_policy_decision_get_navigation_action(
-            navigation_decision);
-    auto *request = webkit_navigation_action_get_request(navigation_action);
-    auto *uri = webkit_uri_request_get_uri(request);
-    auto *args = fl_value_new_map();
-    fl_value_set(args, fl_value_new_string("id"), fl_value_new_int(window_id_));
-    fl_value_set(args, fl_value_new_string("url"), fl_value_new_string(uri));
+  if (!IsClaimed() || (type != WEBKIT_POLICY_DECISION_TYPE_NAVIGATION_ACTION &&
+                       type != WEBKIT_POLICY_DECISION_TYPE_NEW_WINDOW_ACTION)) {
+    return false;
+  }
+  // Without rules only top level navigations are reported, as before.
+  if (!url_rules_ && type != WEBKIT_POLICY_DECISION_TYPE_NAVIGATION_ACTION) {
+    return false;
+  }
+  auto *navigation_decision = WEBKIT_NAVIGATION_POLICY_DECISION(decision);
+  auto *navigation_action =
+      webkit_navigation_policy_decision_get_navigation_action(
+          navigation_decision);
+  auto *request = webkit_navigation_action_get_request(navigation_action);
+  auto *uri = webkit_uri_request_get_uri(request);
+
+  if (url_rules_) {
+    auto action = url_rules_->Evaluate(uri);
+    if (action == UrlRuleAction::kAllow) {
+      webkit_policy_decision_use(decision);
+      return true;
+    }
+    if (action == UrlRuleAction::kBlock) {
+      webkit_policy_decision_ignore(decision);
+      return true;
+    }
+  }
+
+  g_autoptr(FlValue) args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(window_id_));
+  fl_value_set_string_take(args, "url", fl_value_new_string(uri));
+  if (!url_rules_) {
     fl_method_channel_invoke_method(FL_METHOD_CHANNEL(method_channel_),
                                     "onUrlRequested", args, nullptr, nullptr,
                                     nullptr);
+    return false;
   }
-  return false;
+
+  // Hold the navigation until Dart answers. The decision outlives the view
+  // if the window closes first, so the reply does not touch the window.
+  struct PendingDecision {
+    WebKitPolicyDecision *decision;
+    UrlRuleAction fallback;
+  };
+  auto *pending = new PendingDecision{
+      WEBKIT_POLICY_DECISION(g_object_ref(decision)),
+      url_rules_->default_action()};
+  fl_method_channel_invoke_method(
+      FL_METHOD_CHANNEL(method_channel_), "onUrlRequested", args, nullptr,
+      [](GObject *object, GAsyncResult *result, gpointer user_data) {
+        auto *pending = static_cast<PendingDecision *>(user_data);
+        g_autoptr(FlMethodResponse) response =
+            fl_method_channel_invoke_method_finish(FL_METHOD_CHANNEL(object),
+                                                   result, nullptr);
+        auto *value =
+            response ? fl_method_response_get_result(response, nullptr)
+                     : nullptr;
+        // Fall back to the default action if Dart gave no answer, but never
+        // ask again.
+        auto allow = value && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL
+                         ? fl_value_get_bool(value)
+                         : pending->fallback != UrlRuleAction::kBlock;
+        if (allow) {
+          webkit_policy_decision_use(pending->decision);
+        } else {
+          webkit_policy_decision_ignore(pending->decision);
+        }
+        g_object_unref(pending->decision);
+        delete pending;
+      },
+      pending);
+  return true;
+}
+
+void WebviewWindow::SetUrlRules(std::unique_ptr<UrlRuleEngine> rules) {
+  url_rules_ = std::move(rules);
+}
+
+void WebviewWindow::TakeSnapshot(WebKitSnapshotRegion region,
+                                 SnapshotFormat format, FlMethodCall *call) {
+  struct SnapshotRequest {
+    FlMethodCall *call;
+    SnapshotFormat format;
+  };
+  webkit_web_view_get_snapshot(
+      WEBKIT_WEB_VIEW(webview_), region, WEBKIT_SNAPSHOT_OPTIONS_NONE, nullptr,
+      [](GObject *object, GAsyncResult *result, gpointer user_data) {
+        auto *request = static_cast<SnapshotRequest *>(user_data);
+        g_autoptr(GError) error = nullptr;
+        auto *surface = webkit_web_view_get_snapshot_finish(
+            WEBKIT_WEB_VIEW(object), result, &error);
+        g_autoptr(FlValue) snapshot =
+            surface ? snapshot_to_fl_value(surface, request->format, &error)
+                    : nullptr;
+        if (snapshot) {
+          fl_method_call_respond_success(request->call, snapshot, nullptr);
+        } else {
+          fl_method_call_respond_error(request->call, "0", error->message,
+                                       nullptr, nullptr);
+        }
+        if (surface) {
+          cairo_surface_destroy(surface);
+        }
+        g_object_unref(request->call);
+        delete request;
+      },
+      new SnapshotRequest{FL_METHOD_CALL(g_object_ref(call)), format});
 }
 
 void WebviewWindow::EvaluateJavaScript(const char *java_script,
+                                       bool native_result,
                                        FlMethodCall *call) {
-#ifdef WEBKIT_OLD_USED
-  webkit_web_view_run_javascript(
-#else
-  webkit_web_view_evaluate_javascript(
-#endif
-      WEBKIT_WEB_VIEW(webview_), java_script,
-#ifndef WEBKIT_OLD_USED
-      -1, nullptr, nullptr,
-#endif
-      nullptr,
+  struct Evaluation {
+    FlMethodCall *call;
+    bool native_result;
+  };
+  evaluate_script(
+      WEBKIT_WEB_VIEW(webview_), java_script, nullptr,
       [](GObject *object, GAsyncResult *result, gpointer user_data) {
-        auto *call = static_cast<FlMethodCall *>(user_data);
+        auto *evaluation = static_cast<Evaluation *>(user_data);
         GError *error = nullptr;
-        auto *js_result =
-#ifdef WEBKIT_OLD_USED
-            webkit_web_view_run_javascript_finish(
-#else
-            webkit_web_view_evaluate_javascript_finish(
-#endif
-                WEBKIT_WEB_VIEW(object), result, &error);
-        if (!js_result) {
-          fl_method_call_respond_error(call, "failed to evaluate javascript.",
+        auto *js_value =
+            finish_script(WEBKIT_WEB_VIEW(object), result, &error);
+        g_autoptr(FlValue) value = nullptr;
+        if (js_value) {
+          value = script_result_to_fl_value(
+              js_value, evaluation->native_result, &error);
+          g_object_unref(js_value);
+        }
+        if (!value) {
+          fl_method_call_respond_error(evaluation->call,
+                                       "failed to evaluate javascript.",
                                        error->message, nullptr, nullptr);
           g_error_free(error);
         } else {
-          auto *js_value = jsc_value_to_json(
-#ifdef WEBKIT_OLD_USED
-              webkit_javascript_result_get_js_value
-#endif
-              (js_result),
-              0);
-          fl_method_call_respond_success(
-              call, js_value ? fl_value_new_string(js_value) : nullptr,
-              nullptr);
+          fl_method_call_respond_success(evaluation->call, value, nullptr);
         }
-        g_object_unref(call);
+        g_object_unref(evaluation->call);
+        delete evaluation;
       },
-      g_object_ref(call));
-}
\ No newline at end of file
+      new Evaluation{FL_METHOD_CALL(g_object_ref(call)), native_result});
+}
+
+void WebviewWindow::EvaluateJavaScriptBatch(std::vector<std::string> scripts,
+                                            bool native_result,
+                                            FlMethodCall *call) {
+  // Holds the view rather than the window, so scripts still running when
+  // the window closes never touch freed memory.
+  struct Batch {
+    WebKitWebView *web_view;
+    FlMethodCall *call;
+    std::vector<std::string> scripts;
+    size_t next;
+    bool native_result;
+    FlValue *results;
+
+    static void Run(Batch *batch) {
+      if (batch->next == batch->scripts.size()) {
+        fl_method_call_respond_success(batch->call, batch->results, nullptr);
+        fl_value_unref(batch->results);
+        g_object_unref(batch->call);
+        g_object_unref(batch->web_view);
+        delete batch;
+        return;
+      }
+      evaluate_script(batch->web_view, batch->scripts[batch->next].c_str(),
+                      nullptr, OnEvaluated, batch);
+    }
+
+    static void OnEvaluated(GObject *object, GAsyncResult *result,
+                            gpointer user_data) {
+      auto *batch = static_cast<Batch *>(user_data);
+      g_autoptr(GError) error = nullptr;
+      auto *js_value = finish_script(WEBKIT_WEB_VIEW(object), result, &error);
+      FlValue *value = nullptr;
+      if (js_value) {
+        value =
+            script_result_to_fl_value(js_value, batch->native_result, &error);
+        g_object_unref(js_value);
+      }
+      auto *item = fl_value_new_map();
+      if (value) {
+        fl_value_set_string_take(item, "value", value);
+      } else {
+        fl_value_set_string_take(item, "error",
+                                 fl_value_new_string(error->message));
+      }
+      fl_value_append_take(batch->results, item);
+      batch->next++;
+      Run(batch);
+    }
+  };
+  auto *batch = new Batch{WEBKIT_WEB_VIEW(g_object_ref(webview_)),
+                          FL_METHOD_CALL(g_object_ref(call)),
+                          std::move(scripts),
+                          0,
+                          native_result,
+                          fl_value_new_list()};
+  Batch::Run(batch);
+}
@@ -9,49 +9,143 @@
 #include <gtk/gtk.h>
 #include <libsoup/soup.h>
 #include <glib.h>
+#include <sys/types.h>
 #include <webkit2/webkit2.h>
 
+#include <deque>
 #include <functional>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
-typedef struct {
-    GMainLoop *loop;
-    GList *cookies;
-} CookieData;
+#include "cookies.h"
+#include "download_controller.h"
+#include "network_recorder.h"
+#include "snapshot.h"
+#include "url_rule_engine.h"
+#include "user_script_registry.h"
+#include "web_extension_client.h"
+#include "webview_texture.h"
+#include "window_discarder.h"
 
-struct UserScript {
-  std::string source;
-  int injection_time;
-  bool for_all_frames;
+void handle_script_message(WebKitUserContentManager *manager, WebKitJavascriptResult *js_result, gpointer user_data);
+
+// What happens to a msgToNative message that arrives while the batching
+// queue is full.
+enum class MessageOverflowPolicy {
+  kDropOldest = 0,
+  kDropNewest = 1,
+  // Send another batch right away, even if Dart has not acknowledged the
+  // previous one yet.
+  kBlock = 2,
 };
 
-void handle_script_message(WebKitUserContentManager *manager, WebKitJavascriptResult *js_result, gpointer user_data);
+struct MessageBatchingConfig {
+  bool enabled = false;
+  // Queued messages are flushed after this delay, one 60Hz frame by default.
+  int flush_interval_ms = 16;
+  // A batch is flushed immediately once it holds this many messages.
+  size_t max_batch_size = 64;
+  size_t max_queue_size = 1024;
+  MessageOverflowPolicy overflow_policy = MessageOverflowPolicy::kDropOldest;
+};
+
+struct MessageStats {
+  int64_t received = 0;
+  int64_t delivered = 0;
+  int64_t dropped = 0;
+  // Number of batches sent and of messages sent inside them.
+  int64_t batches = 0;
+  int64_t batched = 0;
+};
 
-void get_cookies_callback(WebKitCookieManager *manager, GAsyncResult *res,
-                          gpointer user_data);
+struct PageMessageStats {
+  int64_t posted = 0;
+  int64_t delivered = 0;
+  // Script evaluations that carried the delivered messages.
+  int64_t batches = 0;
+  // Messages lost with a failed evaluation, e.g. during a navigation.
+  int64_t failed = 0;
+};
 
-GList *get_cookies_sync(WebKitWebView *web_view);
+struct NavigationMetricsConfig {
+  // Sends onNavigationMetrics once per navigation.
+  bool metrics = false;
+  // Minimum interval between onLoadProgress events, 0 sends none.
+  int progress_interval_ms = 0;
+};
 
 class WebviewWindow {
  public:
-WebviewWindow(FlMethodChannel *method_channel, int64_t window_id,
-               std::function<void()> on_close_callback,
-               const std::string &title, int width, int height,
-               bool headless,
-               const std::vector<UserScript> &user_scripts,
-               const char* proxy_url);  virtual ~WebviewWindow();
+  // Builds a hidden window that is not bound to a Dart webview yet. It sends
+  // no events and leaves the proxy settings alone until Claim() is called.
+  // A null |context| selects the default context. User scripts are shared
+  // through |user_script_registry|, which must outlive the window.
+  WebviewWindow(FlMethodChannel *method_channel,
+                std::function<void()> on_close_callback,
+                WebKitWebContext *context,
+                UserScriptRegistry *user_script_registry);
+
+  WebviewWindow(FlMethodChannel *method_channel, int64_t window_id,
+                std::function<void()> on_close_callback,
+                const std::string &title, int width, int height,
+                bool headless,
+                const std::vector<UserScript> &user_scripts,
+                WebKitWebContext *context, const char* proxy_url,
+                UserScriptRegistry *user_script_registry);
+
+  virtual ~WebviewWindow();
+
+  // Loads about:blank so the web process is spawned before the window is
+  // claimed. The warm-up page is hidden from the history.
+  void Prewarm();
+
+  // Binds the window to |window_id| and applies the create configuration.
+  void Claim(int64_t window_id, std::function<void()> on_close_callback,
+             const std::string &title, int width, int height, bool headless,
+             const std::vector<UserScript> &user_scripts);
+
+  // Sets the proxy of the window's context. The proxy belongs to the data
+  // manager, so a null |proxy_url| resets the proxy of every window on the
+  // default context.
+  void ApplyProxy(const char *proxy_url);
+
+  bool IsClaimed() const { return window_id_ != kUnclaimedWindowId; }
 
   void Navigate(const char *url);
 
   void RunJavaScriptWhenContentReady(const char *java_script);
 
+  // Injects |script| into every page loaded from now on. Returns an id for
+  // RemoveUserScript() and ReplaceUserScript().
+  int64_t AddUserScript(const UserScript &script);
+
+  bool RemoveUserScript(int64_t script_id);
+
+  // Swaps the script |script_id| for |script|, keeping its id and order.
+  bool ReplaceUserScript(int64_t script_id, const UserScript &script);
+
   void Close();
 
   void SetApplicationNameForUserAgent(const std::string &app_name);
 
   void OnLoadChanged(WebKitLoadEvent load_event);
 
+  void OnResourceLoadStarted(WebKitWebResource *resource,
+                             WebKitURIRequest *request);
+
+  void OnResourceFailed(WebKitWebResource *resource, const GError *error);
+
+  void OnResourceFinished(WebKitWebResource *resource);
+
+  void OnLoadFailed(const GError *error);
+
+  void OnLoadProgressChanged();
+
+  void SetNavigationMetrics(const NavigationMetricsConfig &config);
+
   void GoBack();
 
   void GoForward();
@@ -60,14 +154,132 @@ WebviewWindow(FlMethodChannel *method_channel, int64_t window_id,
 
   void StopLoading();
 
-  FlValue* GetAllCookies();
+  // Responds to |call| with the cookies of the current URI that match
+  // |filter| once the cookie manager returns them.
+  void GetAllCookies(const CookieFilter &filter, FlMethodCall *call);
+
+  // The cookie jar of the web context of the view.
+  WebKitCookieManager *cookie_manager() const;
 
   gboolean DecidePolicy(WebKitPolicyDecision *decision,
                         WebKitPolicyDecisionType type);
 
-  void EvaluateJavaScript(const char *java_script, FlMethodCall *call);
+  // Decides navigations natively with |rules|. Without rules every
+  // navigation is allowed and reported to onUrlRequested.
+  void SetUrlRules(std::unique_ptr<UrlRuleEngine> rules);
+
+  // Responds to |call| with the result of |java_script|, as JSON text or,
+  // with |native_result|, converted by js_value_to_fl_value().
+  void EvaluateJavaScript(const char *java_script, bool native_result,
+                          FlMethodCall *call);
+
+  // Responds to |call| with a snapshot of |region| in |format|, see
+  // snapshot_to_fl_value().
+  void TakeSnapshot(WebKitSnapshotRegion region, SnapshotFormat format,
+                    FlMethodCall *call);
+
+  // Runs |scripts| one after another and responds to |call| with a list
+  // holding {"value": result} or {"error": message} per script.
+  void EvaluateJavaScriptBatch(std::vector<std::string> scripts,
+                               bool native_result, FlMethodCall *call);
+
+  // Answers |query| from the web process, see query_dom().
+  void QueryDom(const DomQuery &query, FlMethodCall *call);
+
+  // Handles a window.webkit.messageHandlers.msgToNative.postMessage() call.
+  void OnScriptMessage(JSCValue *value);
+
+  void SetMessageBatching(const MessageBatchingConfig &config);
+
+  // Returns the counters of both directions, the page-bound ones under
+  // "toPage".
+  FlValue *GetMessageStats() const;
+
+  // Dispatches a "message" event with |message| on the top level window of
+  // the page, parsed first if |is_json|. Messages posted within one main
+  // loop iteration are delivered by a single script evaluation.
+  void PostWebMessage(const char *message, bool is_json);
+
+  // Keeps visited pages in memory for instant back/forward navigation.
+  void SetPageCacheEnabled(bool enabled);
+
+  // Returns the resident memory of the web process behind this window, or
+  // of all web processes while the web extension has not reported it.
+  FlValue *GetMemoryUsage() const;
+
+  // Windows report restores to |discarder|, which must outlive them.
+  void SetDiscarder(WindowDiscarder *discarder) { discarder_ = discarder; }
+
+  void MarkActive() { last_activity_ = g_get_monotonic_time(); }
+
+  // g_get_monotonic_time() of the last call, load or showing.
+  gint64 last_activity() const { return last_activity_; }
+
+  bool IsDiscarded() const { return discarded_; }
+
+  // Whether the window is on screen or rendered into a texture.
+  bool IsVisibleToUser() const;
+
+  // Saves the session state and URI and terminates the web process, to be
+  // brought back by Restore(). |reclaimed_bytes| gets the PSS of the
+  // process if known. Returns false if the window is discarded already,
+  // playing audio, or WebKitGTK is older than 2.34.
+  bool Discard(int64_t *reclaimed_bytes);
+
+  // Loads the saved session of a discarded window again. Does nothing for
+  // other windows.
+  void Restore();
+
+  // Returns the serialized WebKitWebViewSessionState of the view as a
+  // uint8 list, the saved one while the window is discarded.
+  FlValue *SaveSessionState() const;
+
+  // Replaces the history with |state| and loads its current item.
+  void RestoreSessionState(WebKitWebViewSessionState *state);
+
+  // Called by the web extension for every page the view gets, with the web
+  // process that renders it.
+  void OnPageCreated(pid_t pid);
+
+  // Blocks the resources |filter| matches, replacing a filter with the same
+  // identifier.
+  void AddContentFilter(WebKitUserContentFilter *filter);
+
+  void RemoveContentFilter(const char *identifier);
+
+  FlValue *GetContentFilterStats() const;
+
+  // Shows a headless window in a texture registered with |registrar|.
+  // Returns the texture id, or -1 if the window is not headless.
+  int64_t AttachTexture(FlTextureRegistrar *registrar,
+                        const TextureConfig &config);
+
+  // The texture of AttachTexture(), or null.
+  WebviewTexture *texture() const { return texture_.get(); }
+
+  // Takes over the downloads of the view from now on, see
+  // DownloadController.
+  void SetDownloadConfig(const DownloadConfig &config);
+
+  // Sends the changes of the cookie jar to Dart, see CookieWatcher. A null
+  // |config| stops watching.
+  void SetCookieWatch(const CookieWatchConfig *config);
+
+  // The controller of SetDownloadConfig(), or null.
+  DownloadController *downloads() const { return downloads_.get(); }
+
+  // Records the resources loaded from now on, dropping an earlier
+  // recording.
+  void StartNetworkRecording(const NetworkRecorderConfig &config);
+
+  // The recorder of StartNetworkRecording(), or null.
+  NetworkRecorder *network_recorder() const {
+    return network_recorder_.get();
+  }
 
  private:
+  static constexpr int64_t kUnclaimedWindowId = -1;
+
   FlMethodChannel *method_channel_;
   int64_t window_id_;
   std::function<void()> on_close_callback_;
@@ -76,6 +288,94 @@ WebviewWindow(FlMethodChannel *method_channel, int64_t window_id,
 
   GtkWidget *window_ = nullptr;
   GtkWidget *webview_ = nullptr;
+  // Holds the view of a headless window instead of |window_|.
+  GtkWidget *offscreen_window_ = nullptr;
+  std::unique_ptr<WebviewTexture> texture_;
+  std::unique_ptr<DownloadController> downloads_;
+  std::unique_ptr<NetworkRecorder> network_recorder_;
+  std::unique_ptr<CookieWatcher> cookie_watcher_;
+  // Reported by the web extension, 0 if unknown.
+  pid_t web_process_pid_ = 0;
+
+  WindowDiscarder *discarder_ = nullptr;
+  gint64 last_activity_ = g_get_monotonic_time();
+  bool discarded_ = false;
+  WebKitWebViewSessionState *discarded_state_ = nullptr;
+  std::string discarded_uri_;
+  // When Restore() started, 0 while no restore is loading.
+  gint64 restore_started_ = 0;
+
+  void SendDiscardState(FlValue *args);
+
+  bool warming_up_ = false;
+  WebKitBackForwardListItem *warm_up_item_ = nullptr;
+
+  std::unique_ptr<UrlRuleEngine> url_rules_;
+
+  UserScriptRegistry *user_script_registry_;
+  // Scripts by id, in the order they were added.
+  std::map<int64_t, WebKitUserScript *> user_scripts_;
+  int64_t next_user_script_id_ = 1;
+
+  std::set<std::string> content_filters_;
+  int64_t blocked_requests_ = 0;
+
+  // Timestamps are g_get_monotonic_time() values, 0 if not reached.
+  struct NavigationTiming {
+    // Tags the resources of the navigation, 0 while none is measured.
+    guint serial = 0;
+    std::string url;
+    gint64 started = 0;
+    gint64 redirected = 0;
+    gint64 committed = 0;
+    int redirects = 0;
+    int64_t resources = 0;
+    int64_t resource_bytes = 0;
+    int64_t failed_resources = 0;
+    std::string error;
+  };
+
+  NavigationMetricsConfig navigation_metrics_;
+  NavigationTiming navigation_;
+  guint next_navigation_serial_ = 1;
+  gint64 last_progress_time_ = 0;
+  guint progress_source_ = 0;
+
+  void SendNavigationMetrics(gint64 finished);
+
+  void SendLoadProgress();
+
+  MessageBatchingConfig message_batching_;
+  MessageStats message_stats_;
+  std::deque<FlValue *> pending_messages_;
+  int batches_in_flight_ = 0;
+  guint message_flush_source_ = 0;
+  GCancellable *message_cancellable_;
+
+  void ScheduleMessageFlush();
+
+  // Sends up to max_batch_size queued messages as one method call.
+  void FlushMessages(bool force);
+
+  void OnMessageBatchDelivered();
+
+  // Page-bound messages as [isJson, text] array elements.
+  std::string page_messages_;
+  size_t page_messages_queued_ = 0;
+  // Messages of the evaluation in flight, 0 if none.
+  size_t page_messages_in_flight_ = 0;
+  guint page_message_source_ = 0;
+  PageMessageStats page_message_stats_;
+
+  // Evaluates the queued page-bound messages, unless a batch is in flight.
+  void FlushPageMessages();
+
+  void OnPageMessagesDelivered(bool delivered);
+
+  bool CanGoBack();
+
+  // Installs the scripts of user_scripts_ into the content manager again.
+  void ReinstallUserScripts();
 };
 
 #endif  // WEBVIEW_WINDOW_LINUX_WEBVIEW_WINDOW_H_
@@ -0,0 +1,111 @@
+#include "window_discarder.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "webview_window.h"
+
+WindowDiscarder::WindowDiscarder(WindowLister list_windows)
+    : list_windows_(std::move(list_windows)) {}
+
+WindowDiscarder::~WindowDiscarder() {
+  SetPolicy(DiscardPolicy());
+}
+
+void WindowDiscarder::SetPolicy(const DiscardPolicy &policy) {
+  policy_ = policy;
+  if (timer_source_) {
+    g_source_remove(timer_source_);
+    timer_source_ = 0;
+  }
+  if (memory_monitor_) {
+    g_signal_handler_disconnect(memory_monitor_, memory_warning_handler_);
+    g_clear_object(&memory_monitor_);
+  }
+  if (!policy_.enabled) {
+    return;
+  }
+  if (policy_.idle_timeout_ms > 0) {
+    // A window is discarded at most a quarter of the timeout late.
+    auto interval_ms = std::min(std::max(policy_.idle_timeout_ms / 4, 1000),
+                                60 * 1000);
+    timer_source_ = g_timeout_add(interval_ms, OnTimer, this);
+  }
+#if GLIB_CHECK_VERSION(2, 64, 0)
+  if (policy_.on_memory_pressure) {
+    memory_monitor_ = G_OBJECT(g_memory_monitor_dup_default());
+    memory_warning_handler_ =
+        g_signal_connect(memory_monitor_, "low-memory-warning",
+                         G_CALLBACK(OnLowMemoryWarning), this);
+  }
+#endif
+}
+
+void WindowDiscarder::OnWindowCall(WebviewWindow *window) {
+  window->MarkActive();
+  window->Restore();
+}
+
+bool WindowDiscarder::Discard(WebviewWindow *window) {
+  int64_t reclaimed_bytes = 0;
+  if (!window->Discard(&reclaimed_bytes)) {
+    return false;
+  }
+  discards_++;
+  reclaimed_bytes_ += reclaimed_bytes;
+  return true;
+}
+
+void WindowDiscarder::OnRestored(double restore_ms) {
+  restores_++;
+  last_restore_ms_ = restore_ms;
+  total_restore_ms_ += restore_ms;
+}
+
+FlValue *WindowDiscarder::GetStats() const {
+  int64_t discarded = 0;
+  for (auto *window : list_windows_()) {
+    if (window->IsDiscarded()) {
+      discarded++;
+    }
+  }
+  auto *stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "discarded", fl_value_new_int(discarded));
+  fl_value_set_string_take(stats, "discards", fl_value_new_int(discards_));
+  fl_value_set_string_take(stats, "restores", fl_value_new_int(restores_));
+  fl_value_set_string_take(stats, "reclaimedBytes",
+                           fl_value_new_int(reclaimed_bytes_));
+  fl_value_set_string_take(stats, "lastRestoreMs",
+                           fl_value_new_float(last_restore_ms_));
+  fl_value_set_string_take(
+      stats, "averageRestoreMs",
+      fl_value_new_float(restores_ ? total_restore_ms_ / restores_ : 0));
+  fl_value_set_string_take(stats, "pressureEvents",
+                           fl_value_new_int(pressure_events_));
+  return stats;
+}
+
+void WindowDiscarder::DiscardIdle(int64_t min_idle_ms) {
+  auto now = g_get_monotonic_time();
+  for (auto *window : list_windows_()) {
+    if (window->IsDiscarded() ||
+        (!policy_.discard_visible && window->IsVisibleToUser()) ||
+        now - window->last_activity() < min_idle_ms * 1000) {
+      continue;
+    }
+    Discard(window);
+  }
+}
+
+gboolean WindowDiscarder::OnTimer(gpointer user_data) {
+  auto *self = static_cast<WindowDiscarder *>(user_data);
+  self->DiscardIdle(self->policy_.idle_timeout_ms);
+  return G_SOURCE_CONTINUE;
+}
+
+void WindowDiscarder::OnLowMemoryWarning(GObject *monitor, gint level,
+                                         gpointer user_data) {
+  auto *self = static_cast<WindowDiscarder *>(user_data);
+  self->pressure_events_++;
+  self->DiscardIdle(self->policy_.pressure_min_idle_ms);
+}
@@ -0,0 +1,82 @@
+#ifndef WEBVIEW_WINDOW_LINUX_WINDOW_DISCARDER_H_
+#define WEBVIEW_WINDOW_LINUX_WINDOW_DISCARDER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gio/gio.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class WebviewWindow;
+
+struct DiscardPolicy {
+  bool enabled = false;
+  // Windows without calls, loads or showing for this long are discarded,
+  // 0 leaves idle windows alone.
+  int idle_timeout_ms = 5 * 60 * 1000;
+  // Discard windows idle for |pressure_min_idle_ms| when GLib reports low
+  // memory.
+  bool on_memory_pressure = true;
+  int pressure_min_idle_ms = 30 * 1000;
+  // Also discard windows the user can see. Headless windows never count
+  // as visible, texture windows always do.
+  bool discard_visible = false;
+};
+
+// Discards idle windows by |policy|: their session state is saved and their
+// web process terminated. A window comes back when it is shown or receives
+// a method call, see WebviewWindow::Restore().
+//
+// Windows keep a pointer to the discarder, so it must outlive them.
+class WindowDiscarder {
+ public:
+  typedef std::function<std::vector<WebviewWindow *>()> WindowLister;
+
+  explicit WindowDiscarder(WindowLister list_windows);
+
+  ~WindowDiscarder();
+
+  WindowDiscarder(const WindowDiscarder &) = delete;
+  WindowDiscarder &operator=(const WindowDiscarder &) = delete;
+
+  void SetPolicy(const DiscardPolicy &policy);
+
+  // Marks |window| active and restores it if it was discarded.
+  void OnWindowCall(WebviewWindow *window);
+
+  // Discards |window| regardless of the policy. Returns false if it is
+  // already discarded or can not be.
+  bool Discard(WebviewWindow *window);
+
+  // Called by a window once its page is loaded again.
+  void OnRestored(double restore_ms);
+
+  // Returns {"discarded", "discards", "restores", "reclaimedBytes",
+  // "lastRestoreMs", "averageRestoreMs", "pressureEvents"}.
+  FlValue *GetStats() const;
+
+ private:
+  WindowLister list_windows_;
+  DiscardPolicy policy_;
+  guint timer_source_ = 0;
+  GObject *memory_monitor_ = nullptr;
+  gulong memory_warning_handler_ = 0;
+
+  int64_t discards_ = 0;
+  int64_t restores_ = 0;
+  int64_t reclaimed_bytes_ = 0;
+  double last_restore_ms_ = 0;
+  double total_restore_ms_ = 0;
+  int64_t pressure_events_ = 0;
+
+  // Discards the eligible windows idle for at least |min_idle_ms|.
+  void DiscardIdle(int64_t min_idle_ms);
+
+  static gboolean OnTimer(gpointer user_data);
+
+  static void OnLowMemoryWarning(GObject *monitor, gint level,
+                                 gpointer user_data);
+};
+
+#endif  // WEBVIEW_WINDOW_LINUX_WINDOW_DISCARDER_H_